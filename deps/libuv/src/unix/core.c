@@ -339,6 +339,21 @@ int uv_loop_alive(const uv_loop_t* loop) {
 }
 
 
+/* pyuv: optional hook called when uv_run() enters each phase of a loop
+ * iteration, used to collect per-phase timing. The phase numbers are:
+ * 0 timers, 1 pending, 2 idle, 3 prepare, 4 i/o poll, 5 check, 6 closing
+ * handles and 7 for the end of the iteration.
+ */
+void (*uv__run_phase_hook)(uv_loop_t* loop, int phase);
+
+#define UV__RUN_PHASE(loop, phase)                                            \
+  do {                                                                        \
+    if (uv__run_phase_hook != NULL)                                           \
+      uv__run_phase_hook((loop), (phase));                                    \
+  }                                                                           \
+  while (0)
+
+
 int uv_run(uv_loop_t* loop, uv_run_mode mode) {
   int timeout;
   int r;
@@ -349,18 +364,25 @@ int uv_run(uv_loop_t* loop, uv_run_mode mode) {
     uv__update_time(loop);
 
   while (r != 0 && loop->stop_flag == 0) {
+    UV__RUN_PHASE(loop, 0);
     uv__update_time(loop);
     uv__run_timers(loop);
+    UV__RUN_PHASE(loop, 1);
     ran_pending = uv__run_pending(loop);
+    UV__RUN_PHASE(loop, 2);
     uv__run_idle(loop);
+    UV__RUN_PHASE(loop, 3);
     uv__run_prepare(loop);
 
     timeout = 0;
     if ((mode == UV_RUN_ONCE && !ran_pending) || mode == UV_RUN_DEFAULT)
       timeout = uv_backend_timeout(loop);
 
+    UV__RUN_PHASE(loop, 4);
     uv__io_poll(loop, timeout);
+    UV__RUN_PHASE(loop, 5);
     uv__run_check(loop);
+    UV__RUN_PHASE(loop, 6);
     uv__run_closing_handles(loop);
 
     if (mode == UV_RUN_ONCE) {
@@ -372,10 +394,12 @@ int uv_run(uv_loop_t* loop, uv_run_mode mode) {
        * UV_RUN_NOWAIT makes no guarantees about progress so it's omitted from
        * the check.
        */
+      UV__RUN_PHASE(loop, 0);
       uv__update_time(loop);
       uv__run_timers(loop);
     }
 
+    UV__RUN_PHASE(loop, 7);
     r = uv__loop_alive(loop);
     if (mode == UV_RUN_ONCE || mode == UV_RUN_NOWAIT)
       break;
@@ -185,6 +185,13 @@ int uv__io_check_fd(uv_loop_t* loop, int fd) {
 }
 
 
+/* pyuv: optional hooks run around the blocking epoll_wait() call. They are
+ * used to release the GIL only while the loop is blocked for i/o.
+ */
+void (*uv__io_poll_enter_hook)(uv_loop_t* loop, int timeout);
+void (*uv__io_poll_leave_hook)(uv_loop_t* loop, int timeout);
+
+
 void uv__io_poll(uv_loop_t* loop, int timeout) {
   /* A bug in kernels < 2.6.37 makes timeouts larger than ~30 minutes
    * effectively infinite on 32 bits architectures.  To avoid blocking
@@ -277,6 +284,9 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
       if (pthread_sigmask(SIG_BLOCK, &sigset, NULL))
         abort();
 
+    if (uv__io_poll_enter_hook != NULL)
+      uv__io_poll_enter_hook(loop, timeout);
+
     if (no_epoll_wait != 0 || (sigmask != 0 && no_epoll_pwait == 0)) {
       nfds = uv__epoll_pwait(loop->backend_fd,
                              events,
@@ -294,6 +304,9 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
         no_epoll_wait = 1;
     }
 
+    if (uv__io_poll_leave_hook != NULL)
+      SAVE_ERRNO(uv__io_poll_leave_hook(loop, timeout));
+
     if (sigmask != 0 && no_epoll_pwait != 0)
       if (pthread_sigmask(SIG_UNBLOCK, &sigset, NULL))
         abort();
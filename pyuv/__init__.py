@@ -1,4 +1,5 @@
 
 from ._cpyuv import *
+from ._loopgroup import AcceptDispatcher, AcceptWorker, LoopGroup
 from ._version import __version__
 
@@ -0,0 +1,287 @@
+
+import functools
+import os
+import socket
+import threading
+import time
+
+from collections import namedtuple
+
+from ._cpyuv import Async, Check, Loop, Pipe, TCP, UV_TCP, UV_TCP_REUSEPORT, UV_UNKNOWN_HANDLE
+from ._cpyuv import errno, error
+
+
+__all__ = ['AcceptDispatcher', 'AcceptWorker', 'LoopGroup']
+
+
+_clock = getattr(time, 'monotonic', time.time)
+
+loop_load_result = namedtuple('loop_load_result', ['index', 'connections', 'callbacks', 'busy'])
+
+
+class LoopGroup(object):
+    """Run a number of event loops, each one in its own thread.
+
+    Listening addresses are bound by every loop with SO_REUSEPORT, so the
+    kernel spreads incoming connections among them.
+    """
+
+    def __init__(self, size):
+        if size < 1:
+            raise ValueError('size must be at least 1')
+        self.loops = [Loop() for _ in range(size)]
+        self.servers = [[] for _ in range(size)]
+        self._connections = [0] * size
+        self._samples = [(0.0, 0.0)] * size
+        self._stoppers = []
+        self._threads = []
+        for loop in self.loops:
+            loop.metrics_enabled = True
+
+    @property
+    def running(self):
+        return any(thread.is_alive() for thread in self._threads)
+
+    def listen(self, address, callback, backlog=511):
+        """Bind a TCP server to address in every loop. If the port is 0, the
+        one picked for the first loop is used for the rest of them. Returns the
+        bound address."""
+        if self._threads:
+            raise RuntimeError('LoopGroup was already started')
+        for index, loop in enumerate(self.loops):
+            server = TCP(loop)
+            server.bind(address, UV_TCP_REUSEPORT)
+            server.listen(functools.partial(self._on_connection, index, callback), backlog)
+            self.servers[index].append(server)
+            address = server.getsockname()
+        return address
+
+    def dispatch(self, loop, address, callback, policy='round-robin', backlog=511):
+        """Listen on address from loop, which runs in the calling thread, and
+        hand every accepted connection to one of the group loops, see
+        AcceptDispatcher. callback is called with the AcceptWorker and the
+        connection in the group loop which received it. Returns the
+        AcceptDispatcher."""
+        if self._threads:
+            raise RuntimeError('LoopGroup was already started')
+        pipes = []
+        for index, worker_loop in enumerate(self.loops):
+            master_fd, worker_fd = _ipc_pair()
+            pipe = Pipe(loop, True)
+            pipe.open(master_fd)
+            pipes.append(pipe)
+            worker_pipe = Pipe(worker_loop, True)
+            worker_pipe.open(worker_fd)
+            AcceptWorker(worker_pipe, functools.partial(self._on_dispatched, index, callback))
+        server = TCP(loop)
+        server.bind(address)
+        return AcceptDispatcher(server, pipes, policy, backlog)
+
+    def start(self, setup=None):
+        """Start running the loops. setup is called with every loop and its index
+        before the loop starts running, in the calling thread."""
+        if self._threads:
+            raise RuntimeError('LoopGroup was already started')
+        for index, loop in enumerate(self.loops):
+            if setup is not None:
+                setup(loop, index)
+            self._stoppers.append(Async(loop, self._on_stop))
+        now = _clock()
+        for index, loop in enumerate(self.loops):
+            self._samples[index] = (now, loop.metrics.callback_time)
+            thread = threading.Thread(target=loop.run, name='LoopGroup-%d' % index)
+            thread.daemon = True
+            self._threads.append(thread)
+            thread.start()
+
+    def stop(self, timeout=None):
+        """Close all handles in every loop and wait for the threads to finish."""
+        for stopper in self._stoppers:
+            if not stopper.closed:
+                stopper.send()
+        for thread in self._threads:
+            thread.join(timeout)
+
+    def load(self):
+        """Return a loop_load_result for every loop. busy is the fraction of
+        time spent running callbacks since the previous call, or since the
+        group was started."""
+        now = _clock()
+        result = []
+        for index, loop in enumerate(self.loops):
+            metrics = loop.metrics
+            then, callback_time = self._samples[index]
+            busy = (metrics.callback_time - callback_time) / (now - then) if now > then else 0.0
+            self._samples[index] = (now, metrics.callback_time)
+            result.append(loop_load_result(index, self._connections[index], metrics.callbacks, min(busy, 1.0)))
+        return result
+
+    def _on_connection(self, index, callback, server, error):
+        if error is None:
+            self._connections[index] += 1
+        callback(server, error)
+
+    def _on_dispatched(self, index, callback, worker, connection):
+        self._connections[index] += 1
+        callback(worker, connection)
+
+    @staticmethod
+    def _on_stop(handle):
+        for h in handle.loop.handles:
+            if not h.closed:
+                h.close()
+
+
+class AcceptDispatcher(object):
+    """Accept connections on a bound TCP handle and hand them to workers over
+    IPC pipes, either in turns ('round-robin') or to the one with the fewest
+    connections which weren't released yet ('least-loaded'). Connections
+    accepted during a loop iteration are sent together, with all their fds in
+    a single SCM_RIGHTS message for each worker.
+    """
+
+    policies = ('round-robin', 'least-loaded')
+
+    def __init__(self, server, pipes, policy='round-robin', backlog=511):
+        if policy not in self.policies:
+            raise ValueError('policy must be one of %s' % ', '.join(self.policies))
+        if not pipes:
+            raise ValueError('at least one pipe is required')
+        self.server = server
+        self.loop = server.loop
+        self.pipes = list(pipes)
+        self.policy = policy
+        self.dispatched = [0] * len(self.pipes)
+        self.active = [0] * len(self.pipes)
+        self._pending = [[] for _ in self.pipes]
+        self._next = 0
+        self._check = Check(self.loop)
+        for index, pipe in enumerate(self.pipes):
+            pipe.start_read(functools.partial(self._on_pipe_read, index))
+        server.listen(self._on_connection, backlog)
+
+    def close(self):
+        """Stop accepting connections and close the server and the pipes."""
+        for handle in [self.server, self._check] + self.pipes:
+            if not handle.closed:
+                handle.close()
+        for handles in self._pending:
+            for handle in handles:
+                handle.close()
+            del handles[:]
+
+    def _select(self):
+        count = len(self.pipes)
+        candidates = [i for i in range(count) if not self.pipes[i].closed]
+        if not candidates:
+            return None
+        if self.policy == 'least-loaded':
+            index = min(candidates, key=lambda i: (self.active[i], (i - self._next) % count))
+        else:
+            index = min(candidates, key=lambda i: (i - self._next) % count)
+        self._next = (index + 1) % count
+        return index
+
+    def _on_connection(self, server, error):
+        if error is not None:
+            return
+        connection = TCP(self.loop)
+        server.accept(connection)
+        index = self._select()
+        if index is None:
+            connection.close()
+            return
+        self._pending[index].append(connection)
+        self.dispatched[index] += 1
+        self.active[index] += 1
+        if not self._check.active:
+            self._check.start(self._flush)
+
+    def _flush(self, check):
+        check.stop()
+        for index, handles in enumerate(self._pending):
+            if handles:
+                self._pending[index] = []
+                self._send(index, handles)
+
+    def _send(self, index, handles):
+        pipe = self.pipes[index]
+        while handles:
+            batch, handles = handles[:_MAX_SEND_HANDLES], handles[_MAX_SEND_HANDLES:]
+            try:
+                pipe.try_send_handles(b'.', batch)
+            except error.PipeError as e:
+                if e.args[0] != errno.UV_EAGAIN:
+                    self._drop(index, batch + handles)
+                    return
+                # writes are pending, queue the rest after them
+                for handle in batch + handles:
+                    pipe.write(b'.', functools.partial(self._on_write, index, handle), handle)
+                return
+            # the worker got its own fds
+            for handle in batch:
+                handle.close()
+
+    def _drop(self, index, handles):
+        for handle in handles:
+            handle.close()
+        self.active[index] = max(0, self.active[index] - len(handles))
+
+    def _on_write(self, index, connection, pipe, error):
+        connection.close()
+        if error is not None:
+            self.active[index] = max(0, self.active[index] - 1)
+
+    def _on_pipe_read(self, index, pipe, data, error):
+        if error is not None:
+            pipe.close()
+            return
+        # every byte sent back by the worker releases a connection
+        self.active[index] = max(0, self.active[index] - len(data))
+
+
+class AcceptWorker(object):
+    """Receive connections sent by an AcceptDispatcher over an IPC pipe.
+    callback is called with the worker and every connection. release should
+    be called once a connection is done, for the 'least-loaded' policy.
+    """
+
+    def __init__(self, pipe, callback):
+        self.pipe = pipe
+        self.loop = pipe.loop
+        self.callback = callback
+        pipe.start_read(self._on_read)
+
+    def release(self, count=1):
+        """Tell the dispatcher count connections were finished."""
+        if not self.pipe.closed:
+            self.pipe.write(b'\0' * count)
+
+    def close(self):
+        if not self.pipe.closed:
+            self.pipe.close()
+
+    def _on_read(self, pipe, data, error):
+        if error is not None:
+            pipe.close()
+            return
+        while pipe.pending_count():
+            if pipe.pending_handle_type() == UV_TCP:
+                connection = TCP(self.loop)
+            else:
+                connection = Pipe(self.loop)
+            pipe.accept(connection)
+            self.callback(self, connection)
+
+
+# libuv receives up to 64 fds in a message
+_MAX_SEND_HANDLES = 64
+
+
+def _ipc_pair():
+    a, b = socket.socketpair(socket.AF_UNIX, socket.SOCK_STREAM)
+    try:
+        return os.dup(a.fileno()), os.dup(b.fileno())
+    finally:
+        a.close()
+        b.close()
@@ -136,6 +136,8 @@ class libuv_build_ext(build_ext):
             self.compiler.add_include_dir(os.path.join(self.libuv_dir, 'include'))
             self.compiler.add_include_dir(os.path.join(self.libuv_dir, 'src'))
             self.extensions[0].sources += SOURCES
+            if sys.platform.startswith('linux'):
+                self.compiler.define_macro('PYUV_LIBUV_POLL_HOOKS', 1)
 
         if sys.platform != 'win32':
             self.compiler.define_macro('_LARGEFILE_SOURCE', 1)
@@ -20,9 +20,10 @@ pyuv__deallocate_handle_data(uv_handle_t *handle)
 static void
 pyuv__pipe_connect_abstract_cb(uv_timer_t *timer)
 {
-    PyGILState_STATE gstate = PyGILState_Ensure();
+    gil_state gstate = pyuv__gil_ensure(timer->loop);
     PyObject *result, *error;
     abstract_connect_req *req;
+    uint64_t start;
 
     ASSERT(timer != NULL);
     req = (abstract_connect_req *) timer->data;
@@ -30,7 +31,9 @@ pyuv__pipe_connect_abstract_cb(uv_timer_t *timer)
     error = Py_None;
     Py_INCREF(error);
 
+    start = pyuv__handle_call_start(HANDLE(req->pipe));
     result = PyObject_CallFunctionObjArgs(req->callback, req->pipe, error, NULL);
+    pyuv__handle_call_end(HANDLE(req->pipe), req->callback, start);
     if (result == NULL) {
         handle_uncaught_exception(HANDLE(req->pipe)->loop);
     }
@@ -43,7 +46,7 @@ pyuv__pipe_connect_abstract_cb(uv_timer_t *timer)
 
     uv_close((uv_handle_t *) &req->timer, pyuv__deallocate_handle_data);
 
-    PyGILState_Release(gstate);
+    pyuv__gil_release(gstate);
 }
 
 
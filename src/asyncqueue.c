@@ -0,0 +1,321 @@
+
+/* AsyncQueue
+ *
+ * An async handle carrying a payload queue. Producers on any thread push
+ * nodes onto a lock-free stack with a compare-and-swap, the loop takes the
+ * whole stack at once with an atomic exchange and reverses it, so items are
+ * delivered in the order they were put. There is a single consumer and it
+ * never pops individual nodes, so the stack is not subject to ABA problems.
+ * Byte payloads are copied into the node, pushing them doesn't involve any
+ * Python object.
+ */
+
+static void
+pyuv__async_queue_push(AsyncQueue *self, async_queue_node *node)
+{
+    async_queue_node *head;
+
+    do {
+        head = self->head;
+        node->next = head;
+    } while (!PYUV_ATOMIC_CAS_PTR(&self->head, head, node));
+}
+
+
+/* Take all queued nodes, oldest first */
+static async_queue_node *
+pyuv__async_queue_take(AsyncQueue *self)
+{
+    async_queue_node *node, *next, *result;
+
+    node = PYUV_ATOMIC_XCHG_PTR(&self->head, NULL);
+
+    result = NULL;
+    while (node != NULL) {
+        next = node->next;
+        node->next = result;
+        result = node;
+        node = next;
+    }
+
+    return result;
+}
+
+
+static void
+pyuv__async_queue_free(async_queue_node *node)
+{
+    async_queue_node *next;
+
+    while (node != NULL) {
+        next = node->next;
+        Py_XDECREF(node->obj);
+        free(node);
+        node = next;
+    }
+}
+
+
+static void
+pyuv__async_queue_cb(uv_async_t *handle)
+{
+    gil_state gstate = pyuv__gil_ensure(handle->loop);
+    AsyncQueue *self;
+    async_queue_node *nodes, *node;
+    PyObject *result, *items, *item;
+    Py_ssize_t i, count;
+    uint64_t start;
+
+    ASSERT(handle);
+    self = PYUV_CONTAINER_OF(handle, AsyncQueue, async_h);
+
+    nodes = pyuv__async_queue_take(self);
+    if (nodes == NULL) {
+        goto done;
+    }
+
+    count = 0;
+    for (node = nodes; node != NULL; node = node->next) {
+        count++;
+    }
+
+    items = PyList_New(count);
+    if (items == NULL) {
+        pyuv__async_queue_free(nodes);
+        handle_uncaught_exception(HANDLE(self)->loop);
+        goto done;
+    }
+
+    for (i = 0, node = nodes; node != NULL; i++, node = node->next) {
+        if (node->obj != NULL) {
+            item = node->obj;
+            node->obj = NULL;
+        } else {
+            pyuv__handle_stats_read(HANDLE(self), node->len);
+            item = PyBytes_FromStringAndSize(node->data, node->len);
+            if (item == NULL) {
+                PyErr_Clear();
+                PYUV_SET_NONE(item);
+            }
+        }
+        PyList_SET_ITEM(items, i, item);
+    }
+    pyuv__async_queue_free(nodes);
+
+    /* Object could go out of scope in the callback, increase refcount to avoid it */
+    Py_INCREF(self);
+
+    start = pyuv__handle_call_start(HANDLE(self));
+    result = PyObject_CallFunctionObjArgs(self->callback, self, items, NULL);
+    pyuv__handle_call_end(HANDLE(self), self->callback, start);
+    if (result == NULL) {
+        handle_uncaught_exception(HANDLE(self)->loop);
+    }
+    Py_XDECREF(result);
+    Py_DECREF(items);
+
+    Py_DECREF(self);
+
+done:
+    pyuv__gil_release(gstate);
+}
+
+
+static PyObject *
+AsyncQueue_func_put(AsyncQueue *self, PyObject *obj)
+{
+    int err;
+    async_queue_node *node;
+
+    RAISE_IF_HANDLE_NOT_INITIALIZED(self, NULL);
+    RAISE_IF_HANDLE_CLOSED(self, PyExc_HandleClosedError, NULL);
+
+    node = malloc(sizeof *node);
+    if (node == NULL) {
+        return PyErr_NoMemory();
+    }
+    Py_INCREF(obj);
+    node->obj = obj;
+    node->len = 0;
+
+    pyuv__async_queue_push(self, node);
+
+    err = uv_async_send(&self->async_h);
+    if (err < 0) {
+        RAISE_UV_EXCEPTION(err, PyExc_AsyncError);
+        return NULL;
+    }
+
+    Py_RETURN_NONE;
+}
+
+
+static PyObject *
+AsyncQueue_func_put_bytes(AsyncQueue *self, PyObject *args)
+{
+    int err;
+    Py_buffer view;
+    async_queue_node *node;
+
+    RAISE_IF_HANDLE_NOT_INITIALIZED(self, NULL);
+    RAISE_IF_HANDLE_CLOSED(self, PyExc_HandleClosedError, NULL);
+
+    if (!PyArg_ParseTuple(args, PYUV_BYTES"*:put_bytes", &view)) {
+        return NULL;
+    }
+
+    node = malloc(offsetof(async_queue_node, data) + (view.len > 0 ? view.len : 1));
+    if (node == NULL) {
+        PyBuffer_Release(&view);
+        return PyErr_NoMemory();
+    }
+    node->obj = NULL;
+    node->len = (size_t)view.len;
+
+    if (view.len >= PYUV_ASYNC_QUEUE_NOGIL_SIZE) {
+        Py_BEGIN_ALLOW_THREADS
+        memcpy(node->data, view.buf, node->len);
+        pyuv__async_queue_push(self, node);
+        err = uv_async_send(&self->async_h);
+        Py_END_ALLOW_THREADS
+    } else {
+        memcpy(node->data, view.buf, node->len);
+        pyuv__async_queue_push(self, node);
+        err = uv_async_send(&self->async_h);
+    }
+    PyBuffer_Release(&view);
+
+    if (err < 0) {
+        RAISE_UV_EXCEPTION(err, PyExc_AsyncError);
+        return NULL;
+    }
+
+    Py_RETURN_NONE;
+}
+
+
+static int
+AsyncQueue_tp_init(AsyncQueue *self, PyObject *args, PyObject *kwargs)
+{
+    int err;
+    Loop *loop;
+    PyObject *callback;
+
+    UNUSED_ARG(kwargs);
+    RAISE_IF_HANDLE_INITIALIZED(self, -1);
+
+    if (!PyArg_ParseTuple(args, "O!O:__init__", &LoopType, &loop, &callback)) {
+        return -1;
+    }
+
+    if (!PyCallable_Check(callback)) {
+        PyErr_SetString(PyExc_TypeError, "a callable is required");
+        return -1;
+    }
+
+    err = uv_async_init(loop->uv_loop, &self->async_h, pyuv__async_queue_cb);
+    if (err != 0) {
+        RAISE_UV_EXCEPTION(err, PyExc_AsyncError);
+        return -1;
+    }
+
+    Py_INCREF(callback);
+    self->callback = callback;
+
+    initialize_handle(HANDLE(self), loop);
+
+    return 0;
+}
+
+
+static PyObject *
+AsyncQueue_tp_new(PyTypeObject *type, PyObject *args, PyObject *kwargs)
+{
+    AsyncQueue *self;
+
+    self = (AsyncQueue *)HandleType.tp_new(type, args, kwargs);
+    if (!self) {
+        return NULL;
+    }
+
+    self->async_h.data = self;
+    UV_HANDLE(self) = (uv_handle_t *)&self->async_h;
+    self->head = NULL;
+
+    return (PyObject *)self;
+}
+
+
+static int
+AsyncQueue_tp_traverse(AsyncQueue *self, visitproc visit, void *arg)
+{
+    async_queue_node *node;
+
+    /* nodes are only freed with the GIL held, and objects are only put with it */
+    for (node = self->head; node != NULL; node = node->next) {
+        Py_VISIT(node->obj);
+    }
+    Py_VISIT(self->callback);
+    return HandleType.tp_traverse((PyObject *)self, visit, arg);
+}
+
+
+static int
+AsyncQueue_tp_clear(AsyncQueue *self)
+{
+    /* items which were never delivered */
+    pyuv__async_queue_free(pyuv__async_queue_take(self));
+    Py_CLEAR(self->callback);
+    return HandleType.tp_clear((PyObject *)self);
+}
+
+
+static PyMethodDef
+AsyncQueue_tp_methods[] = {
+    { "put", (PyCFunction)AsyncQueue_func_put, METH_O, "Queue an object to be delivered to the loop." },
+    { "put_bytes", (PyCFunction)AsyncQueue_func_put_bytes, METH_VARARGS, "Queue a copy of the given data to be delivered to the loop." },
+    { NULL }
+};
+
+
+static PyTypeObject AsyncQueueType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "pyuv._cpyuv.AsyncQueue",                                       /*tp_name*/
+    sizeof(AsyncQueue),                                             /*tp_basicsize*/
+    0,                                                              /*tp_itemsize*/
+    0,                                                              /*tp_dealloc*/
+    0,                                                              /*tp_print*/
+    0,                                                              /*tp_getattr*/
+    0,                                                              /*tp_setattr*/
+    0,                                                              /*tp_compare*/
+    0,                                                              /*tp_repr*/
+    0,                                                              /*tp_as_number*/
+    0,                                                              /*tp_as_sequence*/
+    0,                                                              /*tp_as_mapping*/
+    0,                                                              /*tp_hash */
+    0,                                                              /*tp_call*/
+    0,                                                              /*tp_str*/
+    0,                                                              /*tp_getattro*/
+    0,                                                              /*tp_setattro*/
+    0,                                                              /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HAVE_GC,  /*tp_flags*/
+    0,                                                              /*tp_doc*/
+    (traverseproc)AsyncQueue_tp_traverse,                           /*tp_traverse*/
+    (inquiry)AsyncQueue_tp_clear,                                   /*tp_clear*/
+    0,                                                              /*tp_richcompare*/
+    0,                                                              /*tp_weaklistoffset*/
+    0,                                                              /*tp_iter*/
+    0,                                                              /*tp_iternext*/
+    AsyncQueue_tp_methods,                                          /*tp_methods*/
+    0,                                                              /*tp_members*/
+    0,                                                              /*tp_getsets*/
+    0,                                                              /*tp_base*/
+    0,                                                              /*tp_dict*/
+    0,                                                              /*tp_descr_get*/
+    0,                                                              /*tp_descr_set*/
+    0,                                                              /*tp_dictoffset*/
+    (initproc)AsyncQueue_tp_init,                                   /*tp_init*/
+    0,                                                              /*tp_alloc*/
+    AsyncQueue_tp_new,                                              /*tp_new*/
+};
+
@@ -0,0 +1,348 @@
+/* Receive buffer pools
+ *
+ * Each loop keeps a free list of chunks for every power-of-two size between
+ * PYUV_BUFFER_POOL_MIN_SIZE and PYUV_BUFFER_POOL_MAX_SIZE. Reads get a chunk of
+ * the size requested by the handle (or the loop default) and give it back once
+ * the data has been delivered, so concurrent or re-entrant reads never run out
+ * of buffer space. At most max_free idle chunks are kept per size class.
+ *
+ * Chunks are taken from the alloc callback, without the GIL held, and may be
+ * given back by a Buffer object released from any thread, so the pool has its
+ * own lock and doesn't use the Python allocator.
+ */
+
+
+static int
+pyuv__buffer_pool_init(buffer_pool *pool)
+{
+    memset(pool, 0, sizeof *pool);
+    pool->chunk_size = PYUV_SLAB_SIZE;
+    pool->max_free = PYUV_BUFFER_POOL_MAX_FREE;
+    return uv_mutex_init(&pool->lock);
+}
+
+
+/* Returns the size class index for the given size, or -1 if it's too big */
+static int
+pyuv__buffer_pool_class(size_t size)
+{
+    int i;
+
+    for (i = 0; i < PYUV_BUFFER_POOL_CLASSES; i++) {
+        if (size <= (PYUV_BUFFER_POOL_MIN_SIZE << i)) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+
+/* Round the given size up to the chunk size of its class */
+static size_t
+pyuv__buffer_pool_round(size_t size)
+{
+    int i = pyuv__buffer_pool_class(size);
+    ASSERT(i >= 0);
+    return PYUV_BUFFER_POOL_MIN_SIZE << i;
+}
+
+
+static char *
+pyuv__buffer_pool_get(buffer_pool *pool, size_t size)
+{
+    int i;
+    buffer_pool_class *cls;
+    buffer_pool_chunk *chunk;
+
+    i = pyuv__buffer_pool_class(size);
+    ASSERT(i >= 0);
+    cls = &pool->classes[i];
+
+    uv_mutex_lock(&pool->lock);
+    chunk = cls->free_list;
+    if (chunk != NULL) {
+        cls->free_list = chunk->next;
+        cls->free_count--;
+    }
+    cls->in_use++;
+    uv_mutex_unlock(&pool->lock);
+
+    if (chunk == NULL) {
+        chunk = malloc(PYUV_BUFFER_POOL_MIN_SIZE << i);
+        if (chunk == NULL) {
+            uv_mutex_lock(&pool->lock);
+            cls->in_use--;
+            uv_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+    }
+
+    return (char *)chunk;
+}
+
+
+static void
+pyuv__buffer_pool_put(buffer_pool *pool, char *base, size_t size)
+{
+    int i;
+    buffer_pool_class *cls;
+    buffer_pool_chunk *chunk;
+
+    i = pyuv__buffer_pool_class(size);
+    ASSERT(i >= 0);
+    cls = &pool->classes[i];
+
+    uv_mutex_lock(&pool->lock);
+    ASSERT(cls->in_use > 0);
+    cls->in_use--;
+    if (cls->free_count < pool->max_free) {
+        chunk = (buffer_pool_chunk *)base;
+        chunk->next = cls->free_list;
+        cls->free_list = chunk;
+        cls->free_count++;
+        base = NULL;
+    }
+    uv_mutex_unlock(&pool->lock);
+
+    free(base);
+}
+
+
+/* Release idle chunks until every class holds at most max_free of them */
+static void
+pyuv__buffer_pool_trim(buffer_pool *pool, size_t max_free)
+{
+    int i;
+    buffer_pool_class *cls;
+    buffer_pool_chunk *chunk;
+
+    uv_mutex_lock(&pool->lock);
+    for (i = 0; i < PYUV_BUFFER_POOL_CLASSES; i++) {
+        cls = &pool->classes[i];
+        while (cls->free_count > max_free) {
+            chunk = cls->free_list;
+            cls->free_list = chunk->next;
+            cls->free_count--;
+            free(chunk);
+        }
+    }
+    uv_mutex_unlock(&pool->lock);
+}
+
+
+static void
+pyuv__buffer_pool_destroy(buffer_pool *pool)
+{
+    pyuv__buffer_pool_trim(pool, 0);
+    uv_mutex_destroy(&pool->lock);
+}
+
+
+static void
+pyuv__alloc_cb(uv_handle_t* handle, size_t suggested_size, uv_buf_t *buf)
+{
+    Loop *loop;
+    Handle *self;
+    size_t size;
+
+    UNUSED_ARG(suggested_size);
+
+    loop = handle->loop->data;
+    ASSERT(loop);
+    self = handle->data;
+    ASSERT(self);
+
+    size = self->read_buffer_size ? self->read_buffer_size : loop->buffer_pool.chunk_size;
+
+    buf->base = pyuv__buffer_pool_get(&loop->buffer_pool, size);
+    buf->len = buf->base != NULL ? size : 0;
+}
+
+
+/* Give the buffer handed out by pyuv__alloc_cb back to the loop's pool */
+static void
+pyuv__alloc_release(uv_handle_t* handle, const uv_buf_t *buf)
+{
+    Loop *loop;
+
+    if (buf->base == NULL) {
+        return;
+    }
+
+    loop = handle->loop->data;
+    ASSERT(loop);
+
+    pyuv__buffer_pool_put(&loop->buffer_pool, buf->base, buf->len);
+}
+
+
+/* Wrap the data read into a buffer handed out by pyuv__alloc_cb, the chunk is owned
+ * by the returned object. If it can't be created the chunk is returned to the pool. */
+static PyObject *
+pyuv__alloc_to_buffer(uv_handle_t* handle, const uv_buf_t *buf, Py_ssize_t nread)
+{
+    Buffer *self;
+    Loop *loop;
+
+    loop = handle->loop->data;
+    ASSERT(loop);
+
+    self = PyObject_New(Buffer, &BufferType);
+    if (!self) {
+        pyuv__alloc_release(handle, buf);
+        return NULL;
+    }
+
+    Py_INCREF(loop);
+    self->loop = loop;
+    self->base = buf->base;
+    self->size = buf->len;
+    self->len = nread;
+    self->exports = 0;
+
+    return (PyObject *)self;
+}
+
+
+static void
+pyuv__buffer_release_chunk(Buffer *self)
+{
+    if (self->base != NULL) {
+        pyuv__buffer_pool_put(&self->loop->buffer_pool, self->base, self->size);
+        self->base = NULL;
+        self->len = 0;
+    }
+}
+
+
+static PyObject *
+Buffer_func_release(Buffer *self)
+{
+    if (self->exports > 0) {
+        PyErr_SetString(PyExc_BufferError, "cannot release a buffer with active exports");
+        return NULL;
+    }
+
+    pyuv__buffer_release_chunk(self);
+
+    Py_RETURN_NONE;
+}
+
+
+static PyObject *
+Buffer_released_get(Buffer *self, void *closure)
+{
+    UNUSED_ARG(closure);
+    return PyBool_FromLong((long)(self->base == NULL));
+}
+
+
+static Py_ssize_t
+Buffer_sq_length(Buffer *self)
+{
+    return self->len;
+}
+
+
+static int
+Buffer_bf_getbuffer(Buffer *self, Py_buffer *view, int flags)
+{
+    int r;
+
+    if (self->base == NULL) {
+        PyErr_SetString(PyExc_ValueError, "operation forbidden on released buffer object");
+        return -1;
+    }
+
+    r = PyBuffer_FillInfo(view, (PyObject *)self, self->base, self->len, 0, flags);
+    if (r == 0) {
+        self->exports++;
+    }
+    return r;
+}
+
+
+static void
+Buffer_bf_releasebuffer(Buffer *self, Py_buffer *view)
+{
+    UNUSED_ARG(view);
+    self->exports--;
+}
+
+
+static void
+Buffer_tp_dealloc(Buffer *self)
+{
+    pyuv__buffer_release_chunk(self);
+    Py_DECREF(self->loop);
+    PyObject_Del(self);
+}
+
+
+static PyMethodDef
+Buffer_tp_methods[] = {
+    { "release", (PyCFunction)Buffer_func_release, METH_NOARGS, "Return the underlying memory chunk to the loop's buffer pool." },
+    { NULL }
+};
+
+
+static PyGetSetDef Buffer_tp_getsets[] = {
+    {"released", (getter)Buffer_released_get, NULL, "Indicates if the memory was already returned to the pool.", NULL},
+    {NULL}
+};
+
+
+static PySequenceMethods Buffer_tp_as_sequence = {
+    (lenfunc)Buffer_sq_length,                                      /*sq_length*/
+};
+
+
+static PyBufferProcs Buffer_tp_as_buffer = {
+#ifndef PYUV_PYTHON3
+    0,                                                              /*bf_getreadbuffer*/
+    0,                                                              /*bf_getwritebuffer*/
+    0,                                                              /*bf_getsegcount*/
+    0,                                                              /*bf_getcharbuffer*/
+#endif
+    (getbufferproc)Buffer_bf_getbuffer,                             /*bf_getbuffer*/
+    (releasebufferproc)Buffer_bf_releasebuffer,                     /*bf_releasebuffer*/
+};
+
+
+static PyTypeObject BufferType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "pyuv._cpyuv.Buffer",                                           /*tp_name*/
+    sizeof(Buffer),                                                 /*tp_basicsize*/
+    0,                                                              /*tp_itemsize*/
+    (destructor)Buffer_tp_dealloc,                                  /*tp_dealloc*/
+    0,                                                              /*tp_print*/
+    0,                                                              /*tp_getattr*/
+    0,                                                              /*tp_setattr*/
+    0,                                                              /*tp_compare*/
+    0,                                                              /*tp_repr*/
+    0,                                                              /*tp_as_number*/
+    &Buffer_tp_as_sequence,                                         /*tp_as_sequence*/
+    0,                                                              /*tp_as_mapping*/
+    0,                                                              /*tp_hash */
+    0,                                                              /*tp_call*/
+    0,                                                              /*tp_str*/
+    0,                                                              /*tp_getattro*/
+    0,                                                              /*tp_setattro*/
+    &Buffer_tp_as_buffer,                                           /*tp_as_buffer*/
+#ifdef PYUV_PYTHON3
+    Py_TPFLAGS_DEFAULT,                                             /*tp_flags*/
+#else
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER,                 /*tp_flags*/
+#endif
+    0,                                                              /*tp_doc*/
+    0,                                                              /*tp_traverse*/
+    0,                                                              /*tp_clear*/
+    0,                                                              /*tp_richcompare*/
+    0,                                                              /*tp_weaklistoffset*/
+    0,                                                              /*tp_iter*/
+    0,                                                              /*tp_iternext*/
+    Buffer_tp_methods,                                              /*tp_methods*/
+    0,                                                              /*tp_members*/
+    Buffer_tp_getsets,                                              /*tp_getsets*/
+};
@@ -2,9 +2,10 @@
 static void
 pyuv__check_cb(uv_check_t *handle)
 {
-    PyGILState_STATE gstate = PyGILState_Ensure();
+    gil_state gstate = pyuv__gil_ensure(handle->loop);
     Check *self;
     PyObject *result;
+    uint64_t start;
 
     ASSERT(handle);
     self = PYUV_CONTAINER_OF(handle, Check, check_h);
@@ -12,14 +13,16 @@ pyuv__check_cb(uv_check_t *handle)
     /* Object could go out of scope in the callback, increase refcount to avoid it */
     Py_INCREF(self);
 
+    start = pyuv__handle_call_start(HANDLE(self));
     result = PyObject_CallFunctionObjArgs(self->callback, self, NULL);
+    pyuv__handle_call_end(HANDLE(self), self->callback, start);
     if (result == NULL) {
         handle_uncaught_exception(HANDLE(self)->loop);
     }
     Py_XDECREF(result);
 
     Py_DECREF(self);
-    PyGILState_Release(gstate);
+    pyuv__gil_release(gstate);
 }
 
 
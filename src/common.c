@@ -231,6 +231,56 @@ makesockaddr(struct sockaddr *addr)
 }
 
 
+#ifdef PYUV_EMULATE_REUSEPORT
+/* Enable SO_REUSEPORT on a TCP or UDP handle before it's bound. libuv creates
+ * the socket in bind itself, so if the handle has none yet one is created here
+ * and opened on the handle, libuv then binds it as usual. */
+static int
+pyuv__set_reuseport(uv_handle_t *handle, int family)
+{
+#ifdef SO_REUSEPORT
+    int err, fd, on, type;
+    uv_os_fd_t handle_fd;
+
+    err = uv_fileno(handle, &handle_fd);
+    if (err == 0) {
+        fd = handle_fd;
+    } else if (err == UV_EBADF) {
+        type = handle->type == UV_TCP ? SOCK_STREAM : SOCK_DGRAM;
+#ifdef SOCK_CLOEXEC
+        type |= SOCK_CLOEXEC;
+#endif
+        fd = socket(family, type, 0);
+        if (fd < 0) {
+            return -errno;
+        }
+        if (handle->type == UV_TCP) {
+            err = uv_tcp_open((uv_tcp_t *)handle, fd);
+        } else {
+            err = uv_udp_open((uv_udp_t *)handle, fd);
+        }
+        if (err < 0) {
+            close(fd);
+            return err;
+        }
+    } else {
+        return err;
+    }
+
+    on = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof on) < 0) {
+        return -errno;
+    }
+    return 0;
+#else
+    UNUSED_ARG(handle);
+    UNUSED_ARG(family);
+    return UV_ENOTSUP;
+#endif
+}
+#endif
+
+
 /* handle uncausht exception in a callback */
 static void
 handle_uncaught_exception(Loop *loop)
@@ -282,21 +332,3 @@ handle_uncaught_exception(Loop *loop)
     }
 }
 
-
-static void
-pyuv__alloc_cb(uv_handle_t* handle, size_t suggested_size, uv_buf_t *buf)
-{
-    Loop *loop;
-    loop = handle->loop->data;
-    ASSERT(loop);
-
-    if (loop->buffer.in_use) {
-        buf->base = NULL;
-        buf->len = 0;
-    } else {
-        buf->base = loop->buffer.slab;
-        buf->len = sizeof(loop->buffer.slab);
-        loop->buffer.in_use = True;
-    }
-}
-
@@ -46,10 +46,11 @@ pyuv__getaddrinfo_process_result(int status, struct addrinfo* res, PyObject** dn
 static void
 pyuv__getaddrinfo_cb(uv_getaddrinfo_t* req, int status, struct addrinfo* res)
 {
-    PyGILState_STATE gstate = PyGILState_Ensure();
+    gil_state gstate = pyuv__gil_ensure(req->loop);
     Loop *loop;
     GAIRequest *gai_req;
     PyObject *errorno, *dns_result, *result;
+    uint64_t start;
     int err;
 
     ASSERT(req);
@@ -67,7 +68,9 @@ pyuv__getaddrinfo_cb(uv_getaddrinfo_t* req, int status, struct addrinfo* res)
         PYUV_SET_NONE(dns_result);
     }
 
+    start = pyuv__loop_call_start(loop);
     result = PyObject_CallFunctionObjArgs(gai_req->callback, dns_result, errorno, NULL);
+    pyuv__loop_call_end(loop, (PyObject *)gai_req, gai_req->callback, start);
     if (result == NULL) {
         handle_uncaught_exception(loop);
     }
@@ -79,7 +82,7 @@ pyuv__getaddrinfo_cb(uv_getaddrinfo_t* req, int status, struct addrinfo* res)
     UV_REQUEST(gai_req) = NULL;
     Py_DECREF(gai_req);
 
-    PyGILState_Release(gstate);
+    pyuv__gil_release(gstate);
 }
 
 
@@ -102,10 +105,11 @@ pyuv__getnameinfo_process_result(int status, const char *hostname, const char*se
 static void
 pyuv__getnameinfo_cb(uv_getnameinfo_t* req, int status, const char *hostname, const char *service)
 {
-    PyGILState_STATE gstate = PyGILState_Ensure();
+    gil_state gstate = pyuv__gil_ensure(req->loop);
     Loop *loop;
     GNIRequest *gni_req;
     PyObject *errorno, *gni_result, *result;
+    uint64_t start;
     int err;
 
     ASSERT(req);
@@ -121,7 +125,9 @@ pyuv__getnameinfo_cb(uv_getnameinfo_t* req, int status, const char *hostname, co
         PYUV_SET_NONE(gni_result);
     }
 
+    start = pyuv__loop_call_start(loop);
     result = PyObject_CallFunctionObjArgs(gni_req->callback, gni_result, errorno, NULL);
+    pyuv__loop_call_end(loop, (PyObject *)gni_req, gni_req->callback, start);
     if (result == NULL) {
         handle_uncaught_exception(loop);
     }
@@ -132,7 +138,7 @@ pyuv__getnameinfo_cb(uv_getnameinfo_t* req, int status, const char *hostname, co
     UV_REQUEST(gni_req) = NULL;
     Py_DECREF(gni_req);
 
-    PyGILState_Release(gstate);
+    pyuv__gil_release(gstate);
 }
 
 
@@ -1,3 +1,8 @@
+#ifndef PYUV_WINDOWS
+#include <dirent.h>
+#include <errno.h>
+#endif
+
 
 /* If true, st_?time is float */
 static int _stat_float_times = 1;
@@ -50,16 +55,115 @@ stat_to_pyobj(const uv_stat_t *st, PyObject *stat_data) {
 }
 
 
+/* Release the caller provided buffers of a vectored read or write request */
+static void
+pyuv__fs_release_views(FSRequest *fs_req)
+{
+    int i;
+
+    for (i = 0; i < fs_req->view_count; i++) {
+        PyBuffer_Release(&fs_req->views[i]);
+    }
+    PyMem_Free(fs_req->views);
+    fs_req->views = NULL;
+    fs_req->view_count = 0;
+}
+
+
+/* Convert the result of a successful request, besides reads */
+static PyObject *
+pyuv__fs_result(uv_fs_t *req)
+{
+    PyObject *r, *item;
+
+    switch (req->fs_type) {
+        case UV_FS_STAT:
+        case UV_FS_LSTAT:
+        case UV_FS_FSTAT:
+            r = PyStructSequence_New(&StatResultType);
+            if (!r) {
+                PyErr_Clear();
+                PYUV_SET_NONE(r);
+            } else {
+                stat_to_pyobj(&req->statbuf, r);
+            }
+            break;
+        case UV_FS_UNLINK:
+        case UV_FS_MKDIR:
+        case UV_FS_RMDIR:
+        case UV_FS_RENAME:
+        case UV_FS_CHMOD:
+        case UV_FS_FCHMOD:
+        case UV_FS_LINK:
+        case UV_FS_SYMLINK:
+        case UV_FS_CHOWN:
+        case UV_FS_FCHOWN:
+        case UV_FS_CLOSE:
+        case UV_FS_FSYNC:
+        case UV_FS_FDATASYNC:
+        case UV_FS_FTRUNCATE:
+        case UV_FS_UTIME:
+        case UV_FS_FUTIME:
+        case UV_FS_ACCESS:
+            PYUV_SET_NONE(r);
+            break;
+        case UV_FS_READLINK:
+        case UV_FS_REALPATH:
+            r = Py_BuildValue("s", req->ptr);
+            if (!r) {
+                PyErr_Clear();
+                PYUV_SET_NONE(r);
+            }
+            break;
+        case UV_FS_WRITE:
+        case UV_FS_OPEN:
+        case UV_FS_SENDFILE:
+            r = PyInt_FromLong((long)req->result);
+            if (!r) {
+                PyErr_Clear();
+                PYUV_SET_NONE(r);
+            }
+            break;
+        case UV_FS_SCANDIR:
+            r = PyList_New(0);
+            if (!r) {
+                PyErr_Clear();
+                PYUV_SET_NONE(r);
+            } else {
+                uv_dirent_t ent;
+                while (uv_fs_scandir_next(req, &ent) != UV_EOF) {
+                    item = PyStructSequence_New(&DirEntType);
+                    if (!item) {
+                        PyErr_Clear();
+                        break;
+                    }
+                    PyStructSequence_SET_ITEM(item, 0, Py_BuildValue("s", ent.name));
+                    PyStructSequence_SET_ITEM(item, 1, PyInt_FromLong((long)ent.type));
+                    PyList_Append(r, item);
+                    Py_DECREF(item);
+                }
+            }
+            break;
+        default:
+            ASSERT(!"unknown fs req type");
+            break;
+    }
+
+    return r;
+}
+
+
 /*
  * NOTE: This function is called either by libuv as a callback or by us when a synchronous
  * operation is performed.
  */
 static void
 pyuv__process_fs_req(uv_fs_t* req) {
-    PyGILState_STATE gstate = PyGILState_Ensure();
+    gil_state gstate = pyuv__gil_ensure(req->loop);
     Loop *loop;
     FSRequest *fs_req;
-    PyObject *result, *errorno, *r, *path, *item;
+    PyObject *result, *errorno, *r, *path;
+    uint64_t start;
 
     ASSERT(req);
     fs_req = PYUV_CONTAINER_OF(req, FSRequest, req);
@@ -77,101 +181,41 @@ pyuv__process_fs_req(uv_fs_t* req) {
     } else {
         PYUV_SET_NONE(errorno);
         switch (req->fs_type) {
-            case UV_FS_STAT:
-            case UV_FS_LSTAT:
-            case UV_FS_FSTAT:
-                r = PyStructSequence_New(&StatResultType);
-                if (!r) {
-                    PyErr_Clear();
-                    PYUV_SET_NONE(r);
-                } else {
-                    stat_to_pyobj(&req->statbuf, r);
-                }
-                break;
-            case UV_FS_UNLINK:
-            case UV_FS_MKDIR:
-            case UV_FS_RMDIR:
-            case UV_FS_RENAME:
-            case UV_FS_CHMOD:
-            case UV_FS_FCHMOD:
-            case UV_FS_LINK:
-            case UV_FS_SYMLINK:
-            case UV_FS_CHOWN:
-            case UV_FS_FCHOWN:
-            case UV_FS_CLOSE:
-            case UV_FS_FSYNC:
-            case UV_FS_FDATASYNC:
-            case UV_FS_FTRUNCATE:
-            case UV_FS_UTIME:
-            case UV_FS_FUTIME:
-            case UV_FS_ACCESS:
-                PYUV_SET_NONE(r);
-                break;
-            case UV_FS_READLINK:
-            case UV_FS_REALPATH:
-                r = Py_BuildValue("s", req->ptr);
-                if (!r) {
-                    PyErr_Clear();
-                    PYUV_SET_NONE(r);
-                }
-                break;
-            case UV_FS_WRITE:
-                r = PyInt_FromLong((long)req->result);
-                if (!r) {
-                    PyErr_Clear();
-                    PYUV_SET_NONE(r);
-                }
-                PyBuffer_Release(&fs_req->view);
-                break;
-            case UV_FS_OPEN:
-            case UV_FS_SENDFILE:
-                r = PyInt_FromLong((long)req->result);
-                if (!r) {
-                    PyErr_Clear();
-                    PYUV_SET_NONE(r);
-                }
-                break;
             case UV_FS_READ:
-                r = PyBytes_FromStringAndSize(fs_req->buf.base, req->result);
-                if (!r) {
-                    PyErr_Clear();
-                    PYUV_SET_NONE(r);
+                if (fs_req->views != NULL) {
+                    r = PyInt_FromLong((long)req->result);
+                } else {
+                    r = PyBytes_FromStringAndSize(fs_req->buf.base, req->result);
+                    PyMem_Free(fs_req->buf.base);
                 }
-                PyMem_Free(fs_req->buf.base);
-                break;
-            case UV_FS_SCANDIR:
-                r = PyList_New(0);
                 if (!r) {
                     PyErr_Clear();
                     PYUV_SET_NONE(r);
-                } else {
-                    uv_dirent_t ent;
-                    while (uv_fs_scandir_next(req, &ent) != UV_EOF) {
-                        item = PyStructSequence_New(&DirEntType);
-                        if (!item) {
-                            PyErr_Clear();
-                            break;
-                        }
-                        PyStructSequence_SET_ITEM(item, 0, Py_BuildValue("s", ent.name));
-                        PyStructSequence_SET_ITEM(item, 1, PyInt_FromLong((long)ent.type));
-                        PyList_Append(r, item);
-                        Py_DECREF(item);
-                    }
                 }
                 break;
             default:
-                ASSERT(!"unknown fs req type");
+                r = pyuv__fs_result(req);
                 break;
         }
     }
 
+    if (fs_req->views != NULL) {
+        pyuv__fs_release_views(fs_req);
+    } else if (req->fs_type == UV_FS_WRITE) {
+        PyBuffer_Release(&fs_req->view);
+    } else if (req->fs_type == UV_FS_READ && req->result < 0) {
+        PyMem_Free(fs_req->buf.base);
+    }
+
     /* Save result, path and error in the FSRequest object */
     fs_req->path = path;
     fs_req->result = r;
     fs_req->error = errorno;
 
     if (fs_req->callback != Py_None) {
+        start = pyuv__loop_call_start(loop);
         result = PyObject_CallFunctionObjArgs(fs_req->callback, fs_req, NULL);
+        pyuv__loop_call_end(loop, (PyObject *)fs_req, fs_req->callback, start);
         if (result == NULL) {
             handle_uncaught_exception(loop);
         }
@@ -182,7 +226,7 @@ pyuv__process_fs_req(uv_fs_t* req) {
     UV_REQUEST(fs_req) = NULL;
     Py_DECREF(fs_req);
 
-    PyGILState_Release(gstate);
+    pyuv__gil_release(gstate);
 }
 
 
@@ -1019,6 +1063,145 @@ FS_func_read(PyObject *obj, PyObject *args, PyObject *kwargs)
 }
 
 
+/* Vectored read or write using caller provided buffers */
+static PyObject *
+pyuv__fs_readwritev(Loop *loop, long fd, PyObject *buffers, int64_t offset, PyObject *callback, Bool write)
+{
+    int err;
+    Py_ssize_t i, count;
+    FSRequest *fs_req;
+    PyObject *buffers_fast, *ret;
+
+    if (callback != Py_None && !PyCallable_Check(callback)) {
+        PyErr_SetString(PyExc_TypeError, "a callable is required");
+        return NULL;
+    }
+
+    buffers_fast = PySequence_Fast(buffers, "buffers must be an iterable");
+    if (buffers_fast == NULL) {
+        return NULL;
+    }
+
+    count = PySequence_Fast_GET_SIZE(buffers_fast);
+    if (count == 0) {
+        PyErr_SetString(PyExc_ValueError, "iterable is empty");
+        Py_DECREF(buffers_fast);
+        return NULL;
+    }
+    if (count > INT_MAX) {
+        PyErr_SetString(PyExc_ValueError, "iterable is too long");
+        Py_DECREF(buffers_fast);
+        return NULL;
+    }
+
+    fs_req = (FSRequest *)PyObject_CallFunctionObjArgs((PyObject *)&FSRequestType, loop, callback, NULL);
+    if (!fs_req) {
+        Py_DECREF(buffers_fast);
+        return NULL;
+    }
+
+    fs_req->views = PyMem_Malloc(sizeof(Py_buffer) * count);
+    if (!fs_req->views) {
+        PyErr_NoMemory();
+        Py_DECREF(buffers_fast);
+        Py_DECREF(fs_req);
+        return NULL;
+    }
+
+    {
+        STACK_ARRAY(uv_buf_t, bufs, count);
+
+        for (i = 0; i < count; i++) {
+            if (PyObject_GetBuffer(PySequence_Fast_GET_ITEM(buffers_fast, i), &fs_req->views[i], write ? PyBUF_SIMPLE : PyBUF_WRITABLE) != 0) {
+                Py_DECREF(buffers_fast);
+                pyuv__fs_release_views(fs_req);
+                Py_DECREF(fs_req);
+                return NULL;
+            }
+            fs_req->view_count++;
+            bufs[i] = uv_buf_init(fs_req->views[i].buf, (unsigned int)fs_req->views[i].len);
+        }
+        Py_DECREF(buffers_fast);
+
+        /* libuv copies the uv_buf_t array, the data goes straight from / to the buffers */
+        if (write) {
+            err = uv_fs_write(loop->uv_loop, &fs_req->req, (uv_file)fd, bufs, (unsigned int)count, offset, (callback != Py_None) ? pyuv__process_fs_req : NULL);
+        } else {
+            err = uv_fs_read(loop->uv_loop, &fs_req->req, (uv_file)fd, bufs, (unsigned int)count, offset, (callback != Py_None) ? pyuv__process_fs_req : NULL);
+        }
+    }
+
+    if (err < 0) {
+        RAISE_UV_EXCEPTION(err, PyExc_FSError);
+        pyuv__fs_release_views(fs_req);
+        Py_DECREF(fs_req);
+        return NULL;
+    }
+
+    Py_INCREF(fs_req);
+    if (callback != Py_None) {
+        /* No need to cleanup, it will be done in the callback */
+        return (PyObject *)fs_req;
+    } else {
+        pyuv__process_fs_req(&fs_req->req);
+        Py_INCREF(fs_req->result);
+        ret = fs_req->result;
+        /* buffer views are released in pyuv__process_fs_req */
+        Py_DECREF(fs_req);
+        return ret;
+    }
+}
+
+
+static PyObject *
+FS_func_readinto(PyObject *obj, PyObject *args, PyObject *kwargs)
+{
+    int64_t offset;
+    long fd;
+    Loop *loop;
+    PyObject *buffer, *buffers, *callback, *ret;
+
+    static char *kwlist[] = {"loop", "fd", "buffer", "offset", "callback", NULL};
+
+    UNUSED_ARG(obj);
+    callback = Py_None;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O!lOL|O:readinto", kwlist, &LoopType, &loop, &fd, &buffer, &offset, &callback)) {
+        return NULL;
+    }
+
+    buffers = PyTuple_Pack(1, buffer);
+    if (!buffers) {
+        return NULL;
+    }
+
+    ret = pyuv__fs_readwritev(loop, fd, buffers, offset, callback, False);
+    Py_DECREF(buffers);
+    return ret;
+}
+
+
+static PyObject *
+FS_func_readv(PyObject *obj, PyObject *args, PyObject *kwargs)
+{
+    int64_t offset;
+    long fd;
+    Loop *loop;
+    PyObject *buffers, *callback;
+
+    static char *kwlist[] = {"loop", "fd", "buffers", "offset", "callback", NULL};
+
+    UNUSED_ARG(obj);
+    callback = Py_None;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O!lOL|O:readv", kwlist, &LoopType, &loop, &fd, &buffers, &offset, &callback)) {
+        return NULL;
+    }
+
+    return pyuv__fs_readwritev(loop, fd, buffers, offset, callback, False);
+}
+
+
 static PyObject *
 FS_func_write(PyObject *obj, PyObject *args, PyObject *kwargs)
 {
@@ -1027,7 +1210,7 @@ FS_func_write(PyObject *obj, PyObject *args, PyObject *kwargs)
     long fd;
     Loop *loop;
     FSRequest *fs_req;
-    PyObject *callback, *ret;
+    PyObject *data, *callback, *ret;
     Py_buffer view;
     uv_buf_t buf;
 
@@ -1037,7 +1220,19 @@ FS_func_write(PyObject *obj, PyObject *args, PyObject *kwargs)
     fs_req = NULL;
     callback = Py_None;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O!l"PYUV_BYTES"*L|O:write", kwlist, &LoopType, &loop, &fd, &view, &offset, &callback)) {
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O!lOL|O:write", kwlist, &LoopType, &loop, &fd, &data, &offset, &callback)) {
+        return NULL;
+    }
+
+    if (!PyObject_CheckBuffer(data)) {
+        if (!PyUnicode_Check(data) && PySequence_Check(data)) {
+            return pyuv__fs_readwritev(loop, fd, data, offset, callback, True);
+        }
+        PyErr_SetString(PyExc_TypeError, "only bytes and sequences are supported");
+        return NULL;
+    }
+
+    if (PyObject_GetBuffer(data, &view, PyBUF_SIMPLE) != 0) {
         return NULL;
     }
 
@@ -1534,6 +1729,1199 @@ FS_func_realpath(PyObject *obj, PyObject *args, PyObject *kwargs)
 }
 
 
+/* Batched operations
+ *
+ * All operations in a batch run one after another in a single threadpool job,
+ * using the synchronous libuv functions, which don't touch the loop. The
+ * results are converted and delivered together with a single callback.
+ */
+
+typedef struct {
+    uv_fs_t req;
+    uv_fs_type type;
+    const char *path;
+    const char *new_path;
+    long fd;
+    int flags;
+    int mode;
+    int64_t offset;
+    char *buf;
+    int length;
+    Bool done;
+} fs_batch_op;
+
+typedef struct {
+    uv_work_t req;
+    Loop *loop;
+    PyObject *callback;
+    /* private snapshot of the operations, it keeps their path strings alive
+     * while the worker uses them, even if the caller changes the sequence */
+    PyObject *ops_tuple;
+    fs_batch_op *ops;
+    Py_ssize_t count;
+} fs_batch_ctx;
+
+static const struct {
+    const char *name;
+    uv_fs_type type;
+} fs_batch_types[] = {
+    { "stat", UV_FS_STAT },
+    { "lstat", UV_FS_LSTAT },
+    { "fstat", UV_FS_FSTAT },
+    { "open", UV_FS_OPEN },
+    { "close", UV_FS_CLOSE },
+    { "read", UV_FS_READ },
+    { "unlink", UV_FS_UNLINK },
+    { "mkdir", UV_FS_MKDIR },
+    { "rmdir", UV_FS_RMDIR },
+    { "rename", UV_FS_RENAME },
+    { "link", UV_FS_LINK },
+    { "chmod", UV_FS_CHMOD },
+    { "fchmod", UV_FS_FCHMOD },
+    { "access", UV_FS_ACCESS },
+    { "readlink", UV_FS_READLINK },
+    { "realpath", UV_FS_REALPATH },
+    { "fsync", UV_FS_FSYNC },
+    { "fdatasync", UV_FS_FDATASYNC },
+    { "ftruncate", UV_FS_FTRUNCATE },
+};
+
+
+static int
+pyuv__fs_batch_parse(fs_batch_op *op, PyObject *item)
+{
+    int r;
+    size_t i;
+    const char *name;
+
+    if (!PyTuple_Check(item) || PyTuple_GET_SIZE(item) < 1) {
+        PyErr_SetString(PyExc_TypeError, "operations must be tuples starting with the operation name");
+        return -1;
+    }
+
+    if (!PyArg_Parse(PyTuple_GET_ITEM(item, 0), "s", &name)) {
+        return -1;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(fs_batch_types); i++) {
+        if (strcmp(name, fs_batch_types[i].name) == 0) {
+            break;
+        }
+    }
+    if (i == ARRAY_SIZE(fs_batch_types)) {
+        PyErr_Format(PyExc_ValueError, "unsupported operation: %s", name);
+        return -1;
+    }
+
+    op->type = fs_batch_types[i].type;
+    switch (op->type) {
+        case UV_FS_STAT:
+        case UV_FS_LSTAT:
+        case UV_FS_UNLINK:
+        case UV_FS_RMDIR:
+        case UV_FS_READLINK:
+        case UV_FS_REALPATH:
+            r = PyArg_ParseTuple(item, "ss", &name, &op->path);
+            break;
+        case UV_FS_FSTAT:
+        case UV_FS_CLOSE:
+        case UV_FS_FSYNC:
+        case UV_FS_FDATASYNC:
+            r = PyArg_ParseTuple(item, "sl", &name, &op->fd);
+            break;
+        case UV_FS_OPEN:
+            r = PyArg_ParseTuple(item, "ssii", &name, &op->path, &op->flags, &op->mode);
+            break;
+        case UV_FS_READ:
+            r = PyArg_ParseTuple(item, "sliL", &name, &op->fd, &op->length, &op->offset);
+            if (r && op->length < 0) {
+                PyErr_SetString(PyExc_ValueError, "length must be positive");
+                r = 0;
+            }
+            if (r) {
+                op->buf = PyMem_Malloc(op->length > 0 ? op->length : 1);
+                if (!op->buf) {
+                    PyErr_NoMemory();
+                    r = 0;
+                }
+            }
+            break;
+        case UV_FS_MKDIR:
+        case UV_FS_CHMOD:
+        case UV_FS_ACCESS:
+            r = PyArg_ParseTuple(item, "ssi", &name, &op->path, &op->mode);
+            break;
+        case UV_FS_FCHMOD:
+            r = PyArg_ParseTuple(item, "sli", &name, &op->fd, &op->mode);
+            break;
+        case UV_FS_RENAME:
+        case UV_FS_LINK:
+            r = PyArg_ParseTuple(item, "sss", &name, &op->path, &op->new_path);
+            break;
+        case UV_FS_FTRUNCATE:
+            r = PyArg_ParseTuple(item, "slL", &name, &op->fd, &op->offset);
+            break;
+        default:
+            ASSERT(!"unknown fs batch op type");
+            r = 0;
+            break;
+    }
+
+    return r ? 0 : -1;
+}
+
+
+/* Runs without the GIL, in a threadpool thread or in the calling thread */
+static void
+pyuv__fs_batch_run(fs_batch_ctx *ctx)
+{
+    Py_ssize_t i;
+    fs_batch_op *op;
+    uv_loop_t *uv_loop;
+    uv_buf_t buf;
+
+    uv_loop = ctx->loop->uv_loop;
+
+    for (i = 0; i < ctx->count; i++) {
+        op = &ctx->ops[i];
+        switch (op->type) {
+            case UV_FS_STAT:
+                uv_fs_stat(uv_loop, &op->req, op->path, NULL);
+                break;
+            case UV_FS_LSTAT:
+                uv_fs_lstat(uv_loop, &op->req, op->path, NULL);
+                break;
+            case UV_FS_FSTAT:
+                uv_fs_fstat(uv_loop, &op->req, (uv_file)op->fd, NULL);
+                break;
+            case UV_FS_OPEN:
+                uv_fs_open(uv_loop, &op->req, op->path, op->flags, op->mode, NULL);
+                break;
+            case UV_FS_CLOSE:
+                uv_fs_close(uv_loop, &op->req, (uv_file)op->fd, NULL);
+                break;
+            case UV_FS_READ:
+                buf = uv_buf_init(op->buf, (unsigned int)op->length);
+                uv_fs_read(uv_loop, &op->req, (uv_file)op->fd, &buf, 1, op->offset, NULL);
+                break;
+            case UV_FS_UNLINK:
+                uv_fs_unlink(uv_loop, &op->req, op->path, NULL);
+                break;
+            case UV_FS_MKDIR:
+                uv_fs_mkdir(uv_loop, &op->req, op->path, op->mode, NULL);
+                break;
+            case UV_FS_RMDIR:
+                uv_fs_rmdir(uv_loop, &op->req, op->path, NULL);
+                break;
+            case UV_FS_RENAME:
+                uv_fs_rename(uv_loop, &op->req, op->path, op->new_path, NULL);
+                break;
+            case UV_FS_LINK:
+                uv_fs_link(uv_loop, &op->req, op->path, op->new_path, NULL);
+                break;
+            case UV_FS_CHMOD:
+                uv_fs_chmod(uv_loop, &op->req, op->path, op->mode, NULL);
+                break;
+            case UV_FS_FCHMOD:
+                uv_fs_fchmod(uv_loop, &op->req, (uv_file)op->fd, op->mode, NULL);
+                break;
+            case UV_FS_ACCESS:
+                uv_fs_access(uv_loop, &op->req, op->path, op->mode, NULL);
+                break;
+            case UV_FS_READLINK:
+                uv_fs_readlink(uv_loop, &op->req, op->path, NULL);
+                break;
+            case UV_FS_REALPATH:
+                uv_fs_realpath(uv_loop, &op->req, op->path, NULL);
+                break;
+            case UV_FS_FSYNC:
+                uv_fs_fsync(uv_loop, &op->req, (uv_file)op->fd, NULL);
+                break;
+            case UV_FS_FDATASYNC:
+                uv_fs_fdatasync(uv_loop, &op->req, (uv_file)op->fd, NULL);
+                break;
+            case UV_FS_FTRUNCATE:
+                uv_fs_ftruncate(uv_loop, &op->req, (uv_file)op->fd, op->offset, NULL);
+                break;
+            default:
+                ASSERT(!"unknown fs batch op type");
+                break;
+        }
+        op->done = True;
+    }
+}
+
+
+static void
+pyuv__fs_batch_work_cb(uv_work_t *req)
+{
+    pyuv__fs_batch_run(PYUV_CONTAINER_OF(req, fs_batch_ctx, req));
+}
+
+
+/* Build the list of (result, error) tuples, status is set if the job was cancelled */
+static PyObject *
+pyuv__fs_batch_results(fs_batch_ctx *ctx, int status)
+{
+    Py_ssize_t i;
+    fs_batch_op *op;
+    PyObject *results, *r, *errorno, *item;
+
+    results = PyList_New(ctx->count);
+    if (!results) {
+        return NULL;
+    }
+
+    for (i = 0; i < ctx->count; i++) {
+        op = &ctx->ops[i];
+        if (status < 0 || op->req.result < 0) {
+            PYUV_SET_NONE(r);
+            errorno = PyInt_FromLong(status < 0 ? (long)status : (long)op->req.result);
+        } else {
+            if (op->type == UV_FS_READ) {
+                r = PyBytes_FromStringAndSize(op->buf, op->req.result);
+                if (!r) {
+                    PyErr_Clear();
+                    PYUV_SET_NONE(r);
+                }
+            } else {
+                r = pyuv__fs_result(&op->req);
+            }
+            PYUV_SET_NONE(errorno);
+        }
+        item = PyTuple_New(2);
+        if (!item) {
+            Py_DECREF(r);
+            Py_XDECREF(errorno);
+            Py_DECREF(results);
+            return NULL;
+        }
+        PyTuple_SET_ITEM(item, 0, r);
+        PyTuple_SET_ITEM(item, 1, errorno);
+        PyList_SET_ITEM(results, i, item);
+    }
+
+    return results;
+}
+
+
+static void
+pyuv__fs_batch_free(fs_batch_ctx *ctx)
+{
+    Py_ssize_t i;
+
+    for (i = 0; i < ctx->count; i++) {
+        if (ctx->ops[i].done) {
+            uv_fs_req_cleanup(&ctx->ops[i].req);
+        }
+        PyMem_Free(ctx->ops[i].buf);
+    }
+    PyMem_Free(ctx->ops);
+    Py_XDECREF(ctx->ops_tuple);
+    Py_XDECREF(ctx->callback);
+    Py_DECREF(ctx->loop);
+    PyMem_Free(ctx);
+}
+
+
+static void
+pyuv__fs_batch_after_work_cb(uv_work_t *req, int status)
+{
+    gil_state gstate = pyuv__gil_ensure(req->loop);
+    fs_batch_ctx *ctx;
+    Loop *loop;
+    PyObject *results, *result;
+    uint64_t start;
+
+    ASSERT(req);
+    ctx = PYUV_CONTAINER_OF(req, fs_batch_ctx, req);
+    loop = ctx->loop;
+
+    results = pyuv__fs_batch_results(ctx, status);
+    if (results == NULL) {
+        handle_uncaught_exception(loop);
+    } else {
+        start = pyuv__loop_call_start(loop);
+        result = PyObject_CallFunctionObjArgs(ctx->callback, results, NULL);
+        pyuv__loop_call_end(loop, (PyObject *)loop, ctx->callback, start);
+        if (result == NULL) {
+            handle_uncaught_exception(loop);
+        }
+        Py_XDECREF(result);
+        Py_DECREF(results);
+    }
+
+    pyuv__fs_batch_free(ctx);
+
+    pyuv__gil_release(gstate);
+}
+
+
+static PyObject *
+FS_func_batch(PyObject *obj, PyObject *args, PyObject *kwargs)
+{
+    int err;
+    Py_ssize_t i;
+    Loop *loop;
+    fs_batch_ctx *ctx;
+    PyObject *ops, *callback, *ret;
+
+    static char *kwlist[] = {"loop", "operations", "callback", NULL};
+
+    UNUSED_ARG(obj);
+    callback = Py_None;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O!O|O:batch", kwlist, &LoopType, &loop, &ops, &callback)) {
+        return NULL;
+    }
+
+    if (callback != Py_None && !PyCallable_Check(callback)) {
+        PyErr_SetString(PyExc_TypeError, "a callable is required");
+        return NULL;
+    }
+
+    ctx = PyMem_Malloc(sizeof *ctx);
+    if (!ctx) {
+        return PyErr_NoMemory();
+    }
+    memset(ctx, 0, sizeof *ctx);
+    Py_INCREF(loop);
+    ctx->loop = loop;
+
+    ctx->ops_tuple = PySequence_Tuple(ops);
+    if (!ctx->ops_tuple) {
+        goto error;
+    }
+
+    /* count is only set once ops are initialized, as it's used by pyuv__fs_batch_free */
+    ctx->ops = PyMem_Malloc(sizeof(fs_batch_op) * PyTuple_GET_SIZE(ctx->ops_tuple));
+    if (!ctx->ops) {
+        PyErr_NoMemory();
+        goto error;
+    }
+    memset(ctx->ops, 0, sizeof(fs_batch_op) * PyTuple_GET_SIZE(ctx->ops_tuple));
+    ctx->count = PyTuple_GET_SIZE(ctx->ops_tuple);
+
+    for (i = 0; i < ctx->count; i++) {
+        if (pyuv__fs_batch_parse(&ctx->ops[i], PyTuple_GET_ITEM(ctx->ops_tuple, i)) < 0) {
+            goto error;
+        }
+    }
+
+    if (callback == Py_None) {
+        Py_BEGIN_ALLOW_THREADS
+        pyuv__fs_batch_run(ctx);
+        Py_END_ALLOW_THREADS
+        ret = pyuv__fs_batch_results(ctx, 0);
+        pyuv__fs_batch_free(ctx);
+        return ret;
+    }
+
+    Py_INCREF(callback);
+    ctx->callback = callback;
+
+    err = uv_queue_work(loop->uv_loop, &ctx->req, pyuv__fs_batch_work_cb, pyuv__fs_batch_after_work_cb);
+    if (err < 0) {
+        RAISE_UV_EXCEPTION(err, PyExc_FSError);
+        goto error;
+    }
+
+    Py_RETURN_NONE;
+
+error:
+    pyuv__fs_batch_free(ctx);
+    return NULL;
+}
+
+
+/* Directory tree walk
+ *
+ * Every directory is listed by its own threadpool job, so several of them are
+ * read in parallel. Workers only use the synchronous libuv functions and plain
+ * C memory; the job's completion callback, which runs in the loop thread,
+ * converts the entries, adds the subdirectories to the walk's pending stack
+ * and delivers the entries to Python in batches. Only a few jobs of a walk are
+ * in the threadpool at once, so it's never taken over by a large tree.
+ */
+
+#define PYUV_FS_WALK_BATCH_SIZE 1024
+#define PYUV_FS_WALK_MAX_JOBS 2
+
+typedef struct {
+    char *path;
+    int type;
+    Bool has_stat;
+    Bool descend;
+    uv_stat_t st;
+} fs_walk_entry;
+
+typedef struct fs_walk_job fs_walk_job;
+
+typedef struct {
+    Loop *loop;
+    PyObject *callback;
+    /* (st_dev, st_ino) of the directories already queued, when following symlinks */
+    PyObject *visited;
+    PyObject *pending;
+    Bool follow_symlinks;
+    Bool stat;
+    int max_depth;
+    unsigned int jobs;
+    /* directories waiting for a job, most recently found first */
+    fs_walk_job *pending_dirs;
+    int error;
+} fs_walk_ctx;
+
+struct fs_walk_job {
+    uv_work_t req;
+    fs_walk_ctx *walk;
+    fs_walk_job *next;
+    char *path;
+    int depth;
+    int result;
+    fs_walk_entry *entries;
+    size_t count;
+    /* the root, so links back to it aren't walked */
+    Bool has_root_stat;
+    uv_stat_t root_stat;
+};
+
+
+static int
+pyuv__fs_walk_type(uint64_t mode)
+{
+    switch (mode & S_IFMT) {
+        case S_IFDIR:
+            return UV_DIRENT_DIR;
+        case S_IFREG:
+            return UV_DIRENT_FILE;
+        case S_IFCHR:
+            return UV_DIRENT_CHAR;
+#ifdef S_IFLNK
+        case S_IFLNK:
+            return UV_DIRENT_LINK;
+#endif
+#ifdef S_IFIFO
+        case S_IFIFO:
+            return UV_DIRENT_FIFO;
+#endif
+#ifdef S_IFSOCK
+        case S_IFSOCK:
+            return UV_DIRENT_SOCKET;
+#endif
+#ifdef S_IFBLK
+        case S_IFBLK:
+            return UV_DIRENT_BLOCK;
+#endif
+        default:
+            return UV_DIRENT_UNKNOWN;
+    }
+}
+
+
+static char *
+pyuv__fs_walk_join(const char *dir, const char *name)
+{
+    char *path;
+    size_t dir_len, name_len;
+    Bool sep;
+
+    dir_len = strlen(dir);
+    name_len = strlen(name);
+    sep = dir_len > 0 && dir[dir_len - 1] != '/'
+#ifdef PYUV_WINDOWS
+          && dir[dir_len - 1] != '\\'
+#endif
+          ;
+
+    path = malloc(dir_len + sep + name_len + 1);
+    if (path == NULL) {
+        return NULL;
+    }
+    memcpy(path, dir, dir_len);
+    if (sep) {
+        path[dir_len] = '/';
+    }
+    memcpy(path + dir_len + sep, name, name_len + 1);
+
+    return path;
+}
+
+
+/* Runs in a threadpool thread, without the GIL */
+static void
+pyuv__fs_walk_work_cb(uv_work_t *req)
+{
+    int err;
+    size_t capacity;
+    uv_fs_t fs_req, stat_req;
+    uv_dirent_t ent;
+    uv_loop_t *uv_loop;
+    fs_walk_job *job;
+    fs_walk_entry *entry, *tmp;
+    fs_walk_ctx *walk;
+
+    job = PYUV_CONTAINER_OF(req, fs_walk_job, req);
+    walk = job->walk;
+    uv_loop = walk->loop->uv_loop;
+
+    if (job->depth == 0 && walk->follow_symlinks) {
+        if (uv_fs_stat(uv_loop, &stat_req, job->path, NULL) == 0) {
+            memcpy(&job->root_stat, &stat_req.statbuf, sizeof job->root_stat);
+            job->has_root_stat = True;
+        }
+        uv_fs_req_cleanup(&stat_req);
+    }
+
+    job->result = uv_fs_scandir(uv_loop, &fs_req, job->path, 0, NULL);
+    if (job->result < 0) {
+        uv_fs_req_cleanup(&fs_req);
+        return;
+    }
+
+    capacity = 0;
+    while (uv_fs_scandir_next(&fs_req, &ent) != UV_EOF) {
+        if (job->count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            tmp = realloc(job->entries, capacity * sizeof *tmp);
+            if (tmp == NULL) {
+                break;
+            }
+            job->entries = tmp;
+        }
+        entry = &job->entries[job->count];
+        entry->path = pyuv__fs_walk_join(job->path, ent.name);
+        if (entry->path == NULL) {
+            break;
+        }
+        entry->type = ent.type;
+        entry->has_stat = False;
+        entry->descend = False;
+        job->count++;
+
+        if (walk->stat || entry->type == UV_DIRENT_UNKNOWN ||
+            (walk->follow_symlinks && (entry->type == UV_DIRENT_LINK || entry->type == UV_DIRENT_DIR))) {
+            if (walk->follow_symlinks) {
+                err = uv_fs_stat(uv_loop, &stat_req, entry->path, NULL);
+                if (err < 0) {
+                    /* dangling link */
+                    uv_fs_req_cleanup(&stat_req);
+                    err = uv_fs_lstat(uv_loop, &stat_req, entry->path, NULL);
+                }
+            } else {
+                err = uv_fs_lstat(uv_loop, &stat_req, entry->path, NULL);
+            }
+            if (err == 0) {
+                memcpy(&entry->st, &stat_req.statbuf, sizeof entry->st);
+                entry->has_stat = True;
+                entry->type = pyuv__fs_walk_type(entry->st.st_mode);
+            }
+            uv_fs_req_cleanup(&stat_req);
+        }
+
+        entry->descend = entry->type == UV_DIRENT_DIR && (walk->max_depth < 0 || job->depth < walk->max_depth);
+    }
+
+    uv_fs_req_cleanup(&fs_req);
+}
+
+
+static void pyuv__fs_walk_after_work_cb(uv_work_t *req, int status);
+
+
+/* Add a directory to the walk, takes ownership of path */
+static int
+pyuv__fs_walk_push(fs_walk_ctx *walk, char *path, int depth)
+{
+    fs_walk_job *job;
+
+    job = malloc(sizeof *job);
+    if (job == NULL) {
+        free(path);
+        return UV_ENOMEM;
+    }
+    memset(job, 0, sizeof *job);
+    job->walk = walk;
+    job->path = path;
+    job->depth = depth;
+    job->next = walk->pending_dirs;
+    walk->pending_dirs = job;
+
+    return 0;
+}
+
+
+static void
+pyuv__fs_walk_job_free(fs_walk_job *job)
+{
+    size_t i;
+
+    for (i = 0; i < job->count; i++) {
+        free(job->entries[i].path);
+    }
+    free(job->entries);
+    free(job->path);
+    free(job);
+}
+
+
+/* Start jobs for pending directories, up to PYUV_FS_WALK_MAX_JOBS at once. Directories which
+ * can't be queued are skipped, the last error is returned. */
+static int
+pyuv__fs_walk_pump(fs_walk_ctx *walk)
+{
+    int err, r;
+    fs_walk_job *job;
+
+    r = 0;
+    while (walk->jobs < PYUV_FS_WALK_MAX_JOBS && walk->pending_dirs != NULL) {
+        job = walk->pending_dirs;
+        walk->pending_dirs = job->next;
+        err = uv_queue_work(walk->loop->uv_loop, &job->req, pyuv__fs_walk_work_cb, pyuv__fs_walk_after_work_cb);
+        if (err < 0) {
+            pyuv__fs_walk_job_free(job);
+            r = err;
+            continue;
+        }
+        walk->jobs++;
+    }
+
+    return r;
+}
+
+
+/* Returns True if the directory was already walked, when following symlinks */
+static Bool
+pyuv__fs_walk_visited(fs_walk_ctx *walk, const uv_stat_t *st)
+{
+    int r;
+    PyObject *key;
+
+    if (walk->visited == NULL) {
+        return False;
+    }
+
+    key = Py_BuildValue("(KK)", (unsigned PY_LONG_LONG)st->st_dev, (unsigned PY_LONG_LONG)st->st_ino);
+    if (key == NULL) {
+        PyErr_Clear();
+        return False;
+    }
+    r = PySet_Contains(walk->visited, key);
+    if (r == 0 && PySet_Add(walk->visited, key) < 0) {
+        PyErr_Clear();
+    }
+    if (r < 0) {
+        PyErr_Clear();
+        r = 0;
+    }
+    Py_DECREF(key);
+
+    return r ? True : False;
+}
+
+
+static void
+pyuv__fs_walk_deliver(fs_walk_ctx *walk, PyObject *entries, int error)
+{
+    PyObject *result, *errorno;
+    uint64_t start;
+
+    if (error < 0) {
+        errorno = PyInt_FromLong((long)error);
+    } else {
+        PYUV_SET_NONE(errorno);
+    }
+
+    start = pyuv__loop_call_start(walk->loop);
+    result = PyObject_CallFunctionObjArgs(walk->callback, entries, errorno, NULL);
+    pyuv__loop_call_end(walk->loop, (PyObject *)walk->loop, walk->callback, start);
+    if (result == NULL) {
+        handle_uncaught_exception(walk->loop);
+    }
+    Py_XDECREF(result);
+    Py_XDECREF(errorno);
+}
+
+
+static PyObject *
+pyuv__fs_walk_entry_new(fs_walk_ctx *walk, fs_walk_entry *entry)
+{
+    PyObject *item, *path, *st;
+
+    path = Py_BuildValue("s", entry->path);
+    if (path == NULL) {
+        return NULL;
+    }
+
+    if (walk->stat && entry->has_stat) {
+        st = PyStructSequence_New(&StatResultType);
+        if (st == NULL) {
+            Py_DECREF(path);
+            return NULL;
+        }
+        stat_to_pyobj(&entry->st, st);
+    } else {
+        PYUV_SET_NONE(st);
+    }
+
+    item = PyStructSequence_New(&WalkEntryType);
+    if (item == NULL) {
+        Py_DECREF(path);
+        Py_DECREF(st);
+        return NULL;
+    }
+    PyStructSequence_SET_ITEM(item, 0, path);
+    PyStructSequence_SET_ITEM(item, 1, PyInt_FromLong((long)entry->type));
+    PyStructSequence_SET_ITEM(item, 2, st);
+
+    return item;
+}
+
+
+static void
+pyuv__fs_walk_after_work_cb(uv_work_t *req, int status)
+{
+    gil_state gstate = pyuv__gil_ensure(req->loop);
+    size_t i;
+    fs_walk_job *job;
+    fs_walk_entry *entry;
+    fs_walk_ctx *walk;
+    PyObject *item, *pending;
+
+    ASSERT(req);
+    job = PYUV_CONTAINER_OF(req, fs_walk_job, req);
+    walk = job->walk;
+    walk->jobs--;
+
+    /* only errors listing the root are reported, like os.walk does by default */
+    if (job->depth == 0) {
+        walk->error = status < 0 ? status : (job->result < 0 ? job->result : 0);
+        if (job->has_root_stat) {
+            pyuv__fs_walk_visited(walk, &job->root_stat);
+        }
+    }
+
+    for (i = 0; i < job->count; i++) {
+        entry = &job->entries[i];
+        if (status == 0) {
+            item = pyuv__fs_walk_entry_new(walk, entry);
+            if (item == NULL || PyList_Append(walk->pending, item) < 0) {
+                PyErr_Clear();
+            }
+            Py_XDECREF(item);
+            if (entry->descend && !(entry->has_stat && pyuv__fs_walk_visited(walk, &entry->st))) {
+                pyuv__fs_walk_push(walk, entry->path, job->depth + 1);
+                entry->path = NULL;
+            }
+        }
+    }
+    pyuv__fs_walk_job_free(job);
+
+    pyuv__fs_walk_pump(walk);
+
+    /* the callback could start another walk or raise, hold on to the current batch */
+    if (PyList_GET_SIZE(walk->pending) >= PYUV_FS_WALK_BATCH_SIZE ||
+        (walk->jobs == 0 && PyList_GET_SIZE(walk->pending) > 0)) {
+        pending = walk->pending;
+        walk->pending = PyList_New(0);
+        if (walk->pending == NULL) {
+            PyErr_Clear();
+            walk->pending = pending;
+        } else {
+            pyuv__fs_walk_deliver(walk, pending, 0);
+            Py_DECREF(pending);
+        }
+    }
+
+    if (walk->jobs == 0) {
+        pyuv__fs_walk_deliver(walk, Py_None, walk->error);
+        Py_DECREF(walk->pending);
+        Py_XDECREF(walk->visited);
+        Py_DECREF(walk->callback);
+        Py_DECREF(walk->loop);
+        PyMem_Free(walk);
+    }
+
+    pyuv__gil_release(gstate);
+}
+
+
+static PyObject *
+FS_func_walk(PyObject *obj, PyObject *args, PyObject *kwargs)
+{
+    int err;
+    char *path, *root;
+    Loop *loop;
+    fs_walk_ctx *walk;
+    PyObject *callback, *follow_symlinks, *max_depth, *stat;
+
+    static char *kwlist[] = {"loop", "root", "callback", "follow_symlinks", "max_depth", "stat", NULL};
+
+    UNUSED_ARG(obj);
+    follow_symlinks = Py_False;
+    max_depth = Py_None;
+    stat = Py_False;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O!sO|O!OO!:walk", kwlist, &LoopType, &loop, &path, &callback, &PyBool_Type, &follow_symlinks, &max_depth, &PyBool_Type, &stat)) {
+        return NULL;
+    }
+
+    if (!PyCallable_Check(callback)) {
+        PyErr_SetString(PyExc_TypeError, "a callable is required");
+        return NULL;
+    }
+
+    walk = PyMem_Malloc(sizeof *walk);
+    if (walk == NULL) {
+        return PyErr_NoMemory();
+    }
+    memset(walk, 0, sizeof *walk);
+
+    walk->max_depth = -1;
+    if (max_depth != Py_None) {
+        walk->max_depth = (int)PyInt_AsLong(max_depth);
+        if (walk->max_depth == -1 && PyErr_Occurred()) {
+            PyMem_Free(walk);
+            return NULL;
+        }
+        if (walk->max_depth < 0) {
+            PyErr_SetString(PyExc_ValueError, "max_depth must be None or a positive integer");
+            PyMem_Free(walk);
+            return NULL;
+        }
+    }
+    walk->follow_symlinks = follow_symlinks == Py_True;
+    walk->stat = stat == Py_True;
+
+    walk->pending = PyList_New(0);
+    if (walk->pending == NULL) {
+        PyMem_Free(walk);
+        return NULL;
+    }
+
+    if (walk->follow_symlinks) {
+        walk->visited = PySet_New(NULL);
+        if (walk->visited == NULL) {
+            Py_DECREF(walk->pending);
+            PyMem_Free(walk);
+            return NULL;
+        }
+    }
+
+    Py_INCREF(loop);
+    walk->loop = loop;
+    Py_INCREF(callback);
+    walk->callback = callback;
+
+    root = malloc(strlen(path) + 1);
+    if (root == NULL) {
+        err = UV_ENOMEM;
+    } else {
+        strcpy(root, path);
+        err = pyuv__fs_walk_push(walk, root, 0);
+        if (err == 0) {
+            err = pyuv__fs_walk_pump(walk);
+        }
+    }
+    if (err < 0) {
+        RAISE_UV_EXCEPTION(err, PyExc_FSError);
+        Py_DECREF(walk->pending);
+        Py_XDECREF(walk->visited);
+        Py_DECREF(walk->callback);
+        Py_DECREF(walk->loop);
+        PyMem_Free(walk);
+        return NULL;
+    }
+
+    Py_RETURN_NONE;
+}
+
+
+/* Chunked directory listing
+ *
+ * The directory is read with opendir/readdir, one chunk per threadpool job.
+ * The next job is only queued once the callback got the previous chunk, so no
+ * more than a chunk of entries is ever held in memory. libuv has no directory
+ * streams on Windows, there the whole listing is read by scandir up front and
+ * only delivered in chunks.
+ */
+
+typedef struct {
+    uv_work_t req;
+    Loop *loop;
+    PyObject *callback;
+    char *path;
+#ifdef PYUV_WINDOWS
+    uv_fs_t scandir_req;
+#else
+    DIR *dir;
+#endif
+    Bool opened;
+    int chunk_size;
+    int count;
+    int result;
+    char **names;
+    int *types;
+} fs_scandir_ctx;
+
+
+#ifndef PYUV_WINDOWS
+static int
+pyuv__fs_scandir_type(struct dirent *d)
+{
+#ifdef DT_UNKNOWN
+    switch (d->d_type) {
+        case DT_DIR:
+            return UV_DIRENT_DIR;
+        case DT_REG:
+            return UV_DIRENT_FILE;
+        case DT_LNK:
+            return UV_DIRENT_LINK;
+        case DT_FIFO:
+            return UV_DIRENT_FIFO;
+        case DT_SOCK:
+            return UV_DIRENT_SOCKET;
+        case DT_CHR:
+            return UV_DIRENT_CHAR;
+        case DT_BLK:
+            return UV_DIRENT_BLOCK;
+        default:
+            return UV_DIRENT_UNKNOWN;
+    }
+#else
+    UNUSED_ARG(d);
+    return UV_DIRENT_UNKNOWN;
+#endif
+}
+#endif
+
+
+/* Runs in a threadpool thread, without the GIL */
+static void
+pyuv__fs_scandir_work_cb(uv_work_t *req)
+{
+    char *name;
+    int type;
+    fs_scandir_ctx *ctx;
+#ifdef PYUV_WINDOWS
+    uv_dirent_t ent;
+#else
+    struct dirent *d;
+#endif
+
+    ctx = PYUV_CONTAINER_OF(req, fs_scandir_ctx, req);
+    ctx->count = 0;
+
+    if (!ctx->opened) {
+#ifdef PYUV_WINDOWS
+        ctx->result = uv_fs_scandir(ctx->loop->uv_loop, &ctx->scandir_req, ctx->path, 0, NULL);
+        if (ctx->result < 0) {
+            uv_fs_req_cleanup(&ctx->scandir_req);
+            return;
+        }
+#else
+        ctx->dir = opendir(ctx->path);
+        if (ctx->dir == NULL) {
+            ctx->result = -errno;
+            return;
+        }
+#endif
+        ctx->opened = True;
+        ctx->result = 0;
+    }
+
+    while (ctx->count < ctx->chunk_size) {
+#ifdef PYUV_WINDOWS
+        if (uv_fs_scandir_next(&ctx->scandir_req, &ent) == UV_EOF) {
+            ctx->result = UV_EOF;
+            break;
+        }
+        name = strdup(ent.name);
+        type = ent.type;
+#else
+        errno = 0;
+        d = readdir(ctx->dir);
+        if (d == NULL) {
+            ctx->result = errno != 0 ? -errno : UV_EOF;
+            break;
+        }
+        if (strcmp(d->d_name, ".") == 0 || strcmp(d->d_name, "..") == 0) {
+            continue;
+        }
+        name = strdup(d->d_name);
+        type = pyuv__fs_scandir_type(d);
+#endif
+        if (name == NULL) {
+            ctx->result = UV_ENOMEM;
+            break;
+        }
+        ctx->names[ctx->count] = name;
+        ctx->types[ctx->count] = type;
+        ctx->count++;
+    }
+}
+
+
+static void
+pyuv__fs_scandir_free(fs_scandir_ctx *ctx)
+{
+    if (ctx->opened) {
+#ifdef PYUV_WINDOWS
+        uv_fs_req_cleanup(&ctx->scandir_req);
+#else
+        closedir(ctx->dir);
+#endif
+    }
+    Py_DECREF(ctx->callback);
+    Py_DECREF(ctx->loop);
+    free(ctx->names);
+    free(ctx->types);
+    PyMem_Free(ctx->path);
+    PyMem_Free(ctx);
+}
+
+
+static void
+pyuv__fs_scandir_after_work_cb(uv_work_t *req, int status)
+{
+    gil_state gstate = pyuv__gil_ensure(req->loop);
+    int i, err;
+    Bool stop;
+    fs_scandir_ctx *ctx;
+    PyObject *entries, *item, *errorno, *result;
+    uint64_t start;
+
+    ASSERT(req);
+    ctx = PYUV_CONTAINER_OF(req, fs_scandir_ctx, req);
+    stop = False;
+
+    if (ctx->count > 0) {
+        entries = PyList_New(0);
+        for (i = 0; i < ctx->count; i++) {
+            if (entries != NULL) {
+                item = PyStructSequence_New(&DirEntType);
+                if (item == NULL) {
+                    PyErr_Clear();
+                } else {
+                    PyStructSequence_SET_ITEM(item, 0, Py_BuildValue("s", ctx->names[i]));
+                    PyStructSequence_SET_ITEM(item, 1, PyInt_FromLong((long)ctx->types[i]));
+                    PyList_Append(entries, item);
+                    Py_DECREF(item);
+                }
+            }
+            free(ctx->names[i]);
+        }
+        ctx->count = 0;
+
+        if (entries == NULL) {
+            PyErr_Clear();
+        } else {
+            start = pyuv__loop_call_start(ctx->loop);
+            result = PyObject_CallFunctionObjArgs(ctx->callback, entries, Py_None, NULL);
+            pyuv__loop_call_end(ctx->loop, (PyObject *)ctx->loop, ctx->callback, start);
+            if (result == NULL) {
+                handle_uncaught_exception(ctx->loop);
+            } else if (result == Py_False) {
+                stop = True;
+            }
+            Py_XDECREF(result);
+            Py_DECREF(entries);
+        }
+    }
+
+    err = status < 0 ? status : ctx->result;
+    if (!stop && err == 0) {
+        err = uv_queue_work(ctx->loop->uv_loop, &ctx->req, pyuv__fs_scandir_work_cb, pyuv__fs_scandir_after_work_cb);
+        if (err == 0) {
+            goto done;
+        }
+    }
+
+    if (!stop) {
+        if (err < 0 && err != UV_EOF) {
+            errorno = PyInt_FromLong((long)err);
+        } else {
+            PYUV_SET_NONE(errorno);
+        }
+        start = pyuv__loop_call_start(ctx->loop);
+        result = PyObject_CallFunctionObjArgs(ctx->callback, Py_None, errorno, NULL);
+        pyuv__loop_call_end(ctx->loop, (PyObject *)ctx->loop, ctx->callback, start);
+        if (result == NULL) {
+            handle_uncaught_exception(ctx->loop);
+        }
+        Py_XDECREF(result);
+        Py_XDECREF(errorno);
+    }
+
+    pyuv__fs_scandir_free(ctx);
+
+done:
+    pyuv__gil_release(gstate);
+}
+
+
+static PyObject *
+FS_func_scandir_chunks(PyObject *obj, PyObject *args, PyObject *kwargs)
+{
+    int err, chunk_size;
+    char *path;
+    Loop *loop;
+    fs_scandir_ctx *ctx;
+    PyObject *callback;
+
+    static char *kwlist[] = {"loop", "path", "callback", "chunk_size", NULL};
+
+    UNUSED_ARG(obj);
+    chunk_size = 1024;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O!sO|i:scandir_chunks", kwlist, &LoopType, &loop, &path, &callback, &chunk_size)) {
+        return NULL;
+    }
+
+    if (!PyCallable_Check(callback)) {
+        PyErr_SetString(PyExc_TypeError, "a callable is required");
+        return NULL;
+    }
+
+    if (chunk_size < 1) {
+        PyErr_SetString(PyExc_ValueError, "chunk_size must be a positive integer");
+        return NULL;
+    }
+
+    ctx = PyMem_Malloc(sizeof *ctx);
+    if (ctx == NULL) {
+        return PyErr_NoMemory();
+    }
+    memset(ctx, 0, sizeof *ctx);
+    ctx->chunk_size = chunk_size;
+    ctx->path = PyMem_Malloc(strlen(path) + 1);
+    ctx->names = malloc(chunk_size * sizeof *ctx->names);
+    ctx->types = malloc(chunk_size * sizeof *ctx->types);
+    if (ctx->path == NULL || ctx->names == NULL || ctx->types == NULL) {
+        PyMem_Free(ctx->path);
+        free(ctx->names);
+        free(ctx->types);
+        PyMem_Free(ctx);
+        return PyErr_NoMemory();
+    }
+    strcpy(ctx->path, path);
+
+    Py_INCREF(loop);
+    ctx->loop = loop;
+    Py_INCREF(callback);
+    ctx->callback = callback;
+
+    err = uv_queue_work(loop->uv_loop, &ctx->req, pyuv__fs_scandir_work_cb, pyuv__fs_scandir_after_work_cb);
+    if (err < 0) {
+        RAISE_UV_EXCEPTION(err, PyExc_FSError);
+        pyuv__fs_scandir_free(ctx);
+        return NULL;
+    }
+
+    Py_RETURN_NONE;
+}
+
+
 static PyMethodDef
 FS_methods[] = {
     { "stat", (PyCFunction)FS_func_stat, METH_VARARGS|METH_KEYWORDS, "stat" },
@@ -1553,6 +2941,8 @@ FS_methods[] = {
     { "open", (PyCFunction)FS_func_open, METH_VARARGS|METH_KEYWORDS, "Open file." },
     { "close", (PyCFunction)FS_func_close, METH_VARARGS|METH_KEYWORDS, "Close file." },
     { "read", (PyCFunction)FS_func_read, METH_VARARGS|METH_KEYWORDS, "Read data from a file." },
+    { "readinto", (PyCFunction)FS_func_readinto, METH_VARARGS|METH_KEYWORDS, "Read data from a file into the given buffer." },
+    { "readv", (PyCFunction)FS_func_readv, METH_VARARGS|METH_KEYWORDS, "Read data from a file into the given buffers." },
     { "write", (PyCFunction)FS_func_write, METH_VARARGS|METH_KEYWORDS, "Write data to a file." },
     { "fsync", (PyCFunction)FS_func_fsync, METH_VARARGS|METH_KEYWORDS, "Sync all changes made to a file." },
     { "fdatasync", (PyCFunction)FS_func_fdatasync, METH_VARARGS|METH_KEYWORDS, "Sync data changes made to a file." },
@@ -1563,6 +2953,9 @@ FS_methods[] = {
     { "futime", (PyCFunction)FS_func_futime, METH_VARARGS|METH_KEYWORDS, "Update file times." },
     { "access", (PyCFunction)FS_func_access, METH_VARARGS|METH_KEYWORDS, "Check access to file." },
     { "realpath", (PyCFunction)FS_func_realpath, METH_VARARGS|METH_KEYWORDS, "Returns the canonicalized absolute path." },
+    { "scandir_chunks", (PyCFunction)FS_func_scandir_chunks, METH_VARARGS|METH_KEYWORDS, "List files from a directory, delivering them in chunks." },
+    { "walk", (PyCFunction)FS_func_walk, METH_VARARGS|METH_KEYWORDS, "Walk a directory tree, listing directories in parallel." },
+    { "batch", (PyCFunction)FS_func_batch, METH_VARARGS|METH_KEYWORDS, "Run several operations in a single threadpool job." },
     { "stat_float_times", (PyCFunction)stat_float_times, METH_VARARGS, "Use floats for times in stat structs." },
     { NULL }
 };
@@ -1573,9 +2966,10 @@ FS_methods[] = {
 static void
 pyuv__fsevent_cb(uv_fs_event_t *handle, const char *filename, int events, int status)
 {
-    PyGILState_STATE gstate = PyGILState_Ensure();
+    gil_state gstate = pyuv__gil_ensure(handle->loop);
     FSEvent *self;
     PyObject *result, *py_filename, *py_events, *errorno;
+    uint64_t start;
 
     ASSERT(handle);
 
@@ -1600,7 +2994,9 @@ pyuv__fsevent_cb(uv_fs_event_t *handle, const char *filename, int events, int st
 
     py_events = PyInt_FromLong((long)events);
 
+    start = pyuv__handle_call_start(HANDLE(self));
     result = PyObject_CallFunctionObjArgs(self->callback, self, py_filename, py_events, errorno, NULL);
+    pyuv__handle_call_end(HANDLE(self), self->callback, start);
     if (result == NULL) {
         handle_uncaught_exception(HANDLE(self)->loop);
     }
@@ -1610,7 +3006,7 @@ pyuv__fsevent_cb(uv_fs_event_t *handle, const char *filename, int events, int st
     Py_DECREF(errorno);
 
     Py_DECREF(self);
-    PyGILState_Release(gstate);
+    pyuv__gil_release(gstate);
 }
 
 
@@ -1827,9 +3223,10 @@ static PyTypeObject FSEventType = {
 static void
 pyuv__fspoll_cb(uv_fs_poll_t *handle, int status, const uv_stat_t *prev, const uv_stat_t *curr)
 {
-    PyGILState_STATE gstate = PyGILState_Ensure();
+    gil_state gstate = pyuv__gil_ensure(handle->loop);
     FSPoll *self;
     PyObject *result, *errorno, *prev_stat_data, *curr_stat_data;
+    uint64_t start;
 
     ASSERT(handle);
 
@@ -1865,14 +3262,16 @@ pyuv__fspoll_cb(uv_fs_poll_t *handle, int status, const uv_stat_t *prev, const u
         }
     }
 
+    start = pyuv__handle_call_start(HANDLE(self));
     result = PyObject_CallFunctionObjArgs(self->callback, self, prev_stat_data, curr_stat_data, errorno, NULL);
+    pyuv__handle_call_end(HANDLE(self), self->callback, start);
     if (result == NULL) {
         handle_uncaught_exception(HANDLE(self)->loop);
     }
     Py_XDECREF(result);
 
     Py_DECREF(self);
-    PyGILState_Release(gstate);
+    pyuv__gil_release(gstate);
 }
 
 
@@ -2140,6 +3539,8 @@ init_fs(void)
         PyStructSequence_InitType(&StatResultType, &stat_result_desc);
     if (DirEntType.tp_name == 0)
         PyStructSequence_InitType(&DirEntType, &dirent_desc);
+    if (WalkEntryType.tp_name == 0)
+        PyStructSequence_InitType(&WalkEntryType, &walk_entry_desc);
 
     return module;
 }
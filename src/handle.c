@@ -42,19 +42,105 @@ resurrect_object(PyObject *self)
 }
 
 
+/* Handle stats. All helpers are no-ops unless stats were enabled for the
+ * handle, and are only used from the loop thread.
+ */
+static handle_stats *
+pyuv__handle_stats_new(void)
+{
+    handle_stats *stats;
+
+    stats = PyMem_Malloc(sizeof *stats);
+    if (stats != NULL) {
+        memset(stats, 0, sizeof *stats);
+    }
+    return stats;
+}
+
+
+static INLINE uint64_t
+pyuv__handle_call_start(Handle *self)
+{
+    uint64_t start;
+
+    start = pyuv__loop_call_start((Loop *)UV_HANDLE(self)->loop->data);
+    if (start == 0 && self->stats != NULL) {
+        start = uv_hrtime();
+    }
+    return start;
+}
+
+
+static INLINE void
+pyuv__handle_call_end(Handle *self, PyObject *callback, uint64_t start)
+{
+    handle_stats *stats = self->stats;
+    Loop *loop;
+    uint64_t duration;
+
+    if (start == 0) {
+        return;
+    }
+
+    duration = uv_hrtime() - start;
+    if (stats != NULL) {
+        stats->callbacks++;
+        stats->callback_time += duration;
+        if (duration > stats->callback_max) {
+            stats->callback_max = duration;
+        }
+    }
+
+    loop = (Loop *)UV_HANDLE(self)->loop->data;
+    if (loop != NULL && loop->slow_callback.threshold != 0) {
+        pyuv__loop_call_done(loop, (PyObject *)self, callback, duration);
+    }
+}
+
+
+static INLINE void
+pyuv__handle_stats_read(Handle *self, size_t nbytes)
+{
+    if (self->stats != NULL) {
+        self->stats->bytes_read += nbytes;
+    }
+}
+
+
+static INLINE void
+pyuv__handle_stats_written(Handle *self, size_t nbytes)
+{
+    if (self->stats != NULL) {
+        self->stats->bytes_written += nbytes;
+    }
+}
+
+
+static INLINE void
+pyuv__handle_stats_queued(Handle *self, size_t queued)
+{
+    if (self->stats != NULL && queued > self->stats->write_queue_max) {
+        self->stats->write_queue_max = queued;
+    }
+}
+
+
 static void
 pyuv__handle_close_cb(uv_handle_t *handle)
 {
-    PyGILState_STATE gstate = PyGILState_Ensure();
+    gil_state gstate = pyuv__gil_ensure(handle->loop);
     Handle *self;
     PyObject *result;
+    uint64_t start;
     ASSERT(handle);
 
     /* Can't use container_of here */
     self = (Handle *)handle->data;
 
     if (self->on_close_cb != Py_None) {
+        start = pyuv__handle_call_start(self);
         result = PyObject_CallFunctionObjArgs(self->on_close_cb, self, NULL);
+        pyuv__handle_call_end(self, self->on_close_cb, start);
         if (result == NULL) {
             handle_uncaught_exception(self->loop);
         }
@@ -74,14 +160,14 @@ pyuv__handle_close_cb(uv_handle_t *handle)
     /* Refcount was increased in the caller function */
     Py_DECREF(self);
 
-    PyGILState_Release(gstate);
+    pyuv__gil_release(gstate);
 }
 
 
 static void
 pyuv__handle_dealloc_close_cb(uv_handle_t *handle)
 {
-    PyGILState_STATE gstate = PyGILState_Ensure();
+    gil_state gstate = pyuv__gil_ensure(handle->loop);
     Handle *self;
 
     ASSERT(handle);
@@ -90,7 +176,7 @@ pyuv__handle_dealloc_close_cb(uv_handle_t *handle)
     self = (Handle *)handle->data;
     Py_DECREF(self);
 
-    PyGILState_Release(gstate);
+    pyuv__gil_release(gstate);
 }
 
 
@@ -104,6 +190,9 @@ initialize_handle(Handle *self, Loop *loop)
     Py_XDECREF(tmp);
     self->flags = 0;
     self->initialized = True;
+    if (loop->handle_stats && self->stats == NULL) {
+        self->stats = pyuv__handle_stats_new();
+    }
 }
 
 
@@ -191,6 +280,58 @@ Handle_ref_set(Handle *self, PyObject* val, void* c)
 }
 
 
+static PyObject *
+Handle_stats_get(Handle *self, void *closure)
+{
+    UNUSED_ARG(closure);
+
+    if (self->stats == NULL) {
+        Py_RETURN_NONE;
+    }
+    return pyuv__handle_stats_result(self->stats);
+}
+
+
+static PyObject *
+Handle_stats_enabled_get(Handle *self, void *closure)
+{
+    UNUSED_ARG(closure);
+    return PyBool_FromLong((long)(self->stats != NULL));
+}
+
+
+static int
+Handle_stats_enabled_set(Handle *self, PyObject *value, void *closure)
+{
+    int enabled;
+
+    UNUSED_ARG(closure);
+
+    if (!value) {
+        PyErr_SetString(PyExc_TypeError, "cannot delete attribute");
+        return -1;
+    }
+
+    enabled = PyObject_IsTrue(value);
+    if (enabled == -1) {
+        return -1;
+    }
+
+    if (enabled && self->stats == NULL) {
+        self->stats = pyuv__handle_stats_new();
+        if (self->stats == NULL) {
+            PyErr_NoMemory();
+            return -1;
+        }
+    } else if (!enabled && self->stats != NULL) {
+        PyMem_Free(self->stats);
+        self->stats = NULL;
+    }
+
+    return 0;
+}
+
+
 static PyObject *
 Handle_tp_new(PyTypeObject *type, PyObject *args, PyObject *kwargs)
 {
@@ -202,6 +343,7 @@ Handle_tp_new(PyTypeObject *type, PyObject *args, PyObject *kwargs)
     self->initialized = False;
     self->uv_handle = NULL;
     self->weakreflist = NULL;
+    self->stats = NULL;
     return (PyObject *)self;
 }
 
@@ -252,6 +394,10 @@ Handle_tp_dealloc(Handle *self)
     if (self->weakreflist != NULL) {
         PyObject_ClearWeakRefs((PyObject *)self);
     }
+    if (self->stats != NULL) {
+        PyMem_Free(self->stats);
+        self->stats = NULL;
+    }
     subtype_clear((PyObject *)self);
     Py_TYPE(self)->tp_free((PyObject *)self);
 }
@@ -314,6 +460,8 @@ static PyGetSetDef Handle_tp_getsets[] = {
     {"active", (getter)Handle_active_get, NULL, "Indicates if this handle is active.", NULL},
     {"ref", (getter)Handle_ref_get, (setter)Handle_ref_set, "Indicates if this handle is ref'd or not.", NULL},
     {"closed", (getter)Handle_closed_get, NULL, "Indicates if this handle is closing or already closed.", NULL},
+    {"stats", (getter)Handle_stats_get, NULL, "Returns the handle counters, or None if not enabled.", NULL},
+    {"stats_enabled", (getter)Handle_stats_enabled_get, (setter)Handle_stats_enabled_set, "Collect counters for this handle.", NULL},
     {NULL}
 };
 
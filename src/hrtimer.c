@@ -0,0 +1,396 @@
+
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+/* High resolution timers
+ *
+ * Each HRTimer owns a timerfd armed with absolute deadlines on the
+ * CLOCK_MONOTONIC clock, the same clock uv_hrtime() reads, and watched by the
+ * loop with a uv_poll_t. Timeouts are not rounded to the millisecond loop
+ * time like uv_timer_t ones.
+ */
+
+static int
+pyuv__hrtimer_arm(HRTimer *self, uint64_t timeout, uint64_t repeat)
+{
+    struct itimerspec spec;
+    uint64_t deadline;
+
+    /* an all zero value disarms the timer, and uv_hrtime() is never 0 */
+    deadline = uv_hrtime() + timeout;
+    spec.it_value.tv_sec = deadline / 1000000000;
+    spec.it_value.tv_nsec = deadline % 1000000000;
+    spec.it_interval.tv_sec = repeat / 1000000000;
+    spec.it_interval.tv_nsec = repeat % 1000000000;
+
+    if (timerfd_settime(self->fd, TFD_TIMER_ABSTIME, &spec, NULL) < 0) {
+        return -errno;
+    }
+    return 0;
+}
+
+
+static void
+pyuv__hrtimer_disarm(HRTimer *self)
+{
+    struct itimerspec spec;
+
+    memset(&spec, 0, sizeof spec);
+    timerfd_settime(self->fd, 0, &spec, NULL);
+    self->armed_repeat = 0;
+}
+
+
+static void
+pyuv__hrtimer_cb(uv_poll_t *handle, int status, int events)
+{
+    gil_state gstate = pyuv__gil_ensure(handle->loop);
+    HRTimer *self;
+    PyObject *result;
+    uint64_t expirations, start;
+    ssize_t r;
+
+    ASSERT(handle);
+    UNUSED_ARG(events);
+
+    self = PYUV_CONTAINER_OF(handle, HRTimer, poll_h);
+
+    /* Object could go out of scope in the callback, increase refcount to avoid it */
+    Py_INCREF(self);
+
+    if (status < 0) {
+        goto done;
+    }
+
+    do {
+        r = read(self->fd, &expirations, sizeof expirations);
+    } while (r < 0 && errno == EINTR);
+    if (r != sizeof expirations) {
+        /* spurious wakeup or the timer was rearmed */
+        goto done;
+    }
+
+    /* like uv_timer_t, non repeating timers are stopped before the callback runs */
+    if (self->armed_repeat == 0) {
+        uv_poll_stop(&self->poll_h);
+        PYUV_HANDLE_DECREF(self);
+    }
+
+    start = pyuv__handle_call_start(HANDLE(self));
+    result = PyObject_CallFunctionObjArgs(self->callback, self, NULL);
+    pyuv__handle_call_end(HANDLE(self), self->callback, start);
+    if (result == NULL) {
+        handle_uncaught_exception(HANDLE(self)->loop);
+    }
+    Py_XDECREF(result);
+
+done:
+    Py_DECREF(self);
+    pyuv__gil_release(gstate);
+}
+
+
+static int
+pyuv__hrtimer_start(HRTimer *self, uint64_t timeout, uint64_t repeat)
+{
+    int err;
+
+    err = pyuv__hrtimer_arm(self, timeout, repeat);
+    if (err < 0) {
+        return err;
+    }
+
+    err = uv_poll_start(&self->poll_h, UV_READABLE, pyuv__hrtimer_cb);
+    if (err < 0) {
+        pyuv__hrtimer_disarm(self);
+        return err;
+    }
+
+    self->armed_repeat = repeat;
+    PYUV_HANDLE_INCREF(self);
+    return 0;
+}
+
+
+static PyObject *
+HRTimer_func_start(HRTimer *self, PyObject *args, PyObject *kwargs)
+{
+    int err;
+    double timeout, repeat;
+    PyObject *tmp, *callback;
+
+    static char *kwlist[] = {"callback", "timeout", "repeat", NULL};
+
+    tmp = NULL;
+
+    RAISE_IF_HANDLE_NOT_INITIALIZED(self, NULL);
+    RAISE_IF_HANDLE_CLOSED(self, PyExc_HandleClosedError, NULL);
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Odd:start", kwlist, &callback, &timeout, &repeat)) {
+        return NULL;
+    }
+
+    if (!PyCallable_Check(callback)) {
+        PyErr_SetString(PyExc_TypeError, "a callable is required");
+        return NULL;
+    }
+
+    if (timeout < 0.0 || repeat < 0.0) {
+        PyErr_SetString(PyExc_ValueError, "a positive value or zero is required");
+        return NULL;
+    }
+
+    err = pyuv__hrtimer_start(self, (uint64_t)(timeout * 1e9), (uint64_t)(repeat * 1e9));
+    if (err < 0) {
+        RAISE_UV_EXCEPTION(err, PyExc_TimerError);
+        return NULL;
+    }
+    self->repeat = (uint64_t)(repeat * 1e9);
+
+    tmp = self->callback;
+    Py_INCREF(callback);
+    self->callback = callback;
+    Py_XDECREF(tmp);
+
+    Py_RETURN_NONE;
+}
+
+
+static PyObject *
+HRTimer_func_stop(HRTimer *self)
+{
+    int err;
+
+    RAISE_IF_HANDLE_NOT_INITIALIZED(self, NULL);
+    RAISE_IF_HANDLE_CLOSED(self, PyExc_HandleClosedError, NULL);
+
+    err = uv_poll_stop(&self->poll_h);
+    if (err < 0) {
+        RAISE_UV_EXCEPTION(err, PyExc_TimerError);
+        return NULL;
+    }
+    pyuv__hrtimer_disarm(self);
+
+    PYUV_HANDLE_DECREF(self);
+
+    Py_RETURN_NONE;
+}
+
+
+static PyObject *
+HRTimer_func_again(HRTimer *self)
+{
+    int err;
+
+    RAISE_IF_HANDLE_NOT_INITIALIZED(self, NULL);
+    RAISE_IF_HANDLE_CLOSED(self, PyExc_HandleClosedError, NULL);
+
+    if (self->callback == NULL) {
+        RAISE_UV_EXCEPTION(UV_EINVAL, PyExc_TimerError);
+        return NULL;
+    }
+
+    if (self->repeat == 0) {
+        Py_RETURN_NONE;
+    }
+
+    err = pyuv__hrtimer_start(self, self->repeat, self->repeat);
+    if (err < 0) {
+        RAISE_UV_EXCEPTION(err, PyExc_TimerError);
+        return NULL;
+    }
+
+    Py_RETURN_NONE;
+}
+
+
+static PyObject *
+HRTimer_func_close(HRTimer *self, PyObject *args)
+{
+    PyObject *result;
+
+    result = Handle_func_close(HANDLE(self), args);
+    if (result != NULL && self->fd != -1) {
+        /* uv_close stopped the watcher already */
+        close(self->fd);
+        self->fd = -1;
+    }
+
+    return result;
+}
+
+
+static PyObject *
+HRTimer_repeat_get(HRTimer *self, void *closure)
+{
+    UNUSED_ARG(closure);
+
+    RAISE_IF_HANDLE_NOT_INITIALIZED(self, NULL);
+
+    return PyFloat_FromDouble(self->repeat / 1e9);
+}
+
+
+static int
+HRTimer_repeat_set(HRTimer *self, PyObject *value, void *closure)
+{
+    double repeat;
+
+    UNUSED_ARG(closure);
+
+    RAISE_IF_HANDLE_NOT_INITIALIZED(self, -1);
+
+    if (!value) {
+        PyErr_SetString(PyExc_TypeError, "cannot delete attribute");
+        return -1;
+    }
+
+    repeat = PyFloat_AsDouble(value);
+    if (repeat == -1 && PyErr_Occurred()) {
+        return -1;
+    }
+
+    if (repeat < 0.0) {
+        PyErr_SetString(PyExc_ValueError, "a positive float or 0.0 is required");
+        return -1;
+    }
+
+    /* takes effect the next time the timer is started */
+    self->repeat = (uint64_t)(repeat * 1e9);
+
+    return 0;
+}
+
+
+static int
+HRTimer_tp_init(HRTimer *self, PyObject *args, PyObject *kwargs)
+{
+    int err, fd;
+    Loop *loop;
+
+    UNUSED_ARG(kwargs);
+
+    RAISE_IF_HANDLE_INITIALIZED(self, -1);
+
+    if (!PyArg_ParseTuple(args, "O!:__init__", &LoopType, &loop)) {
+        return -1;
+    }
+
+    fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0) {
+        RAISE_UV_EXCEPTION(-errno, PyExc_TimerError);
+        return -1;
+    }
+
+    err = uv_poll_init(loop->uv_loop, &self->poll_h, fd);
+    if (err < 0) {
+        close(fd);
+        RAISE_UV_EXCEPTION(err, PyExc_TimerError);
+        return -1;
+    }
+
+    self->fd = fd;
+    initialize_handle(HANDLE(self), loop);
+
+    return 0;
+}
+
+
+static PyObject *
+HRTimer_tp_new(PyTypeObject *type, PyObject *args, PyObject *kwargs)
+{
+    HRTimer *self;
+
+    self = (HRTimer *)HandleType.tp_new(type, args, kwargs);
+    if (!self) {
+        return NULL;
+    }
+
+    self->poll_h.data = self;
+    UV_HANDLE(self) = (uv_handle_t *)&self->poll_h;
+    self->fd = -1;
+    self->repeat = 0;
+    self->armed_repeat = 0;
+
+    return (PyObject *)self;
+}
+
+
+static int
+HRTimer_tp_traverse(HRTimer *self, visitproc visit, void *arg)
+{
+    Py_VISIT(self->callback);
+    return HandleType.tp_traverse((PyObject *)self, visit, arg);
+}
+
+
+static int
+HRTimer_tp_clear(HRTimer *self)
+{
+    /* the fd must outlive the poll watcher, it's closed on the final clear */
+    if (self->fd != -1 && uv_is_closing(UV_HANDLE(self))) {
+        close(self->fd);
+        self->fd = -1;
+    }
+    Py_CLEAR(self->callback);
+    return HandleType.tp_clear((PyObject *)self);
+}
+
+
+static PyMethodDef
+HRTimer_tp_methods[] = {
+    { "start", (PyCFunction)HRTimer_func_start, METH_VARARGS|METH_KEYWORDS, "Start the HRTimer." },
+    { "stop", (PyCFunction)HRTimer_func_stop, METH_NOARGS, "Stop the HRTimer." },
+    { "again", (PyCFunction)HRTimer_func_again, METH_NOARGS, "Stop the timer, and if it is repeating restart it using the repeat value as the timeout." },
+    { "close", (PyCFunction)HRTimer_func_close, METH_VARARGS, "Close the HRTimer." },
+    { NULL }
+};
+
+
+static PyGetSetDef HRTimer_tp_getsets[] = {
+    {"repeat", (getter)HRTimer_repeat_get, (setter)HRTimer_repeat_set, "Timer repeat value.", NULL},
+    {NULL}
+};
+
+
+static PyTypeObject HRTimerType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "pyuv._cpyuv.HRTimer",                                          /*tp_name*/
+    sizeof(HRTimer),                                                /*tp_basicsize*/
+    0,                                                              /*tp_itemsize*/
+    0,                                                              /*tp_dealloc*/
+    0,                                                              /*tp_print*/
+    0,                                                              /*tp_getattr*/
+    0,                                                              /*tp_setattr*/
+    0,                                                              /*tp_compare*/
+    0,                                                              /*tp_repr*/
+    0,                                                              /*tp_as_number*/
+    0,                                                              /*tp_as_sequence*/
+    0,                                                              /*tp_as_mapping*/
+    0,                                                              /*tp_hash */
+    0,                                                              /*tp_call*/
+    0,                                                              /*tp_str*/
+    0,                                                              /*tp_getattro*/
+    0,                                                              /*tp_setattro*/
+    0,                                                              /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HAVE_GC,  /*tp_flags*/
+    0,                                                              /*tp_doc*/
+    (traverseproc)HRTimer_tp_traverse,                              /*tp_traverse*/
+    (inquiry)HRTimer_tp_clear,                                      /*tp_clear*/
+    0,                                                              /*tp_richcompare*/
+    0,                                                              /*tp_weaklistoffset*/
+    0,                                                              /*tp_iter*/
+    0,                                                              /*tp_iternext*/
+    HRTimer_tp_methods,                                             /*tp_methods*/
+    0,                                                              /*tp_members*/
+    HRTimer_tp_getsets,                                             /*tp_getsets*/
+    0,                                                              /*tp_base*/
+    0,                                                              /*tp_dict*/
+    0,                                                              /*tp_descr_get*/
+    0,                                                              /*tp_descr_set*/
+    0,                                                              /*tp_dictoffset*/
+    (initproc)HRTimer_tp_init,                                      /*tp_init*/
+    0,                                                              /*tp_alloc*/
+    HRTimer_tp_new,                                                 /*tp_new*/
+};
+
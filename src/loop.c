@@ -26,8 +26,17 @@ new_loop(PyTypeObject *type, PyObject *args, PyObject *kwargs, int is_default)
         uv_loop = &loop->loop_struct;
     }
 
+    if (pyuv__buffer_pool_init(&loop->buffer_pool) < 0) {
+        PyErr_SetString(PyExc_RuntimeError, "Error initializing loop buffer pool");
+        Py_DECREF(obj);
+        return NULL;
+    }
+
+    pyuv__request_pool_init(&loop->request_pool);
+
     if (uv_loop_init(uv_loop) < 0) {
         PyErr_SetString(PyExc_RuntimeError, "Error initializing loop");
+        pyuv__buffer_pool_destroy(&loop->buffer_pool);
         Py_DECREF(obj);
         return NULL;
     }
@@ -36,20 +45,195 @@ new_loop(PyTypeObject *type, PyObject *args, PyObject *kwargs, int is_default)
     loop->uv_loop = uv_loop;
     loop->is_default = is_default;
     loop->weakreflist = NULL;
-    loop->buffer.in_use = False;
+    pyuv__metrics_reset(&loop->metrics);
+    loop->slow_callback.stack_fd = -1;
 
     return obj;
 }
 
 
+/* Take the GIL from a callback running on the loop thread. While run() is
+ * active the thread state is cached on the loop, so it can be restored
+ * directly instead of going through the PyGILState machinery.
+ */
+static INLINE gil_state
+pyuv__gil_ensure(uv_loop_t *uv_loop)
+{
+    gil_state state;
+    PyThreadState *tstate;
+
+    state.loop = (Loop *)uv_loop->data;
+    if (state.loop != NULL && state.loop->tstate != NULL) {
+        tstate = state.loop->tstate;
+        state.loop->tstate = NULL;
+        PyEval_RestoreThread(tstate);
+        state.how = PYUV_GIL_RESTORED;
+    } else if (state.loop != NULL && state.loop->hold_gil) {
+        state.how = PYUV_GIL_HELD;
+    } else {
+        state.gstate = PyGILState_Ensure();
+        state.how = PYUV_GIL_ENSURED;
+    }
+    if (state.how != PYUV_GIL_ENSURED && state.loop->metrics.enabled) {
+        state.start = uv_hrtime();
+    } else {
+        state.start = 0;
+    }
+    return state;
+}
+
+
+static INLINE void
+pyuv__gil_release(gil_state state)
+{
+    if (state.start != 0) {
+        pyuv__metrics_callback(&state.loop->metrics, uv_hrtime() - state.start);
+    }
+    if (state.how == PYUV_GIL_RESTORED) {
+        state.loop->tstate = PyEval_SaveThread();
+    } else if (state.how == PYUV_GIL_ENSURED) {
+        PyGILState_Release(state.gstate);
+    }
+}
+
+
+/* Slow callback detection: callback sites take a timestamp before calling
+ * into Python and report the elapsed time afterwards, see
+ * Loop.set_slow_callback_hook. The hook runs after the callback returned.
+ */
+static INLINE uint64_t
+pyuv__loop_call_start(Loop *loop)
+{
+    uint64_t now;
+
+    if (loop == NULL || loop->slow_callback.threshold == 0) {
+        return 0;
+    }
+
+    now = uv_hrtime();
+    if (loop->slow_callback.watchdog_running) {
+        loop->slow_callback.tstate = PyThreadState_Get();
+        loop->slow_callback.start = now;
+    }
+    return now;
+}
+
+
+static void
+pyuv__loop_call_done(Loop *loop, PyObject *obj, PyObject *callback, uint64_t duration)
+{
+    PyObject *hook, *result, *duration_obj;
+    PyObject *exc_type, *exc_value, *exc_tb;
+
+    loop->slow_callback.start = 0;
+    if (duration < loop->slow_callback.threshold || loop->slow_callback.hook == NULL) {
+        return;
+    }
+
+    duration_obj = PyFloat_FromDouble(duration / 1e9);
+    if (duration_obj == NULL) {
+        PyErr_Clear();
+        return;
+    }
+
+    /* the callback may have replaced or cleared itself while running */
+    if (callback == NULL) {
+        callback = Py_None;
+    }
+
+    PyErr_Fetch(&exc_type, &exc_value, &exc_tb);
+    hook = loop->slow_callback.hook;
+    Py_INCREF(hook);
+    result = PyObject_CallFunctionObjArgs(hook, obj, duration_obj, callback, NULL);
+    if (result == NULL) {
+        handle_uncaught_exception(loop);
+    }
+    Py_XDECREF(result);
+    Py_DECREF(hook);
+    Py_DECREF(duration_obj);
+    PyErr_Restore(exc_type, exc_value, exc_tb);
+}
+
+
+static INLINE void
+pyuv__loop_call_end(Loop *loop, PyObject *obj, PyObject *callback, uint64_t start)
+{
+    if (start != 0) {
+        pyuv__loop_call_done(loop, obj, callback, uv_hrtime() - start);
+    }
+}
+
+
+#ifdef PYUV_LIBUV_POLL_HOOKS
+static void
+pyuv__loop_poll_enter(uv_loop_t *uv_loop, int timeout)
+{
+    Loop *loop = (Loop *)uv_loop->data;
+
+    if (loop == NULL) {
+        return;
+    }
+
+    pyuv__metrics_phase(&loop->metrics, PYUV_LOOP_PHASE_POLL);
+    if (timeout != 0 && loop->hold_gil) {
+        ASSERT(loop->tstate == NULL);
+        loop->tstate = PyEval_SaveThread();
+    }
+}
+
+
+static void
+pyuv__loop_poll_leave(uv_loop_t *uv_loop, int timeout)
+{
+    Loop *loop = (Loop *)uv_loop->data;
+    PyThreadState *tstate;
+
+    if (loop == NULL) {
+        return;
+    }
+
+    if (loop->hold_gil && loop->tstate != NULL) {
+        tstate = loop->tstate;
+        loop->tstate = NULL;
+        PyEval_RestoreThread(tstate);
+    }
+    pyuv__metrics_phase(&loop->metrics, PYUV_LOOP_PHASE_IO);
+}
+
+
+static void
+pyuv__loop_run_phase(uv_loop_t *uv_loop, int phase)
+{
+    Loop *loop = (Loop *)uv_loop->data;
+
+    if (loop == NULL || !loop->metrics.enabled) {
+        return;
+    }
+
+    /* phase 7 is the end of the loop iteration */
+    if (phase == 7) {
+        loop->metrics.iterations++;
+        pyuv__metrics_phase(&loop->metrics, PYUV_LOOP_PHASE_NONE);
+    } else {
+        pyuv__metrics_phase(&loop->metrics, phase);
+    }
+}
+#endif
+
+
 static PyObject *
-Loop_func_run(Loop *self, PyObject *args)
+Loop_func_run(Loop *self, PyObject *args, PyObject *kwargs)
 {
     int mode, r;
+    Bool hold_gil;
+    PyObject *hold_gil_obj = Py_False;
+    PyThreadState *tstate;
+
+    static char *kwlist[] = {"mode", "hold_gil", NULL};
 
     mode = UV_RUN_DEFAULT;
 
-    if (!PyArg_ParseTuple(args, "|i:run", &mode)) {
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|iO!:run", kwlist, &mode, &PyBool_Type, &hold_gil_obj)) {
         return NULL;
     }
 
@@ -58,9 +242,27 @@ Loop_func_run(Loop *self, PyObject *args)
         return NULL;
     }
 
-    Py_BEGIN_ALLOW_THREADS
-    r = uv_run(self->uv_loop, mode);
-    Py_END_ALLOW_THREADS
+    hold_gil = self->hold_gil;
+    tstate = self->tstate;
+
+#ifdef PYUV_LIBUV_POLL_HOOKS
+    if (hold_gil_obj == Py_True) {
+        /* the GIL is only released by the poll hooks while blocked for i/o */
+        self->hold_gil = True;
+        self->tstate = NULL;
+        r = uv_run(self->uv_loop, mode);
+        ASSERT(self->tstate == NULL);
+    } else
+#endif
+    {
+        self->hold_gil = False;
+        self->tstate = PyEval_SaveThread();
+        r = uv_run(self->uv_loop, mode);
+        PyEval_RestoreThread(self->tstate);
+    }
+
+    self->hold_gil = hold_gil;
+    self->tstate = tstate;
 
     return PyBool_FromLong((long)r);
 }
@@ -74,6 +276,14 @@ Loop_func_stop(Loop *self)
 }
 
 
+static PyObject *
+Loop_func_reset_metrics(Loop *self)
+{
+    pyuv__metrics_reset(&self->metrics);
+    Py_RETURN_NONE;
+}
+
+
 static PyObject *
 Loop_func_now(Loop *self)
 {
@@ -126,10 +336,11 @@ pyuv__tp_work_cb(uv_work_t *req)
 static void
 pyuv__tp_done_cb(uv_work_t *req, int status)
 {
-    PyGILState_STATE gstate = PyGILState_Ensure();
+    gil_state gstate = pyuv__gil_ensure(req->loop);
     WorkRequest *work_req;
     Loop *loop;
     PyObject *result, *errorno;
+    uint64_t start;
 
     ASSERT(req);
 
@@ -144,7 +355,9 @@ pyuv__tp_done_cb(uv_work_t *req, int status)
             Py_INCREF(Py_None);
         }
 
+        start = pyuv__loop_call_start(loop);
         result = PyObject_CallFunctionObjArgs(work_req->done_cb, errorno, NULL);
+        pyuv__loop_call_end(loop, (PyObject *)work_req, work_req->done_cb, start);
         if (result == NULL) {
             handle_uncaught_exception(loop);
         }
@@ -155,7 +368,7 @@ pyuv__tp_done_cb(uv_work_t *req, int status)
     UV_REQUEST(work_req) = NULL;
     Py_DECREF(work_req);
 
-    PyGILState_Release(gstate);
+    pyuv__gil_release(gstate);
 }
 
 static PyObject *
@@ -221,6 +434,57 @@ Loop_func_excepthook(Loop *self, PyObject *args)
 }
 
 
+static PyObject *
+Loop_func_set_slow_callback_hook(Loop *self, PyObject *args, PyObject *kwargs)
+{
+    double threshold;
+    int stack_fd;
+    PyObject *callback, *tmp;
+
+    static char *kwlist[] = {"callback", "threshold", "stack_fd", NULL};
+
+    stack_fd = -1;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Od|i:set_slow_callback_hook", kwlist, &callback, &threshold, &stack_fd)) {
+        return NULL;
+    }
+
+    if (callback != Py_None && !PyCallable_Check(callback)) {
+        PyErr_SetString(PyExc_TypeError, "a callable or None is required");
+        return NULL;
+    }
+
+    pyuv__watchdog_stop(&self->slow_callback);
+    self->slow_callback.start = 0;
+    self->slow_callback.stack_fd = -1;
+
+    tmp = self->slow_callback.hook;
+    if (threshold <= 0.0 || callback == Py_None) {
+        self->slow_callback.hook = NULL;
+    } else {
+        Py_INCREF(callback);
+        self->slow_callback.hook = callback;
+    }
+    Py_XDECREF(tmp);
+
+    if (threshold <= 0.0) {
+        self->slow_callback.threshold = 0;
+        Py_RETURN_NONE;
+    }
+    self->slow_callback.threshold = (uint64_t)(threshold * 1e9);
+
+    if (stack_fd >= 0) {
+        self->slow_callback.stack_fd = stack_fd;
+        if (pyuv__watchdog_start(&self->slow_callback) < 0) {
+            self->slow_callback.stack_fd = -1;
+            return NULL;
+        }
+    }
+
+    Py_RETURN_NONE;
+}
+
+
 static PyObject *
 Loop_func_default_loop(PyObject *cls)
 {
@@ -293,6 +557,61 @@ Loop_handles_get(Loop *self, void *closure)
 }
 
 
+static void
+handle_stats_walk_cb(uv_handle_t* handle, void* arg)
+{
+    PyObject *obj;
+
+    obj = handle->data;
+
+    if (IS_PYUV_HANDLE(obj) && ((Handle *)obj)->stats != NULL) {
+        pyuv__handle_stats_add((handle_stats *)arg, ((Handle *)obj)->stats);
+    }
+}
+
+static PyObject *
+Loop_handle_stats_get(Loop *self, void *closure)
+{
+    handle_stats total;
+    UNUSED_ARG(closure);
+
+    memset(&total, 0, sizeof total);
+    uv_walk(self->uv_loop, (uv_walk_cb)handle_stats_walk_cb, &total);
+
+    return pyuv__handle_stats_result(&total);
+}
+
+
+static PyObject *
+Loop_handle_stats_enabled_get(Loop *self, void *closure)
+{
+    UNUSED_ARG(closure);
+    return PyBool_FromLong((long)self->handle_stats);
+}
+
+
+static int
+Loop_handle_stats_enabled_set(Loop *self, PyObject *value, void *closure)
+{
+    int enabled;
+
+    UNUSED_ARG(closure);
+
+    if (!value) {
+        PyErr_SetString(PyExc_TypeError, "cannot delete attribute");
+        return -1;
+    }
+
+    enabled = PyObject_IsTrue(value);
+    if (enabled == -1) {
+        return -1;
+    }
+
+    self->handle_stats = (Bool)enabled;
+    return 0;
+}
+
+
 static PyObject *
 Loop_alive_get(Loop *self, void *closure)
 {
@@ -301,6 +620,124 @@ Loop_alive_get(Loop *self, void *closure)
 }
 
 
+static PyObject *
+Loop_buffer_pool_chunk_size_get(Loop *self, void *closure)
+{
+    UNUSED_ARG(closure);
+    return PyLong_FromSize_t(self->buffer_pool.chunk_size);
+}
+
+
+static int
+Loop_buffer_pool_chunk_size_set(Loop *self, PyObject *value, void *closure)
+{
+    Py_ssize_t chunk_size;
+
+    UNUSED_ARG(closure);
+
+    if (!value) {
+        PyErr_SetString(PyExc_TypeError, "cannot delete attribute");
+        return -1;
+    }
+
+    chunk_size = PyNumber_AsSsize_t(value, PyExc_OverflowError);
+    if (chunk_size == -1 && PyErr_Occurred()) {
+        return -1;
+    }
+
+    if (chunk_size <= 0 || (size_t)chunk_size > PYUV_BUFFER_POOL_MAX_SIZE) {
+        PyErr_Format(PyExc_ValueError, "chunk size must be between 1 and %zu", PYUV_BUFFER_POOL_MAX_SIZE);
+        return -1;
+    }
+
+    self->buffer_pool.chunk_size = pyuv__buffer_pool_round((size_t)chunk_size);
+    return 0;
+}
+
+
+static PyObject *
+Loop_buffer_pool_max_free_get(Loop *self, void *closure)
+{
+    UNUSED_ARG(closure);
+    return PyLong_FromSize_t(self->buffer_pool.max_free);
+}
+
+
+static int
+Loop_buffer_pool_max_free_set(Loop *self, PyObject *value, void *closure)
+{
+    Py_ssize_t max_free;
+
+    UNUSED_ARG(closure);
+
+    if (!value) {
+        PyErr_SetString(PyExc_TypeError, "cannot delete attribute");
+        return -1;
+    }
+
+    max_free = PyNumber_AsSsize_t(value, PyExc_OverflowError);
+    if (max_free == -1 && PyErr_Occurred()) {
+        return -1;
+    }
+
+    if (max_free < 0) {
+        PyErr_SetString(PyExc_ValueError, "max_free must be a positive number");
+        return -1;
+    }
+
+    self->buffer_pool.max_free = (size_t)max_free;
+    pyuv__buffer_pool_trim(&self->buffer_pool, self->buffer_pool.max_free);
+    return 0;
+}
+
+
+static PyObject *
+Loop_request_pool_stats_get(Loop *self, void *closure)
+{
+    UNUSED_ARG(closure);
+    return pyuv__request_pool_stats(&self->request_pool);
+}
+
+
+static PyObject *
+Loop_metrics_get(Loop *self, void *closure)
+{
+    UNUSED_ARG(closure);
+    return pyuv__metrics_result(&self->metrics);
+}
+
+
+static PyObject *
+Loop_metrics_enabled_get(Loop *self, void *closure)
+{
+    UNUSED_ARG(closure);
+    return PyBool_FromLong((long)self->metrics.enabled);
+}
+
+
+static int
+Loop_metrics_enabled_set(Loop *self, PyObject *value, void *closure)
+{
+    int enabled;
+
+    UNUSED_ARG(closure);
+
+    if (!value) {
+        PyErr_SetString(PyExc_TypeError, "cannot delete attribute");
+        return -1;
+    }
+
+    enabled = PyObject_IsTrue(value);
+    if (enabled == -1) {
+        return -1;
+    }
+
+    self->metrics.enabled = (Bool)enabled;
+    self->metrics.phase = PYUV_LOOP_PHASE_NONE;
+    return 0;
+}
+
+
 static PyObject *
 Loop_tp_new(PyTypeObject *type, PyObject *args, PyObject *kwargs)
 {
@@ -312,6 +749,8 @@ static int
 Loop_tp_traverse(Loop *self, visitproc visit, void *arg)
 {
     Py_VISIT(self->dict);
+    Py_VISIT(self->flush_pending);
+    Py_VISIT(self->slow_callback.hook);
     return 0;
 }
 
@@ -320,6 +759,8 @@ static int
 Loop_tp_clear(Loop *self)
 {
     Py_CLEAR(self->dict);
+    Py_CLEAR(self->flush_pending);
+    Py_CLEAR(self->slow_callback.hook);
     return 0;
 }
 
@@ -327,9 +768,23 @@ Loop_tp_clear(Loop *self)
 static void
 Loop_tp_dealloc(Loop *self)
 {
+    pyuv__watchdog_stop(&self->slow_callback);
     if (self->uv_loop) {
         self->uv_loop->data = NULL;
+        if (self->flush_handles_init) {
+            uv_close((uv_handle_t *)&self->flush_prepare, NULL);
+            uv_close((uv_handle_t *)&self->flush_check, NULL);
+        }
+        if (self->timer_batch.init) {
+            uv_close((uv_handle_t *)&self->timer_batch.prepare, NULL);
+        }
+        if (self->flush_handles_init || self->timer_batch.init) {
+            uv_run(self->uv_loop, UV_RUN_NOWAIT);
+        }
+        free(self->timer_batch.timers);
         uv_loop_close(self->uv_loop);
+        pyuv__buffer_pool_destroy(&self->buffer_pool);
+        pyuv__request_pool_destroy(&self->request_pool);
     }
     if (self->weakreflist != NULL) {
         PyObject_ClearWeakRefs((PyObject *)self);
@@ -380,7 +835,7 @@ Loop_dict_set(Loop *self, PyObject* val, void* c)
 
 static PyMethodDef
 Loop_tp_methods[] = {
-    { "run", (PyCFunction)Loop_func_run, METH_VARARGS, "Run the event loop." },
+    { "run", (PyCFunction)Loop_func_run, METH_VARARGS|METH_KEYWORDS, "Run the event loop." },
     { "stop", (PyCFunction)Loop_func_stop, METH_NOARGS, "Stop running the event loop." },
     { "now", (PyCFunction)Loop_func_now, METH_NOARGS, "Return event loop time, expressed in nanoseconds." },
     { "update_time", (PyCFunction)Loop_func_update_time, METH_NOARGS, "Update event loop's notion of time by querying the kernel." },
@@ -389,6 +844,8 @@ Loop_tp_methods[] = {
     { "default_loop", (PyCFunction)Loop_func_default_loop, METH_CLASS|METH_NOARGS, "Instantiate the default loop." },
     { "queue_work", (PyCFunction)Loop_func_queue_work, METH_VARARGS, "Queue the given function to be run in the thread pool." },
     { "excepthook", (PyCFunction)Loop_func_excepthook, METH_VARARGS, "Loop uncaught exception handler" },
+    { "reset_metrics", (PyCFunction)Loop_func_reset_metrics, METH_NOARGS, "Reset the loop metrics counters." },
+    { "set_slow_callback_hook", (PyCFunction)Loop_func_set_slow_callback_hook, METH_VARARGS|METH_KEYWORDS, "Report callbacks which run for longer than the given threshold." },
     { NULL }
 };
 
@@ -398,6 +855,13 @@ static PyGetSetDef Loop_tp_getsets[] = {
     {"alive", (getter)Loop_alive_get, NULL, "Indicates if the loop is still running / alive", NULL},
     {"default", (getter)Loop_default_get, NULL, "Is this the default loop?", NULL},
     {"handles", (getter)Loop_handles_get, NULL, "Returns a list with all handles in the Loop", NULL},
+    {"buffer_pool_chunk_size", (getter)Loop_buffer_pool_chunk_size_get, (setter)Loop_buffer_pool_chunk_size_set, "Default size of the chunks used for reading data", NULL},
+    {"request_pool_stats", (getter)Loop_request_pool_stats_get, NULL, "Returns usage counters of the request context pools", NULL},
+    {"buffer_pool_max_free", (getter)Loop_buffer_pool_max_free_get, (setter)Loop_buffer_pool_max_free_set, "Maximum number of idle chunks kept per chunk size", NULL},
+    {"metrics", (getter)Loop_metrics_get, NULL, "Returns the loop metrics counters", NULL},
+    {"metrics_enabled", (getter)Loop_metrics_enabled_get, (setter)Loop_metrics_enabled_set, "Collect loop metrics", NULL},
+    {"handle_stats", (getter)Loop_handle_stats_get, NULL, "Returns the counters of all handles in the Loop added together", NULL},
+    {"handle_stats_enabled", (getter)Loop_handle_stats_enabled_get, (setter)Loop_handle_stats_enabled_set, "Collect counters for new handles", NULL},
     {NULL}
 };
 
@@ -0,0 +1,264 @@
+/* Loop metrics
+ *
+ * When enabled, every loop keeps track of the time spent in each phase of an
+ * iteration and of the duration of the callbacks it dispatches. Phase changes
+ * are reported by hooks in the bundled libuv (see pyuv__loop_run_phase), so
+ * per-phase timing is not available when building against a system libuv.
+ * All counters are only touched from the loop thread. Per handle counters
+ * are kept in a handle_stats structure, see handle.c.
+ */
+
+
+static void
+pyuv__metrics_reset(loop_metrics *metrics)
+{
+    Bool enabled = metrics->enabled;
+
+    memset(metrics, 0, sizeof *metrics);
+    metrics->enabled = enabled;
+    metrics->phase = PYUV_LOOP_PHASE_NONE;
+}
+
+
+static INLINE void
+pyuv__metrics_phase(loop_metrics *metrics, int phase)
+{
+    uint64_t now;
+
+    if (!metrics->enabled) {
+        return;
+    }
+
+    now = uv_hrtime();
+    if (metrics->phase != PYUV_LOOP_PHASE_NONE) {
+        metrics->phase_time[metrics->phase] += now - metrics->phase_start;
+    }
+    if (metrics->phase == PYUV_LOOP_PHASE_IO && phase != PYUV_LOOP_PHASE_IO) {
+        if (metrics->poll_events > metrics->max_events) {
+            metrics->max_events = metrics->poll_events;
+        }
+        metrics->poll_events = 0;
+    }
+
+    metrics->phase = phase;
+    metrics->phase_start = now;
+}
+
+
+static INLINE void
+pyuv__metrics_callback(loop_metrics *metrics, uint64_t duration)
+{
+    uint64_t usecs;
+    int bucket;
+
+    metrics->callbacks++;
+    metrics->callback_time += duration;
+    if (duration > metrics->callback_max) {
+        metrics->callback_max = duration;
+    }
+    if (metrics->phase == PYUV_LOOP_PHASE_IO) {
+        metrics->events++;
+        metrics->poll_events++;
+    }
+
+    bucket = 0;
+    for (usecs = duration / 1000; usecs != 0 && bucket < PYUV_LATENCY_BUCKETS - 1; usecs >>= 1) {
+        bucket++;
+    }
+    metrics->latency[bucket]++;
+}
+
+
+static PyObject *
+pyuv__metrics_result(loop_metrics *metrics)
+{
+    int i;
+    PyObject *result, *histogram;
+
+    result = PyStructSequence_New(&LoopMetricsResultType);
+    if (!result) {
+        return NULL;
+    }
+
+    histogram = PyTuple_New(PYUV_LATENCY_BUCKETS);
+    if (!histogram) {
+        Py_DECREF(result);
+        return NULL;
+    }
+    for (i = 0; i < PYUV_LATENCY_BUCKETS; i++) {
+        PyTuple_SET_ITEM(histogram, i, PyLong_FromUnsignedLongLong(metrics->latency[i]));
+    }
+
+    PyStructSequence_SET_ITEM(result, 0, PyLong_FromUnsignedLongLong(metrics->iterations));
+    PyStructSequence_SET_ITEM(result, 1, PyFloat_FromDouble(metrics->phase_time[PYUV_LOOP_PHASE_POLL] / 1e9));
+    PyStructSequence_SET_ITEM(result, 2, PyFloat_FromDouble(metrics->phase_time[PYUV_LOOP_PHASE_TIMERS] / 1e9));
+    PyStructSequence_SET_ITEM(result, 3, PyFloat_FromDouble(metrics->phase_time[PYUV_LOOP_PHASE_PENDING] / 1e9));
+    PyStructSequence_SET_ITEM(result, 4, PyFloat_FromDouble(metrics->phase_time[PYUV_LOOP_PHASE_IDLE] / 1e9));
+    PyStructSequence_SET_ITEM(result, 5, PyFloat_FromDouble(metrics->phase_time[PYUV_LOOP_PHASE_PREPARE] / 1e9));
+    PyStructSequence_SET_ITEM(result, 6, PyFloat_FromDouble(metrics->phase_time[PYUV_LOOP_PHASE_IO] / 1e9));
+    PyStructSequence_SET_ITEM(result, 7, PyFloat_FromDouble(metrics->phase_time[PYUV_LOOP_PHASE_CHECK] / 1e9));
+    PyStructSequence_SET_ITEM(result, 8, PyFloat_FromDouble(metrics->phase_time[PYUV_LOOP_PHASE_CLOSING] / 1e9));
+    PyStructSequence_SET_ITEM(result, 9, PyLong_FromUnsignedLongLong(metrics->events));
+    PyStructSequence_SET_ITEM(result, 10, PyLong_FromUnsignedLongLong(metrics->max_events));
+    PyStructSequence_SET_ITEM(result, 11, PyLong_FromUnsignedLongLong(metrics->callbacks));
+    PyStructSequence_SET_ITEM(result, 12, PyFloat_FromDouble(metrics->callback_time / 1e9));
+    PyStructSequence_SET_ITEM(result, 13, PyFloat_FromDouble(metrics->callback_max / 1e9));
+    PyStructSequence_SET_ITEM(result, 14, histogram);
+
+    if (PyErr_Occurred()) {
+        Py_DECREF(result);
+        return NULL;
+    }
+
+    return result;
+}
+
+
+static void
+pyuv__handle_stats_add(handle_stats *total, const handle_stats *stats)
+{
+    total->bytes_read += stats->bytes_read;
+    total->bytes_written += stats->bytes_written;
+    total->callbacks += stats->callbacks;
+    total->callback_time += stats->callback_time;
+    if (stats->callback_max > total->callback_max) {
+        total->callback_max = stats->callback_max;
+    }
+    if (stats->write_queue_max > total->write_queue_max) {
+        total->write_queue_max = stats->write_queue_max;
+    }
+}
+
+
+static PyObject *
+pyuv__handle_stats_result(const handle_stats *stats)
+{
+    PyObject *result;
+
+    result = PyStructSequence_New(&HandleStatsResultType);
+    if (!result) {
+        return NULL;
+    }
+
+    PyStructSequence_SET_ITEM(result, 0, PyLong_FromUnsignedLongLong(stats->bytes_read));
+    PyStructSequence_SET_ITEM(result, 1, PyLong_FromUnsignedLongLong(stats->bytes_written));
+    PyStructSequence_SET_ITEM(result, 2, PyLong_FromUnsignedLongLong(stats->callbacks));
+    PyStructSequence_SET_ITEM(result, 3, PyFloat_FromDouble(stats->callback_time / 1e9));
+    PyStructSequence_SET_ITEM(result, 4, PyFloat_FromDouble(stats->callback_max / 1e9));
+    PyStructSequence_SET_ITEM(result, 5, PyLong_FromSize_t(stats->write_queue_max));
+
+    if (PyErr_Occurred()) {
+        Py_DECREF(result);
+        return NULL;
+    }
+
+    return result;
+}
+
+
+/* Slow callback watchdog
+ *
+ * A thread which wakes up periodically and, if the callback currently run by
+ * the loop has been running for longer than the threshold, writes the Python
+ * traceback of the loop thread to the configured file descriptor. Like
+ * faulthandler, frames are read without holding the GIL, so this is a best
+ * effort debugging aid. Each callback is only reported once.
+ */
+#ifdef PYUV_HAVE_DUMP_TRACEBACK
+#ifdef PYUV_WINDOWS
+# include <io.h>
+# define pyuv__write _write
+#else
+# define pyuv__write write
+#endif
+
+static void
+pyuv__watchdog_thread(void *arg)
+{
+    slow_callback_state *state = arg;
+    uint64_t start, dumped, interval;
+    char msg[128];
+    int len;
+
+    dumped = 0;
+    interval = state->threshold / 2;
+    if (interval < 1000000) {
+        interval = 1000000;
+    }
+
+    uv_mutex_lock(&state->lock);
+    while (!state->watchdog_stop) {
+        uv_cond_timedwait(&state->cond, &state->lock, interval);
+        start = state->start;
+        if (start == 0 || start == dumped || uv_hrtime() - start < state->threshold) {
+            continue;
+        }
+        dumped = start;
+        len = PyOS_snprintf(msg, sizeof msg, "pyuv: callback running for more than %.3f seconds\n", state->threshold / 1e9);
+        if (pyuv__write(state->stack_fd, msg, len) < 0) {
+            continue;
+        }
+        _Py_DumpTraceback(state->stack_fd, state->tstate);
+    }
+    uv_mutex_unlock(&state->lock);
+}
+#endif
+
+
+static void
+pyuv__watchdog_stop(slow_callback_state *state)
+{
+    if (!state->watchdog_running) {
+        return;
+    }
+
+    uv_mutex_lock(&state->lock);
+    state->watchdog_stop = True;
+    uv_cond_signal(&state->cond);
+    uv_mutex_unlock(&state->lock);
+
+    Py_BEGIN_ALLOW_THREADS
+    uv_thread_join(&state->watchdog);
+    Py_END_ALLOW_THREADS
+
+    uv_cond_destroy(&state->cond);
+    uv_mutex_destroy(&state->lock);
+    state->watchdog_running = False;
+}
+
+
+static int
+pyuv__watchdog_start(slow_callback_state *state)
+{
+#ifdef PYUV_HAVE_DUMP_TRACEBACK
+    int err;
+
+    ASSERT(!state->watchdog_running);
+
+    if (uv_mutex_init(&state->lock) != 0) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    if (uv_cond_init(&state->cond) != 0) {
+        uv_mutex_destroy(&state->lock);
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    state->watchdog_stop = False;
+    err = uv_thread_create(&state->watchdog, pyuv__watchdog_thread, state);
+    if (err < 0) {
+        uv_cond_destroy(&state->cond);
+        uv_mutex_destroy(&state->lock);
+        RAISE_UV_EXCEPTION(err, PyExc_RuntimeError);
+        return -1;
+    }
+
+    state->watchdog_running = True;
+    return 0;
+#else
+    UNUSED_ARG(state);
+    PyErr_SetString(PyExc_NotImplementedError, "stack dumps are not supported on this Python version");
+    return -1;
+#endif
+}
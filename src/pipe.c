@@ -1,10 +1,18 @@
+#ifndef PYUV_WINDOWS
+#include <sys/socket.h>
+#endif
+
+/* Max number of handles sent in a single message, libuv receives up to 64 */
+#define PYUV_PIPE_MAX_SEND_HANDLES 64
+
 
 static void
 pyuv__pipe_listen_cb(uv_stream_t* handle, int status)
 {
-    PyGILState_STATE gstate = PyGILState_Ensure();
+    gil_state gstate = pyuv__gil_ensure(handle->loop);
     Pipe *self;
     PyObject *result, *py_errorno;
+    uint64_t start;
     ASSERT(handle);
 
     self = PYUV_CONTAINER_OF(handle, Pipe, pipe_h);
@@ -19,7 +27,9 @@ pyuv__pipe_listen_cb(uv_stream_t* handle, int status)
         Py_INCREF(Py_None);
     }
 
+    start = pyuv__handle_call_start(HANDLE(self));
     result = PyObject_CallFunctionObjArgs(self->on_new_connection_cb, self, py_errorno, NULL);
+    pyuv__handle_call_end(HANDLE(self), self->on_new_connection_cb, start);
     if (result == NULL) {
         handle_uncaught_exception(HANDLE(self)->loop);
     }
@@ -27,16 +37,17 @@ pyuv__pipe_listen_cb(uv_stream_t* handle, int status)
     Py_DECREF(py_errorno);
 
     Py_DECREF(self);
-    PyGILState_Release(gstate);
+    pyuv__gil_release(gstate);
 }
 
 
 static void
 pyuv__pipe_connect_cb(uv_connect_t *req, int status)
 {
-    PyGILState_STATE gstate = PyGILState_Ensure();
+    gil_state gstate = pyuv__gil_ensure(req->handle->loop);
     Pipe *self;
     PyObject *callback, *result, *py_errorno;
+    uint64_t start;
     ASSERT(req);
 
     self = PYUV_CONTAINER_OF(req->handle, Pipe, pipe_h);
@@ -51,7 +62,9 @@ pyuv__pipe_connect_cb(uv_connect_t *req, int status)
         Py_INCREF(Py_None);
     }
 
+    start = pyuv__handle_call_start(HANDLE(self));
     result = PyObject_CallFunctionObjArgs(callback, self, py_errorno, NULL);
+    pyuv__handle_call_end(HANDLE(self), callback, start);
     if (result == NULL) {
         handle_uncaught_exception(HANDLE(self)->loop);
     }
@@ -59,12 +72,12 @@ pyuv__pipe_connect_cb(uv_connect_t *req, int status)
     Py_DECREF(py_errorno);
 
     Py_DECREF(callback);
-    PyMem_Free(req);
+    pyuv__request_pool_free(req->handle->loop->data, PYUV_REQUEST_POOL_CONNECT, req);
 
     /* Refcount was increased in the caller function */
     Py_DECREF(self);
 
-    PyGILState_Release(gstate);
+    pyuv__gil_release(gstate);
 }
 
 
@@ -202,10 +215,9 @@ Pipe_func_connect(Pipe *self, PyObject *args)
 
     Py_INCREF(callback);
 
-    connect_req = PyMem_Malloc(sizeof *connect_req);
+    connect_req = pyuv__request_pool_alloc(HANDLE(self)->loop, PYUV_REQUEST_POOL_CONNECT, sizeof *connect_req);
     if (!connect_req) {
         Py_DECREF(callback);
-        PyErr_NoMemory();
         return NULL;
     }
 
@@ -272,6 +284,152 @@ Pipe_func_pending_handle_type(Pipe *self)
 }
 
 
+static PyObject *
+Pipe_func_pending_count(Pipe *self)
+{
+    RAISE_IF_HANDLE_NOT_INITIALIZED(self, NULL);
+    RAISE_IF_HANDLE_CLOSED(self, PyExc_HandleClosedError, NULL);
+
+    return PyInt_FromLong(uv_pipe_pending_count(&self->pipe_h));
+}
+
+
+/* Send several handles with a single sendmsg call, all their fds go in the
+ * same SCM_RIGHTS message. Like try_write it never queues anything, it fails
+ * with UV_EAGAIN if there are pending writes, which it could overtake.
+ */
+static PyObject *
+Pipe_func_try_send_handles(Pipe *self, PyObject *args)
+{
+#ifdef PYUV_WINDOWS
+    UNUSED_ARG(args);
+
+    RAISE_IF_HANDLE_NOT_INITIALIZED(self, NULL);
+    RAISE_IF_HANDLE_CLOSED(self, PyExc_HandleClosedError, NULL);
+
+    RAISE_UV_EXCEPTION(UV_ENOTSUP, PyExc_PipeError);
+    return NULL;
+#else
+    int err, fd, *fds;
+    uv_os_fd_t handle_fd;
+    ssize_t r;
+    Py_ssize_t i, count;
+    Py_buffer view;
+    PyObject *handles, *seq, *item;
+    struct msghdr msg;
+    struct iovec iov;
+    union {
+        char data[CMSG_SPACE(PYUV_PIPE_MAX_SEND_HANDLES * sizeof(int))];
+        struct cmsghdr alias;
+    } scratch;
+    struct cmsghdr *cmsg;
+
+    RAISE_IF_HANDLE_NOT_INITIALIZED(self, NULL);
+    RAISE_IF_HANDLE_CLOSED(self, PyExc_HandleClosedError, NULL);
+
+    if (!PyArg_ParseTuple(args, PYUV_BYTES"*O:try_send_handles", &view, &handles)) {
+        return NULL;
+    }
+
+    seq = NULL;
+
+    if (view.len == 0) {
+        PyErr_SetString(PyExc_ValueError, "at least one byte of data is required");
+        goto error;
+    }
+
+    if (!self->pipe_h.ipc) {
+        RAISE_UV_EXCEPTION(UV_EINVAL, PyExc_PipeError);
+        goto error;
+    }
+
+    /* Data queued while corked goes first */
+    if (pyuv__stream_cork_flush((Stream *)self) < 0) {
+        goto error;
+    }
+    if (self->pipe_h.write_queue_size != 0) {
+        RAISE_UV_EXCEPTION(UV_EAGAIN, PyExc_PipeError);
+        goto error;
+    }
+
+    seq = PySequence_Fast(handles, "handles must be a sequence");
+    if (seq == NULL) {
+        goto error;
+    }
+
+    count = PySequence_Fast_GET_SIZE(seq);
+    if (count < 1 || count > PYUV_PIPE_MAX_SEND_HANDLES) {
+        PyErr_Format(PyExc_ValueError, "between 1 and %d handles can be sent at once", PYUV_PIPE_MAX_SEND_HANDLES);
+        goto error;
+    }
+
+    memset(&scratch, 0, sizeof scratch);
+    memset(&msg, 0, sizeof msg);
+    iov.iov_base = view.buf;
+    iov.iov_len = view.len;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = scratch.data;
+    msg.msg_controllen = CMSG_SPACE(count * sizeof(int));
+
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(count * sizeof(int));
+    fds = (int *)CMSG_DATA(cmsg);
+
+    for (i = 0; i < count; i++) {
+        item = PySequence_Fast_GET_ITEM(seq, i);
+        if (PyObject_IsSubclass((PyObject *)item->ob_type, (PyObject *)&StreamType)) {
+            if (UV_HANDLE(item)->type != UV_TCP && UV_HANDLE(item)->type != UV_NAMED_PIPE) {
+                PyErr_SetString(PyExc_TypeError, "Only TCP and Pipe objects are supported");
+                goto error;
+            }
+        } else if (!PyObject_IsSubclass((PyObject *)item->ob_type, (PyObject *)&UDPType)) {
+            PyErr_SetString(PyExc_TypeError, "Only Stream and UDP objects are supported");
+            goto error;
+        }
+        if (!HANDLE(item)->initialized) {
+            PyErr_SetString(PyExc_RuntimeError, "Object was not initialized, forgot to call __init__?");
+            goto error;
+        }
+        err = uv_fileno(UV_HANDLE(item), &handle_fd);
+        if (err < 0) {
+            RAISE_UV_EXCEPTION(err, PyExc_PipeError);
+            goto error;
+        }
+        fds[i] = handle_fd;
+    }
+
+    err = uv_fileno(UV_HANDLE(self), &handle_fd);
+    if (err < 0) {
+        RAISE_UV_EXCEPTION(err, PyExc_PipeError);
+        goto error;
+    }
+    fd = handle_fd;
+
+    do {
+        r = sendmsg(fd, &msg, 0);
+    } while (r < 0 && errno == EINTR);
+    if (r < 0) {
+        err = -errno;
+        RAISE_UV_EXCEPTION(err, PyExc_PipeError);
+        goto error;
+    }
+    pyuv__handle_stats_written(HANDLE(self), (size_t)r);
+
+    Py_DECREF(seq);
+    PyBuffer_Release(&view);
+    return PyInt_FromSsize_t((Py_ssize_t)r);
+
+error:
+    Py_XDECREF(seq);
+    PyBuffer_Release(&view);
+    return NULL;
+#endif
+}
+
+
 static PyObject *
 Pipe_func_write(Pipe *self, PyObject *args)
 {
@@ -553,7 +711,9 @@ Pipe_tp_methods[] = {
     { "open", (PyCFunction)Pipe_func_open, METH_VARARGS, "Open the specified file descriptor and manage it as a Pipe." },
     { "pending_instances", (PyCFunction)Pipe_func_pending_instances, METH_VARARGS, "Set the number of pending pipe instance handles when the pipe server is waiting for connections." },
     { "pending_handle_type", (PyCFunction)Pipe_func_pending_handle_type, METH_NOARGS, "Returns the type of the next pending handle. Can be called multiple times." },
+    { "pending_count", (PyCFunction)Pipe_func_pending_count, METH_NOARGS, "Returns the number of pending handles which can be accepted." },
     { "write", (PyCFunction)Pipe_func_write, METH_VARARGS, "Write data and send handle over a pipe." },
+    { "try_send_handles", (PyCFunction)Pipe_func_try_send_handles, METH_VARARGS, "Try to send several handles over a pipe in a single message." },
     { "getsockname", (PyCFunction)Pipe_func_getsockname, METH_NOARGS, "Get bound pipe name." },
     { "getpeername", (PyCFunction)Pipe_func_getpeername, METH_NOARGS, "Get bound pipe name." },
     { NULL }
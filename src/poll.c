@@ -2,9 +2,10 @@
 static void
 pyuv__poll_cb(uv_poll_t *handle, int status, int events)
 {
-    PyGILState_STATE gstate = PyGILState_Ensure();
+    gil_state gstate = pyuv__gil_ensure(handle->loop);
     Poll *self;
     PyObject *result, *py_events, *py_errorno;
+    uint64_t start;
 
     ASSERT(handle);
 
@@ -23,14 +24,16 @@ pyuv__poll_cb(uv_poll_t *handle, int status, int events)
         py_errorno = PyInt_FromLong((long)status);
     }
 
+    start = pyuv__handle_call_start(HANDLE(self));
     result = PyObject_CallFunctionObjArgs(self->callback, self, py_events, py_errorno, NULL);
+    pyuv__handle_call_end(HANDLE(self), self->callback, start);
     if (result == NULL) {
         handle_uncaught_exception(HANDLE(self)->loop);
     }
     Py_XDECREF(result);
 
     Py_DECREF(self);
-    PyGILState_Release(gstate);
+    pyuv__gil_release(gstate);
 }
 
 
@@ -176,9 +176,10 @@ static PyObject* Process_tp_new(PyTypeObject *type, PyObject *args, PyObject *kw
 static void
 pyuv__process_exit_cb(uv_process_t *handle, int64_t exit_status, int term_signal)
 {
-    PyGILState_STATE gstate = PyGILState_Ensure();
+    gil_state gstate = pyuv__gil_ensure(handle->loop);
     Process *self;
     PyObject *result, *py_exit_status, *py_term_signal;
+    uint64_t start;
 
     ASSERT(handle);
 
@@ -188,7 +189,9 @@ pyuv__process_exit_cb(uv_process_t *handle, int64_t exit_status, int term_signal
     py_term_signal = PyInt_FromLong(term_signal);
 
     if (self->on_exit_cb != Py_None) {
+        start = pyuv__handle_call_start(HANDLE(self));
         result = PyObject_CallFunctionObjArgs(self->on_exit_cb, self, py_exit_status, py_term_signal, NULL);
+        pyuv__handle_call_end(HANDLE(self), self->on_exit_cb, start);
         if (result == NULL) {
             handle_uncaught_exception(HANDLE(self)->loop);
         }
@@ -200,7 +203,7 @@ pyuv__process_exit_cb(uv_process_t *handle, int64_t exit_status, int term_signal
     /* Refcount was increased in the spawn function */
     Py_DECREF(self);
 
-    PyGILState_Release(gstate);
+    pyuv__gil_release(gstate);
 }
 
 
@@ -2,13 +2,21 @@
 #include "pyuv.h"
 
 #include "common.c"
+#include "bufferpool.c"
+#include "requestpool.c"
+#include "metrics.c"
 #include "errno.c"
 #include "error.c"
 #include "loop.c"
 #include "handle.c"
 #include "request.c"
 #include "async.c"
+#include "asyncqueue.c"
 #include "timer.c"
+#include "timerwheel.c"
+#if defined(__linux__)
+#include "hrtimer.c"
+#endif
 #include "prepare.c"
 #include "idle.c"
 #include "check.c"
@@ -74,6 +82,12 @@ init_pyuv(void)
     /* Initialize GIL */
     PyEval_InitThreads();
 
+#ifdef PYUV_LIBUV_POLL_HOOKS
+    uv__io_poll_enter_hook = pyuv__loop_poll_enter;
+    uv__io_poll_leave_hook = pyuv__loop_poll_leave;
+    uv__run_phase_hook = pyuv__loop_run_phase;
+#endif
+
 #ifdef PYUV_WINDOWS
     if (pyuv__setmaxstdio()) {
         return NULL;
@@ -155,7 +169,12 @@ init_pyuv(void)
 
     /* Types */
     AsyncType.tp_base = &HandleType;
+    AsyncQueueType.tp_base = &HandleType;
     TimerType.tp_base = &HandleType;
+    TimerWheelType.tp_base = &HandleType;
+#if defined(__linux__)
+    HRTimerType.tp_base = &HandleType;
+#endif
     PrepareType.tp_base = &HandleType;
     IdleType.tp_base = &HandleType;
     CheckType.tp_base = &HandleType;
@@ -185,10 +204,27 @@ init_pyuv(void)
     if (PyType_Ready(&FSRequestType) < 0) {
         return NULL;
     }
+    if (PyType_Ready(&TimerWheelEntryType) < 0) {
+        return NULL;
+    }
+
+    /* initialize PyStructSequence types */
+    if (RequestPoolStatsResultType.tp_name == 0)
+        PyStructSequence_InitType(&RequestPoolStatsResultType, &request_pool_stats_result_desc);
+    if (LoopMetricsResultType.tp_name == 0)
+        PyStructSequence_InitType(&LoopMetricsResultType, &loop_metrics_result_desc);
+    if (HandleStatsResultType.tp_name == 0)
+        PyStructSequence_InitType(&HandleStatsResultType, &handle_stats_result_desc);
 
     PyUVModule_AddType(pyuv, "Loop", &LoopType);
+    PyUVModule_AddType(pyuv, "Buffer", &BufferType);
     PyUVModule_AddType(pyuv, "Async", &AsyncType);
+    PyUVModule_AddType(pyuv, "AsyncQueue", &AsyncQueueType);
     PyUVModule_AddType(pyuv, "Timer", &TimerType);
+    PyUVModule_AddType(pyuv, "TimerWheel", &TimerWheelType);
+#if defined(__linux__)
+    PyUVModule_AddType(pyuv, "HRTimer", &HRTimerType);
+#endif
     PyUVModule_AddType(pyuv, "Prepare", &PrepareType);
     PyUVModule_AddType(pyuv, "Idle", &IdleType);
     PyUVModule_AddType(pyuv, "Check", &CheckType);
@@ -216,9 +252,11 @@ init_pyuv(void)
     PyModule_AddIntMacro(pyuv, UV_UDP_PARTIAL);
     PyModule_AddIntMacro(pyuv, UV_UDP_IPV6ONLY);
     PyModule_AddIntMacro(pyuv, UV_UDP_REUSEADDR);
+    PyModule_AddIntMacro(pyuv, UV_UDP_REUSEPORT);
 
     /* TCP constants */
     PyModule_AddIntMacro(pyuv, UV_TCP_IPV6ONLY);
+    PyModule_AddIntMacro(pyuv, UV_TCP_REUSEPORT);
 
     /* Process constants */
     PyModule_AddIntMacro(pyuv, UV_PROCESS_SETUID);
@@ -24,6 +24,17 @@
 /* libuv */
 #include "uv.h"
 
+/* SO_REUSEPORT bind flags, with the values newer libuv versions use for them */
+#if UV_VERSION_HEX < 0x013100
+    #define PYUV_EMULATE_REUSEPORT
+    #define UV_TCP_REUSEPORT 2
+    #define UV_UDP_REUSEPORT 64
+#endif
+#if defined(PYUV_EMULATE_REUSEPORT) && !defined(_WIN32)
+    #include <sys/socket.h>
+    #include <unistd.h>
+#endif
+
 
 /* Custom types */
 typedef int Bool;
@@ -60,6 +71,17 @@ typedef int Bool;
 
 #define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
 
+/* Atomic pointer operations, for the lock-free queues */
+#if defined(_MSC_VER)
+# define PYUV_ATOMIC_CAS_PTR(ptr, oldval, newval)                                               \
+    (InterlockedCompareExchangePointer((PVOID volatile *)(ptr), (newval), (oldval)) == (oldval))
+# define PYUV_ATOMIC_XCHG_PTR(ptr, newval)                                                      \
+    InterlockedExchangePointer((PVOID volatile *)(ptr), (newval))
+#else
+# define PYUV_ATOMIC_CAS_PTR(ptr, oldval, newval) __sync_bool_compare_and_swap((ptr), (oldval), (newval))
+# define PYUV_ATOMIC_XCHG_PTR(ptr, newval) __sync_lock_test_and_set((ptr), (newval))
+#endif
+
 #define ASSERT(x)                                                           \
     do {                                                                    \
         if (!(x)) {                                                         \
@@ -145,9 +167,33 @@ typedef int Bool;
 
 #define PYUV_SLAB_SIZE 65536
 
+/* Receive buffer pools: one free list per power-of-two chunk size */
+#define PYUV_BUFFER_POOL_MIN_SHIFT  10    /* 1KB */
+#define PYUV_BUFFER_POOL_MAX_SHIFT  20    /* 1MB */
+#define PYUV_BUFFER_POOL_CLASSES    (PYUV_BUFFER_POOL_MAX_SHIFT - PYUV_BUFFER_POOL_MIN_SHIFT + 1)
+#define PYUV_BUFFER_POOL_MIN_SIZE   ((size_t)1 << PYUV_BUFFER_POOL_MIN_SHIFT)
+#define PYUV_BUFFER_POOL_MAX_SIZE   ((size_t)1 << PYUV_BUFFER_POOL_MAX_SHIFT)
+#define PYUV_BUFFER_POOL_MAX_FREE   16
+
+/* Request context pools: idle contexts kept around per kind */
+#define PYUV_REQUEST_POOL_MAX_FREE  128
+
+/* Corked writes are flushed once this many buffers are queued */
+#define PYUV_CORK_MAX_BUFS          1024
+
+/* Maximum number of datagrams received at once in UDP batch mode */
+#define PYUV_UDP_MAX_BATCH          1024
+
+/* AsyncQueue payloads from this size on are copied without holding the GIL */
+#define PYUV_ASYNC_QUEUE_NOGIL_SIZE 16384
+
 
 /* Custom pyuv handle flags */
-#define PYUV__PYREF    (1 << 1)
+#define PYUV__PYREF             (1 << 1)
+#define PYUV__READ_ZEROCOPY     (1 << 2)
+#define PYUV__READ_INTO_FACTORY (1 << 3)
+#define PYUV__UDP_GRO           (1 << 4)
+#define PYUV__READ_INTO_REPLAY  (1 << 5)
 
 #define PYUV_HANDLE_INCREF(obj)                        \
     do {                                               \
@@ -173,22 +219,181 @@ typedef int Bool;
 
 /* Python types definitions */
 
-/* Loop */
+/* Buffer pool */
+typedef struct buffer_pool_chunk {
+    struct buffer_pool_chunk *next;
+} buffer_pool_chunk;
+
+typedef struct {
+    buffer_pool_chunk *free_list;
+    size_t free_count;
+    size_t in_use;
+} buffer_pool_class;
+
+typedef struct {
+    uv_mutex_t lock;
+    size_t chunk_size;
+    size_t max_free;
+    buffer_pool_class classes[PYUV_BUFFER_POOL_CLASSES];
+} buffer_pool;
+
+/* Request context pool */
+enum {
+    PYUV_REQUEST_POOL_WRITE = 0,
+    PYUV_REQUEST_POOL_SHUTDOWN,
+    PYUV_REQUEST_POOL_CONNECT,
+    PYUV_REQUEST_POOL_UDP_SEND,
+    PYUV_REQUEST_POOL_KINDS
+};
+
+typedef struct request_pool_item {
+    struct request_pool_item *next;
+} request_pool_item;
+
+typedef struct {
+    request_pool_item *free_list;
+    size_t free_count;
+    size_t size;
+} request_pool_kind;
+
+typedef struct {
+    request_pool_kind kinds[PYUV_REQUEST_POOL_KINDS];
+    unsigned PY_LONG_LONG allocations;
+    unsigned PY_LONG_LONG reused;
+    size_t in_use;
+} request_pool;
+
+/* Loop metrics */
+enum {
+    PYUV_LOOP_PHASE_TIMERS = 0,
+    PYUV_LOOP_PHASE_PENDING,
+    PYUV_LOOP_PHASE_IDLE,
+    PYUV_LOOP_PHASE_PREPARE,
+    PYUV_LOOP_PHASE_IO,
+    PYUV_LOOP_PHASE_CHECK,
+    PYUV_LOOP_PHASE_CLOSING,
+    PYUV_LOOP_PHASE_POLL,
+    PYUV_LOOP_PHASES
+};
+
+#define PYUV_LOOP_PHASE_NONE    (-1)
+#define PYUV_LATENCY_BUCKETS    24
+
 typedef struct {
+    Bool enabled;
+    int phase;
+    uint64_t phase_start;
+    uint64_t phase_time[PYUV_LOOP_PHASES];
+    uint64_t iterations;
+    uint64_t events;
+    uint64_t poll_events;
+    uint64_t max_events;
+    uint64_t callbacks;
+    uint64_t callback_time;
+    uint64_t callback_max;
+    uint64_t latency[PYUV_LATENCY_BUCKETS];
+} loop_metrics;
+
+/* Per handle counters, see Handle.stats_enabled */
+typedef struct {
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+    uint64_t callbacks;
+    uint64_t callback_time;
+    uint64_t callback_max;
+    size_t write_queue_max;
+} handle_stats;
+
+/* Slow callback detection, see Loop.set_slow_callback_hook. Stack dumps use
+ * _Py_DumpTraceback, which is only declared in the public headers before 3.8 */
+#if defined(PYUV_PYTHON3) && !defined(PYPY_VERSION) && PY_VERSION_HEX < 0x03080000
+# define PYUV_HAVE_DUMP_TRACEBACK
+#endif
+
+typedef struct {
+    uint64_t threshold;
+    PyObject *hook;
+    /* callback being run and the thread running it, read by the watchdog thread */
+    volatile uint64_t start;
+    PyThreadState *volatile tstate;
+    int stack_fd;
+    Bool watchdog_running;
+    Bool watchdog_stop;
+    uv_thread_t watchdog;
+    uv_mutex_t lock;
+    uv_cond_t cond;
+} slow_callback_state;
+
+/* How a callback took the GIL, see pyuv__gil_ensure */
+enum {
+    PYUV_GIL_RESTORED = 0,
+    PYUV_GIL_ENSURED,
+    PYUV_GIL_HELD
+};
+
+#ifdef PYUV_LIBUV_POLL_HOOKS
+/* Defined in the bundled libuv, called around the blocking epoll_wait() */
+extern void (*uv__io_poll_enter_hook)(uv_loop_t* loop, int timeout);
+extern void (*uv__io_poll_leave_hook)(uv_loop_t* loop, int timeout);
+extern void (*uv__run_phase_hook)(uv_loop_t* loop, int phase);
+#endif
+
+typedef struct {
+    struct loop_s *loop;
+    int how;
+    PyGILState_STATE gstate;
+    uint64_t start;
+} gil_state;
+
+/* Loop */
+typedef struct loop_s {
     PyObject_HEAD
     PyObject *weakreflist;
     PyObject *dict;
     uv_loop_t loop_struct;
     uv_loop_t *uv_loop;
     int is_default;
+    buffer_pool buffer_pool;
+    request_pool request_pool;
+    /* streams with corked writes to be flushed at the end of the loop iteration */
+    PyObject *flush_pending;
+    uv_prepare_t flush_prepare;
+    uv_check_t flush_check;
+    Bool flush_handles_init;
+    /* thread state saved while run() has released the GIL */
+    PyThreadState *tstate;
+    /* run() holds the GIL for the whole iteration, except while polling */
+    Bool hold_gil;
+    loop_metrics metrics;
+    /* collect stats for handles created in this loop */
+    Bool handle_stats;
+    slow_callback_state slow_callback;
+    /* timers started in batch mode which expired, delivered before polling */
     struct {
-        char slab[PYUV_SLAB_SIZE];
-        Bool in_use;
-    } buffer;
+        struct timer_s **timers;
+        size_t count;
+        size_t capacity;
+        uv_prepare_t prepare;
+        Bool init;
+        /* last deadline picked for a timer with slack */
+        uint64_t slack_due;
+    } timer_batch;
 } Loop;
 
 static PyTypeObject LoopType;
 
+/* Buffer */
+typedef struct {
+    PyObject_HEAD
+    Loop *loop;
+    char *base;
+    size_t size;
+    Py_ssize_t len;
+    Py_ssize_t exports;
+} Buffer;
+
+static PyTypeObject BufferType;
+
 /* Handle */
 typedef struct {
     PyObject_HEAD
@@ -200,6 +405,9 @@ typedef struct {
     PyObject *dict;
     Loop *loop;
     PyObject *on_close_cb;
+    /* receive buffer size hint, 0 means use the loop's pool chunk size */
+    size_t read_buffer_size;
+    handle_stats *stats;
 } Handle;
 
 static PyTypeObject HandleType;
@@ -213,15 +421,85 @@ typedef struct {
 
 static PyTypeObject AsyncType;
 
-/* Timer */
+/* AsyncQueue */
+typedef struct async_queue_node_s {
+    struct async_queue_node_s *next;
+    /* NULL for raw bytes, which are stored in data */
+    PyObject *obj;
+    size_t len;
+    char data[1];
+} async_queue_node;
+
 typedef struct {
+    Handle handle;
+    uv_async_t async_h;
+    PyObject *callback;
+    /* pushed nodes, most recent first */
+    async_queue_node *volatile head;
+} AsyncQueue;
+
+static PyTypeObject AsyncQueueType;
+
+/* Timer */
+typedef struct timer_s {
     Handle handle;
     uv_timer_t timer_h;
     PyObject *callback;
+    /* the timer may fire up to this many milliseconds late, see pyuv__timer_slack_timeout */
+    uint64_t slack;
+    /* expirations are delivered together, see pyuv__timer_batch_deliver */
+    Bool batch;
+    int batch_state;
 } Timer;
 
 static PyTypeObject TimerType;
 
+/* TimerWheel */
+struct timer_wheel_s;
+
+typedef struct timer_wheel_entry_s {
+    PyObject_HEAD
+    struct timer_wheel_s *wheel;
+    PyObject *callback;
+    /* list the entry is linked in while scheduled, NULL otherwise */
+    struct timer_wheel_entry_s **list;
+    struct timer_wheel_entry_s *prev;
+    struct timer_wheel_entry_s *next;
+    uint64_t rounds;
+} TimerWheelEntry;
+
+static PyTypeObject TimerWheelEntryType;
+
+typedef struct timer_wheel_s {
+    Handle handle;
+    uv_timer_t timer_h;
+    uint64_t granularity;
+    uint64_t last_tick;
+    unsigned int nslots;
+    unsigned int current;
+    size_t count;
+    Bool running;
+    TimerWheelEntry **slots;
+    TimerWheelEntry *expired;
+} TimerWheel;
+
+static PyTypeObject TimerWheelType;
+
+#if defined(__linux__)
+/* HRTimer */
+typedef struct {
+    Handle handle;
+    uv_poll_t poll_h;
+    int fd;
+    uint64_t repeat;
+    /* interval the timerfd was armed with, changes to repeat only apply when started again */
+    uint64_t armed_repeat;
+    PyObject *callback;
+} HRTimer;
+
+static PyTypeObject HRTimerType;
+#endif
+
 /* Prepare */
 typedef struct {
     Handle handle;
@@ -268,9 +546,39 @@ typedef struct {
 static PyTypeObject SignalCheckerType;
 
 /* Stream */
+typedef struct {
+    char *base;
+    size_t size;
+    size_t len;
+} read_batch_chunk;
+
 typedef struct {
     Handle handle;
     PyObject *on_read_cb;
+    /* for start_read_into: buffer factory or fixed buffer, and the buffer being read into */
+    PyObject *read_into;
+    Py_buffer read_into_view;
+    /* writes queued while the stream is corked */
+    struct {
+        Bool corked;
+        Bool autocork;
+        Py_buffer *views;
+        Py_ssize_t view_count;
+        Py_ssize_t view_capacity;
+        size_t size;
+        PyObject *callbacks;
+    } cork;
+    /* pooled chunks read and not delivered yet in batch read mode */
+    struct {
+        size_t limit;
+        Bool join;
+        read_batch_chunk *chunks;
+        size_t count;
+        size_t capacity;
+        size_t size;
+    } read_batch;
+    /* queued in the loop's flush_pending list */
+    Bool flush_scheduled;
 } Stream;
 
 static PyTypeObject StreamType;
@@ -306,6 +614,7 @@ typedef struct {
     Handle handle;
     uv_udp_t udp_h;
     PyObject *on_read_cb;
+    struct udp_recv_batch_s *recv_batch;
 } UDP;
 
 static PyTypeObject UDPType;
@@ -453,6 +762,9 @@ typedef struct {
     Py_buffer view;
     /* for read requests */
     uv_buf_t buf;
+    /* for requests using caller provided buffers */
+    Py_buffer *views;
+    int view_count;
 } FSRequest;
 
 static PyTypeObject FSRequestType;
@@ -483,6 +795,76 @@ static PyObject* PyExc_UVError;
 
 /* PyStructSequence types */
 
+/* used by Loop.request_pool_stats */
+static PyTypeObject RequestPoolStatsResultType;
+
+static PyStructSequence_Field request_pool_stats_result_fields[] = {
+    {"allocations", "total number of request contexts handed out"},
+    {"reused",      "number of contexts taken from the free lists"},
+    {"in_use",      "number of contexts currently in use"},
+    {"free",        "number of idle contexts in the free lists"},
+    {NULL}
+};
+
+static PyStructSequence_Desc request_pool_stats_result_desc = {
+    "request_pool_stats_result",
+    NULL,
+    request_pool_stats_result_fields,
+    4
+};
+
+
+/* used by Loop.metrics */
+static PyTypeObject LoopMetricsResultType;
+
+static PyStructSequence_Field loop_metrics_result_fields[] = {
+    {"iterations",          "number of loop iterations"},
+    {"idle_time",           "seconds spent blocked waiting for i/o"},
+    {"timers_time",         "seconds spent running timers"},
+    {"pending_time",        "seconds spent running pending callbacks"},
+    {"idle_handles_time",   "seconds spent running idle handles"},
+    {"prepare_time",        "seconds spent running prepare handles"},
+    {"io_time",             "seconds spent dispatching i/o events"},
+    {"check_time",          "seconds spent running check handles"},
+    {"closing_time",        "seconds spent running close callbacks"},
+    {"events",              "number of callbacks run for i/o events"},
+    {"max_events",          "largest number of i/o callbacks run after a single poll"},
+    {"callbacks",           "number of callbacks run"},
+    {"callback_time",       "seconds spent running callbacks"},
+    {"callback_max_time",   "duration of the slowest callback, in seconds"},
+    {"latency_histogram",   "callback counts by duration, bucket i counts callbacks under 2**i microseconds"},
+    {NULL}
+};
+
+static PyStructSequence_Desc loop_metrics_result_desc = {
+    "loop_metrics_result",
+    NULL,
+    loop_metrics_result_fields,
+    15
+};
+
+
+/* used by Handle.stats and Loop.handle_stats */
+static PyTypeObject HandleStatsResultType;
+
+static PyStructSequence_Field handle_stats_result_fields[] = {
+    {"bytes_read",          "number of bytes read"},
+    {"bytes_written",       "number of bytes written"},
+    {"callbacks",           "number of callbacks run"},
+    {"callback_time",       "seconds spent running callbacks"},
+    {"callback_max_time",   "duration of the slowest callback, in seconds"},
+    {"write_queue_max",     "largest number of bytes queued for writing"},
+    {NULL}
+};
+
+static PyStructSequence_Desc handle_stats_result_desc = {
+    "handle_stats_result",
+    NULL,
+    handle_stats_result_fields,
+    6
+};
+
+
 /* used by getaddrinfo */
 static PyTypeObject AddrinfoResultType;
 
@@ -551,6 +933,24 @@ static PyStructSequence_Desc dirent_desc = {
 };
 
 
+/* used by walk */
+static PyTypeObject WalkEntryType;
+
+static PyStructSequence_Field walk_entry_fields[] = {
+    {"path", ""},
+    {"type", ""},
+    {"stat", ""},
+    {NULL}
+};
+
+static PyStructSequence_Desc walk_entry_desc = {
+    "WalkEntry",
+    NULL,
+    walk_entry_fields,
+    3
+};
+
+
 /* used by interface_addresses */
 static PyTypeObject InterfaceAddressesResultType;
 
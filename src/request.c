@@ -508,6 +508,8 @@ FSRequest_tp_new(PyTypeObject *type, PyObject *args, PyObject *kwargs)
     self->path = NULL;
     self->result = NULL;
     self->error = NULL;
+    self->views = NULL;
+    self->view_count = 0;
     return (PyObject *)self;
 }
 
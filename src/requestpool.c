@@ -0,0 +1,123 @@
+/* Request context pools
+ *
+ * Writes, shutdowns, connects and UDP sends need a small fixed-size context
+ * which lives until the request callback runs. Instead of a malloc / free pair
+ * for each of them, every loop keeps a free list per kind of context. Contexts
+ * are always taken and given back with the GIL held.
+ */
+
+
+static void
+pyuv__request_pool_init(request_pool *pool)
+{
+    memset(pool, 0, sizeof *pool);
+}
+
+
+static void *
+pyuv__request_pool_alloc(Loop *loop, int kind, size_t size)
+{
+    request_pool *pool;
+    request_pool_kind *k;
+    request_pool_item *item;
+
+    ASSERT(kind >= 0 && kind < PYUV_REQUEST_POOL_KINDS);
+    pool = &loop->request_pool;
+    k = &pool->kinds[kind];
+    ASSERT(k->size == 0 || k->size == size);
+    ASSERT(size >= sizeof(request_pool_item));
+
+    item = k->free_list;
+    if (item != NULL) {
+        k->free_list = item->next;
+        k->free_count--;
+        pool->reused++;
+    } else {
+        item = PyMem_Malloc(size);
+        if (item == NULL) {
+            PyErr_NoMemory();
+            return NULL;
+        }
+        k->size = size;
+    }
+
+    pool->allocations++;
+    pool->in_use++;
+    return item;
+}
+
+
+static void
+pyuv__request_pool_free(Loop *loop, int kind, void *ptr)
+{
+    request_pool *pool;
+    request_pool_kind *k;
+    request_pool_item *item;
+
+    ASSERT(kind >= 0 && kind < PYUV_REQUEST_POOL_KINDS);
+    pool = &loop->request_pool;
+    k = &pool->kinds[kind];
+
+    ASSERT(pool->in_use > 0);
+    pool->in_use--;
+
+    if (k->free_count >= PYUV_REQUEST_POOL_MAX_FREE) {
+        PyMem_Free(ptr);
+        return;
+    }
+
+    item = (request_pool_item *)ptr;
+    item->next = k->free_list;
+    k->free_list = item;
+    k->free_count++;
+}
+
+
+static void
+pyuv__request_pool_destroy(request_pool *pool)
+{
+    int i;
+    request_pool_kind *k;
+    request_pool_item *item;
+
+    for (i = 0; i < PYUV_REQUEST_POOL_KINDS; i++) {
+        k = &pool->kinds[i];
+        while (k->free_list != NULL) {
+            item = k->free_list;
+            k->free_list = item->next;
+            PyMem_Free(item);
+        }
+        k->free_count = 0;
+    }
+}
+
+
+static PyObject *
+pyuv__request_pool_stats(request_pool *pool)
+{
+    int i;
+    size_t free_count;
+    PyObject *result;
+
+    result = PyStructSequence_New(&RequestPoolStatsResultType);
+    if (!result) {
+        return NULL;
+    }
+
+    free_count = 0;
+    for (i = 0; i < PYUV_REQUEST_POOL_KINDS; i++) {
+        free_count += pool->kinds[i].free_count;
+    }
+
+    PyStructSequence_SET_ITEM(result, 0, PyLong_FromUnsignedLongLong(pool->allocations));
+    PyStructSequence_SET_ITEM(result, 1, PyLong_FromUnsignedLongLong(pool->reused));
+    PyStructSequence_SET_ITEM(result, 2, PyLong_FromSize_t(pool->in_use));
+    PyStructSequence_SET_ITEM(result, 3, PyLong_FromSize_t(free_count));
+
+    if (PyErr_Occurred()) {
+        Py_DECREF(result);
+        return NULL;
+    }
+
+    return result;
+}
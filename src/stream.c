@@ -3,6 +3,7 @@ typedef struct {
     uv_write_t req;
     Stream *obj;
     PyObject *callback;
+    PyObject *callbacks;
     PyObject *send_handle;
     Py_buffer *views;
     Py_buffer viewsml[4];
@@ -20,10 +21,11 @@ typedef struct {
 static void
 pyuv__stream_shutdown_cb(uv_shutdown_t* req, int status)
 {
-    PyGILState_STATE gstate = PyGILState_Ensure();
+    gil_state gstate = pyuv__gil_ensure(req->handle->loop);
     stream_shutdown_ctx *ctx;
     Stream *self;
     PyObject *callback, *result, *py_errorno;
+    uint64_t start;
 
     ctx = PYUV_CONTAINER_OF(req, stream_shutdown_ctx, req);
     self = ctx->obj;
@@ -36,7 +38,9 @@ pyuv__stream_shutdown_cb(uv_shutdown_t* req, int status)
             py_errorno = Py_None;
             Py_INCREF(Py_None);
         }
+        start = pyuv__handle_call_start(HANDLE(self));
         result = PyObject_CallFunctionObjArgs(callback, self, py_errorno, NULL);
+        pyuv__handle_call_end(HANDLE(self), callback, start);
         if (result == NULL) {
             handle_uncaught_exception(HANDLE(self)->loop);
         }
@@ -45,22 +49,22 @@ pyuv__stream_shutdown_cb(uv_shutdown_t* req, int status)
     }
 
     Py_DECREF(callback);
-    PyMem_Free(req);
+    pyuv__request_pool_free(req->handle->loop->data, PYUV_REQUEST_POOL_SHUTDOWN, ctx);
 
     /* Refcount was increased in the caller function */
     Py_DECREF(self);
 
-    PyGILState_Release(gstate);
+    pyuv__gil_release(gstate);
 }
 
 
 static void
 pyuv__stream_read_cb(uv_stream_t* handle, int nread, const uv_buf_t* buf)
 {
-    PyGILState_STATE gstate = PyGILState_Ensure();
-    Loop *loop;
+    gil_state gstate = pyuv__gil_ensure(handle->loop);
     Stream *self;
     PyObject *result, *data, *py_errorno;
+    uint64_t start;
     ASSERT(handle);
 
     /* Can't use container_of here */
@@ -70,7 +74,18 @@ pyuv__stream_read_cb(uv_stream_t* handle, int nread, const uv_buf_t* buf)
     Py_INCREF(self);
 
     if (nread >= 0) {
-        data = PyBytes_FromStringAndSize(buf->base, nread);
+        pyuv__handle_stats_read(HANDLE(self), (size_t)nread);
+        if (HANDLE(self)->flags & PYUV__READ_ZEROCOPY) {
+            /* The Buffer object takes ownership of the chunk */
+            data = pyuv__alloc_to_buffer((uv_handle_t *)handle, buf, nread);
+            buf = NULL;
+        } else {
+            data = PyBytes_FromStringAndSize(buf->base, nread);
+        }
+        if (data == NULL) {
+            handle_uncaught_exception(HANDLE(self)->loop);
+            goto done;
+        }
         py_errorno = Py_None;
         Py_INCREF(Py_None);
     } else {
@@ -81,7 +96,9 @@ pyuv__stream_read_cb(uv_stream_t* handle, int nread, const uv_buf_t* buf)
         uv_read_stop(handle);
     }
 
+    start = pyuv__handle_call_start(HANDLE(self));
     result = PyObject_CallFunctionObjArgs(self->on_read_cb, self, data, py_errorno, NULL);
+    pyuv__handle_call_end(HANDLE(self), self->on_read_cb, start);
     if (result == NULL) {
         handle_uncaught_exception(HANDLE(self)->loop);
     }
@@ -89,60 +106,744 @@ pyuv__stream_read_cb(uv_stream_t* handle, int nread, const uv_buf_t* buf)
     Py_DECREF(data);
     Py_DECREF(py_errorno);
 
-    /* data has been read, unlock the buffer */
-    loop = handle->loop->data;
-    ASSERT(loop);
-    loop->buffer.in_use = False;
+done:
+    /* data has been read, return the buffer to the pool */
+    if (buf != NULL) {
+        pyuv__alloc_release((uv_handle_t *)handle, buf);
+    }
 
     Py_DECREF(self);
-    PyGILState_Release(gstate);
+    pyuv__gil_release(gstate);
 }
 
 
+/* Give the chunks read in batch mode back to the pool without delivering them */
 static void
-pyuv__stream_write_cb(uv_write_t* req, int status)
+pyuv__stream_read_batch_clear(Stream *self)
 {
-    PyGILState_STATE gstate = PyGILState_Ensure();
-    int i;
-    stream_write_ctx *ctx;
-    Stream *self;
-    PyObject *callback, *send_handle, *result, *py_errorno;
+    size_t i;
+    uv_buf_t buf;
 
-    ASSERT(req);
+    for (i = 0; i < self->read_batch.count; i++) {
+        buf = uv_buf_init(self->read_batch.chunks[i].base, self->read_batch.chunks[i].size);
+        pyuv__alloc_release(UV_HANDLE(self), &buf);
+    }
 
-    ctx = PYUV_CONTAINER_OF(req, stream_write_ctx, req);
-    self = ctx->obj;
-    callback = ctx->callback;
-    send_handle = ctx->send_handle;
+    free(self->read_batch.chunks);
+    self->read_batch.chunks = NULL;
+    self->read_batch.count = 0;
+    self->read_batch.capacity = 0;
+    self->read_batch.size = 0;
+}
 
-    if (callback != Py_None) {
-        if (status < 0) {
-            py_errorno = PyInt_FromLong((long)status);
-        } else {
-            py_errorno = Py_None;
-            Py_INCREF(Py_None);
+
+static PyObject *
+pyuv__stream_read_batch_chunk(Stream *self, read_batch_chunk *chunk)
+{
+    uv_buf_t buf;
+    PyObject *data;
+
+    buf = uv_buf_init(chunk->base, chunk->size);
+    if (HANDLE(self)->flags & PYUV__READ_ZEROCOPY) {
+        /* The Buffer object takes ownership of the chunk */
+        data = pyuv__alloc_to_buffer(UV_HANDLE(self), &buf, chunk->len);
+    } else {
+        data = PyBytes_FromStringAndSize(chunk->base, chunk->len);
+        pyuv__alloc_release(UV_HANDLE(self), &buf);
+    }
+    chunk->base = NULL;
+
+    return data;
+}
+
+
+/* Pass the data accumulated in batch read mode to the read callback, either as a list of
+ * chunks or joined in a single bytes object. If batch mode was turned off in the meantime
+ * the chunks are passed one by one. */
+static void
+pyuv__stream_read_batch_deliver(Stream *self)
+{
+    size_t i, count;
+    char *p;
+    read_batch_chunk *chunks;
+    PyObject *result, *data, *item;
+    uint64_t start;
+
+    count = self->read_batch.count;
+    if (count == 0 || self->on_read_cb == NULL) {
+        return;
+    }
+
+    /* The callback could read again, take the chunks out of the stream first */
+    chunks = self->read_batch.chunks;
+    self->read_batch.chunks = NULL;
+    self->read_batch.count = 0;
+    self->read_batch.capacity = 0;
+
+    data = NULL;
+    if (self->read_batch.limit == 0) {
+        /* Batch mode was turned off, pass each chunk on its own */
+        ;
+    } else if (self->read_batch.join) {
+        data = PyBytes_FromStringAndSize(NULL, self->read_batch.size);
+        if (data != NULL) {
+            p = PyBytes_AS_STRING(data);
+            for (i = 0; i < count; i++) {
+                memcpy(p, chunks[i].base, chunks[i].len);
+                p += chunks[i].len;
+            }
         }
-        result = PyObject_CallFunctionObjArgs(callback, self, py_errorno, NULL);
+    } else {
+        data = PyList_New(count);
+        if (data != NULL) {
+            for (i = 0; i < count; i++) {
+                item = pyuv__stream_read_batch_chunk(self, &chunks[i]);
+                if (item == NULL) {
+                    Py_CLEAR(data);
+                    break;
+                }
+                PyList_SET_ITEM(data, i, item);
+            }
+        }
+    }
+    self->read_batch.size = 0;
+
+    if (self->read_batch.limit == 0) {
+        for (i = 0; i < count; i++) {
+            item = pyuv__stream_read_batch_chunk(self, &chunks[i]);
+            if (item == NULL) {
+                handle_uncaught_exception(HANDLE(self)->loop);
+                continue;
+            }
+            if (self->on_read_cb != NULL) {
+                start = pyuv__handle_call_start(HANDLE(self));
+                result = PyObject_CallFunctionObjArgs(self->on_read_cb, self, item, Py_None, NULL);
+                pyuv__handle_call_end(HANDLE(self), self->on_read_cb, start);
+                if (result == NULL) {
+                    handle_uncaught_exception(HANDLE(self)->loop);
+                }
+                Py_XDECREF(result);
+            }
+            Py_DECREF(item);
+        }
+    } else if (data == NULL) {
+        handle_uncaught_exception(HANDLE(self)->loop);
+    } else {
+        start = pyuv__handle_call_start(HANDLE(self));
+        result = PyObject_CallFunctionObjArgs(self->on_read_cb, self, data, Py_None, NULL);
+        pyuv__handle_call_end(HANDLE(self), self->on_read_cb, start);
         if (result == NULL) {
             handle_uncaught_exception(HANDLE(self)->loop);
         }
         Py_XDECREF(result);
-        Py_DECREF(py_errorno);
+        Py_DECREF(data);
     }
 
-    Py_DECREF(callback);
-    Py_XDECREF(send_handle);
+    /* Chunks not handed over to Python objects go back to the pool */
+    for (i = 0; i < count; i++) {
+        if (chunks[i].base != NULL) {
+            uv_buf_t buf = uv_buf_init(chunks[i].base, chunks[i].size);
+            pyuv__alloc_release(UV_HANDLE(self), &buf);
+        }
+    }
+    free(chunks);
+}
+
+
+static void
+pyuv__stream_read_into_clear(Stream *self)
+{
+    PyBuffer_Release(&self->read_into_view);
+    Py_CLEAR(self->read_into);
+    HANDLE(self)->flags &= ~PYUV__READ_INTO_FACTORY;
+}
+
+
+static void
+pyuv__stream_read_into_alloc_cb(uv_handle_t* handle, size_t suggested_size, uv_buf_t *buf)
+{
+    gil_state gstate;
+    Stream *self;
+    PyObject *result, *py_size;
+    uint64_t start;
+
+    /* Can't use container_of here */
+    self = (Stream *)handle->data;
+    ASSERT(self);
+
+    if (!(HANDLE(self)->flags & PYUV__READ_INTO_FACTORY)) {
+        /* The buffer was acquired when reading was started, the GIL is not needed */
+        buf->base = self->read_into_view.buf;
+        buf->len = self->read_into_view.len;
+        return;
+    }
+
+    gstate = pyuv__gil_ensure(handle->loop);
+
+    ASSERT(self->read_into_view.obj == NULL);
+    buf->base = NULL;
+    buf->len = 0;
+
+    py_size = PyLong_FromSize_t(suggested_size);
+    start = pyuv__handle_call_start(HANDLE(self));
+    result = PyObject_CallFunctionObjArgs(self->read_into, self, py_size, NULL);
+    pyuv__handle_call_end(HANDLE(self), self->read_into, start);
+    if (result == NULL) {
+        handle_uncaught_exception(HANDLE(self)->loop);
+    } else if (PyObject_GetBuffer(result, &self->read_into_view, PyBUF_WRITABLE) != 0) {
+        handle_uncaught_exception(HANDLE(self)->loop);
+    } else {
+        buf->base = self->read_into_view.buf;
+        buf->len = self->read_into_view.len;
+    }
+    Py_XDECREF(result);
+    Py_XDECREF(py_size);
+
+    pyuv__gil_release(gstate);
+}
+
+
+static void
+pyuv__stream_read_into_cb(uv_stream_t* handle, int nread, const uv_buf_t* buf)
+{
+    gil_state gstate = pyuv__gil_ensure(handle->loop);
+    Stream *self;
+    PyObject *result, *buffer, *py_nread, *py_errorno;
+    uint64_t start;
+    ASSERT(handle);
+
+    UNUSED_ARG(buf);
+
+    /* Can't use container_of here */
+    self = (Stream *)handle->data;
+
+    /* Object could go out of scope in the callback, increase refcount to avoid it */
+    Py_INCREF(self);
+
+    if (!(HANDLE(self)->flags & PYUV__READ_INTO_FACTORY)) {
+        buffer = self->read_into;
+    } else {
+        buffer = self->read_into_view.obj;
+    }
+    if (buffer == NULL) {
+        buffer = Py_None;
+    }
+    Py_INCREF(buffer);
+
+    if (HANDLE(self)->flags & PYUV__READ_INTO_FACTORY) {
+        /* Each read gets a new buffer from the factory */
+        PyBuffer_Release(&self->read_into_view);
+    }
+
+    if (nread >= 0) {
+        if (HANDLE(self)->flags & PYUV__READ_INTO_REPLAY) {
+            /* Read in batch mode, it was counted then */
+            HANDLE(self)->flags &= ~PYUV__READ_INTO_REPLAY;
+        } else {
+            pyuv__handle_stats_read(HANDLE(self), (size_t)nread);
+        }
+        py_nread = PyInt_FromLong((long)nread);
+        py_errorno = Py_None;
+        Py_INCREF(Py_None);
+    } else {
+        py_nread = PyInt_FromLong(0);
+        py_errorno = PyInt_FromLong((long)nread);
+        /* Stop reading, otherwise an assert blows up on unix */
+        uv_read_stop(handle);
+        pyuv__stream_read_into_clear(self);
+    }
+
+    start = pyuv__handle_call_start(HANDLE(self));
+    result = PyObject_CallFunctionObjArgs(self->on_read_cb, self, buffer, py_nread, py_errorno, NULL);
+    pyuv__handle_call_end(HANDLE(self), self->on_read_cb, start);
+    if (result == NULL) {
+        handle_uncaught_exception(HANDLE(self)->loop);
+    }
+    Py_XDECREF(result);
+    Py_DECREF(buffer);
+    Py_DECREF(py_nread);
+    Py_DECREF(py_errorno);
+
+    Py_DECREF(self);
+    pyuv__gil_release(gstate);
+}
+
+
+static int pyuv__stream_schedule_flush(Stream *self);
+
+
+/* Pass the data read in batch mode before switching to start_read_into through the
+ * read_into callbacks, as if it was being read now. What's left if reading is stopped
+ * in the meantime is kept for the next start. */
+static void
+pyuv__stream_read_batch_deliver_into(Stream *self)
+{
+    size_t i, count, n, offset;
+    uv_buf_t buf;
+    read_batch_chunk *chunks;
+
+    count = self->read_batch.count;
+    if (count == 0) {
+        return;
+    }
+
+    /* The callback could close the stream, take the chunks out of it first */
+    chunks = self->read_batch.chunks;
+    self->read_batch.chunks = NULL;
+    self->read_batch.count = 0;
+    self->read_batch.capacity = 0;
+    self->read_batch.size = 0;
+
+    Py_INCREF(self);
+
+    i = offset = 0;
+    while (i < count && self->read_into != NULL && !uv_is_closing(UV_HANDLE(self))) {
+        pyuv__stream_read_into_alloc_cb(UV_HANDLE(self), chunks[i].len - offset, &buf);
+        if (buf.base == NULL || buf.len == 0) {
+            pyuv__stream_read_into_cb((uv_stream_t *)UV_HANDLE(self), UV_ENOBUFS, &buf);
+            break;
+        }
+        n = chunks[i].len - offset;
+        if (n > buf.len) {
+            n = buf.len;
+        }
+        memcpy(buf.base, chunks[i].base + offset, n);
+        offset += n;
+        if (offset == chunks[i].len) {
+            i++;
+            offset = 0;
+        }
+        HANDLE(self)->flags |= PYUV__READ_INTO_REPLAY;
+        pyuv__stream_read_into_cb((uv_stream_t *)UV_HANDLE(self), (int)n, &buf);
+    }
+
+    if (i < count && !uv_is_closing(UV_HANDLE(self)) && self->read_batch.count == 0) {
+        if (offset > 0) {
+            memmove(chunks[i].base, chunks[i].base + offset, chunks[i].len - offset);
+            chunks[i].len -= offset;
+        }
+        memmove(chunks, chunks + i, (count - i) * sizeof(read_batch_chunk));
+        self->read_batch.chunks = chunks;
+        self->read_batch.count = self->read_batch.capacity = count - i;
+        for (i = 0; i < self->read_batch.count; i++) {
+            self->read_batch.size += chunks[i].len;
+        }
+        /* Reading was started again from the callback */
+        if (self->on_read_cb != NULL && pyuv__stream_schedule_flush(self) < 0) {
+            handle_uncaught_exception(HANDLE(self)->loop);
+        }
+    } else {
+        for (; i < count; i++) {
+            buf = uv_buf_init(chunks[i].base, chunks[i].size);
+            pyuv__alloc_release(UV_HANDLE(self), &buf);
+        }
+        free(chunks);
+    }
+
+    Py_DECREF(self);
+}
+
+
+static void
+pyuv__stream_call_write_cb(Stream *self, PyObject *callback, PyObject *py_errorno)
+{
+    PyObject *result;
+    uint64_t start;
+
+    if (callback == Py_None) {
+        return;
+    }
+
+    start = pyuv__handle_call_start(HANDLE(self));
+    result = PyObject_CallFunctionObjArgs(callback, self, py_errorno, NULL);
+    pyuv__handle_call_end(HANDLE(self), callback, start);
+    if (result == NULL) {
+        handle_uncaught_exception(HANDLE(self)->loop);
+    }
+    Py_XDECREF(result);
+}
+
+
+static INLINE void
+pyuv__stream_stats_queued(Stream *self)
+{
+    pyuv__handle_stats_queued(HANDLE(self), ((uv_stream_t *)UV_HANDLE(self))->write_queue_size + self->cork.size);
+}
+
+
+static void
+pyuv__stream_write_done(stream_write_ctx *ctx, int status)
+{
+    int i;
+    Stream *self;
+    PyObject *py_errorno;
+
+    self = ctx->obj;
+
+    if (status < 0) {
+        py_errorno = PyInt_FromLong((long)status);
+    } else {
+        py_errorno = Py_None;
+        Py_INCREF(Py_None);
+        for (i = 0; i < ctx->view_count; i++)
+            pyuv__handle_stats_written(HANDLE(self), (size_t)ctx->views[i].len);
+    }
+
+    if (ctx->callbacks != NULL) {
+        /* Coalesced corked writes, notify each of them */
+        for (i = 0; i < PyList_GET_SIZE(ctx->callbacks); i++) {
+            pyuv__stream_call_write_cb(self, PyList_GET_ITEM(ctx->callbacks, i), py_errorno);
+        }
+    } else {
+        pyuv__stream_call_write_cb(self, ctx->callback, py_errorno);
+    }
+
+    Py_DECREF(py_errorno);
+    Py_DECREF(ctx->callback);
+    Py_XDECREF(ctx->callbacks);
+    Py_XDECREF(ctx->send_handle);
 
     for (i = 0; i < ctx->view_count; i++)
         PyBuffer_Release(&ctx->views[i]);
     if (ctx->views != ctx->viewsml)
         PyMem_Free(ctx->views);
-    PyMem_Free(ctx);
+    pyuv__request_pool_free(UV_HANDLE(self)->loop->data, PYUV_REQUEST_POOL_WRITE, ctx);
 
     /* Refcount was increased in the caller function */
     Py_DECREF(self);
+}
+
+
+static void
+pyuv__stream_write_cb(uv_write_t* req, int status)
+{
+    gil_state gstate = pyuv__gil_ensure(req->handle->loop);
+
+    ASSERT(req);
+
+    pyuv__stream_write_done(PYUV_CONTAINER_OF(req, stream_write_ctx, req), status);
+
+    pyuv__gil_release(gstate);
+}
+
+
+/* Write all data queued while the stream was corked in a single request. Errors
+ * are reported to the callbacks of the queued writes. */
+static int
+pyuv__stream_cork_flush(Stream *self)
+{
+    int err;
+    Py_ssize_t i, count;
+    stream_write_ctx *ctx;
+
+    count = self->cork.view_count;
+    if (count == 0) {
+        return 0;
+    }
+
+    ctx = pyuv__request_pool_alloc(HANDLE(self)->loop, PYUV_REQUEST_POOL_WRITE, sizeof *ctx);
+    if (!ctx) {
+        return -1;
+    }
+
+    ctx->obj = self;
+    ctx->callback = Py_None;
+    Py_INCREF(Py_None);
+    ctx->callbacks = self->cork.callbacks;
+    ctx->send_handle = NULL;
+    ctx->views = self->cork.views;
+    ctx->view_count = count;
+
+    /* The queue held a reference to the stream, the write request takes it over */
+    self->cork.views = NULL;
+    self->cork.view_count = 0;
+    self->cork.view_capacity = 0;
+    self->cork.size = 0;
+    self->cork.callbacks = NULL;
+
+    {
+        STACK_ARRAY(uv_buf_t, bufs, count);
+
+        for (i = 0; i < count; i++) {
+            bufs[i].base = ctx->views[i].buf;
+            bufs[i].len = ctx->views[i].len;
+        }
+
+        err = uv_write(&ctx->req, (uv_stream_t *)UV_HANDLE(self), bufs, count, pyuv__stream_write_cb);
+    }
+
+    if (err < 0) {
+        pyuv__stream_write_done(ctx, err);
+    }
+
+    return 0;
+}
+
+
+static void
+pyuv__stream_flush_pending(Loop *loop)
+{
+    Py_ssize_t i;
+    Stream *stream;
+    PyObject *pending;
+
+    pending = loop->flush_pending;
+    loop->flush_pending = NULL;
+
+    if (pending != NULL) {
+        for (i = 0; i < PyList_GET_SIZE(pending); i++) {
+            stream = (Stream *)PyList_GET_ITEM(pending, i);
+            stream->flush_scheduled = False;
+            /* Data read in this iteration first, writes done by the read callback go out right after */
+            if (stream->read_into != NULL) {
+                pyuv__stream_read_batch_deliver_into(stream);
+            } else {
+                pyuv__stream_read_batch_deliver(stream);
+            }
+            if (!stream->cork.corked && pyuv__stream_cork_flush(stream) < 0) {
+                handle_uncaught_exception(loop);
+            }
+        }
+        Py_DECREF(pending);
+    }
+
+    if (loop->flush_pending == NULL) {
+        uv_prepare_stop(&loop->flush_prepare);
+        uv_check_stop(&loop->flush_check);
+    }
+}
+
+
+static void
+pyuv__stream_flush_prepare_cb(uv_prepare_t *handle)
+{
+    gil_state gstate = pyuv__gil_ensure(handle->loop);
+    pyuv__stream_flush_pending(PYUV_CONTAINER_OF(handle, Loop, flush_prepare));
+    pyuv__gil_release(gstate);
+}
+
+
+static void
+pyuv__stream_flush_check_cb(uv_check_t *handle)
+{
+    gil_state gstate = pyuv__gil_ensure(handle->loop);
+    pyuv__stream_flush_pending(PYUV_CONTAINER_OF(handle, Loop, flush_check));
+    pyuv__gil_release(gstate);
+}
+
+
+/* Deliver the batched reads and flush the corked writes of the stream at the end of the current
+ * loop iteration. The check handle takes care of what I/O callbacks did, the prepare handle catches
+ * anything done later, before the loop blocks for I/O. */
+static int
+pyuv__stream_schedule_flush(Stream *self)
+{
+    Loop *loop;
+
+    loop = HANDLE(self)->loop;
+
+    if (!loop->flush_handles_init) {
+        uv_prepare_init(loop->uv_loop, &loop->flush_prepare);
+        uv_check_init(loop->uv_loop, &loop->flush_check);
+        loop->flush_prepare.data = NULL;
+        loop->flush_check.data = NULL;
+        loop->flush_handles_init = True;
+    }
+
+    if (loop->flush_pending == NULL) {
+        loop->flush_pending = PyList_New(0);
+        if (loop->flush_pending == NULL)
+            return -1;
+    }
+
+    if (self->flush_scheduled) {
+        return 0;
+    }
+
+    if (PyList_Append(loop->flush_pending, (PyObject *)self) < 0) {
+        return -1;
+    }
+    self->flush_scheduled = True;
+
+    uv_prepare_start(&loop->flush_prepare, pyuv__stream_flush_prepare_cb);
+    uv_check_start(&loop->flush_check, pyuv__stream_flush_check_cb);
+
+    return 0;
+}
+
+
+/* Read callback for batch mode. Chunks are accumulated without taking the GIL, it's only needed
+ * to schedule the delivery at the end of the loop iteration, when the limit is reached or on error. */
+static void
+pyuv__stream_read_batch_cb(uv_stream_t* handle, int nread, const uv_buf_t* buf)
+{
+    gil_state gstate;
+    Stream *self;
+    read_batch_chunk *chunks;
+    size_t capacity;
+    PyObject *result, *py_errorno;
+    uint64_t start;
+
+    ASSERT(handle);
+
+    /* Can't use container_of here */
+    self = (Stream *)handle->data;
+
+    if (nread == 0) {
+        pyuv__alloc_release((uv_handle_t *)handle, buf);
+        return;
+    }
+
+    if (nread > 0) {
+        if (self->read_batch.count == self->read_batch.capacity) {
+            capacity = self->read_batch.capacity ? self->read_batch.capacity * 2 : 16;
+            chunks = realloc(self->read_batch.chunks, capacity * sizeof(read_batch_chunk));
+            if (chunks == NULL) {
+                pyuv__alloc_release((uv_handle_t *)handle, buf);
+                nread = UV_ENOBUFS;
+                goto error;
+            }
+            self->read_batch.chunks = chunks;
+            self->read_batch.capacity = capacity;
+        }
+        chunks = &self->read_batch.chunks[self->read_batch.count++];
+        chunks->base = buf->base;
+        chunks->size = buf->len;
+        chunks->len = (size_t)nread;
+        self->read_batch.size += (size_t)nread;
+        pyuv__handle_stats_read(HANDLE(self), (size_t)nread);
+
+        if (self->flush_scheduled && self->read_batch.size < self->read_batch.limit) {
+            return;
+        }
+
+        gstate = pyuv__gil_ensure(handle->loop);
+        if (self->read_batch.size >= self->read_batch.limit) {
+            /* Object could go out of scope in the callback, increase refcount to avoid it */
+            Py_INCREF(self);
+            pyuv__stream_read_batch_deliver(self);
+            Py_DECREF(self);
+        } else if (pyuv__stream_schedule_flush(self) < 0) {
+            handle_uncaught_exception(HANDLE(self)->loop);
+        }
+        pyuv__gil_release(gstate);
+        return;
+    }
+
+    pyuv__alloc_release((uv_handle_t *)handle, buf);
+
+error:
+    gstate = pyuv__gil_ensure(handle->loop);
+
+    Py_INCREF(self);
+
+    /* Data read so far goes first */
+    pyuv__stream_read_batch_deliver(self);
+
+    /* Stop reading, otherwise an assert blows up on unix */
+    uv_read_stop(handle);
+
+    if (self->on_read_cb != NULL) {
+        py_errorno = PyInt_FromLong((long)nread);
+        start = pyuv__handle_call_start(HANDLE(self));
+        result = PyObject_CallFunctionObjArgs(self->on_read_cb, self, Py_None, py_errorno, NULL);
+        pyuv__handle_call_end(HANDLE(self), self->on_read_cb, start);
+        if (result == NULL) {
+            handle_uncaught_exception(HANDLE(self)->loop);
+        }
+        Py_XDECREF(result);
+        Py_DECREF(py_errorno);
+    }
+
+    Py_DECREF(self);
+    pyuv__gil_release(gstate);
+}
+
 
-    PyGILState_Release(gstate);
+/* Queue the given data, which can be a buffer or a sequence of them, until the stream is uncorked */
+static PyObject *
+pyuv__stream_cork_write(Stream *self, PyObject *data, PyObject *callback)
+{
+    PyObject *data_fast, **items;
+    Py_buffer *views;
+    Py_ssize_t i, j, n, count, capacity;
+
+    data_fast = NULL;
+
+    if (PyObject_CheckBuffer(data)) {
+        items = &data;
+        n = 1;
+    } else {
+        data_fast = PySequence_Fast(data, "data must be an iterable");
+        if (data_fast == NULL)
+            return NULL;
+        n = PySequence_Fast_GET_SIZE(data_fast);
+        if (n == 0) {
+            PyErr_SetString(PyExc_ValueError, "iterable is empty");
+            Py_DECREF(data_fast);
+            return NULL;
+        }
+        items = PySequence_Fast_ITEMS(data_fast);
+    }
+
+    if (self->cork.callbacks == NULL) {
+        self->cork.callbacks = PyList_New(0);
+        if (self->cork.callbacks == NULL)
+            goto error;
+    }
+
+    count = self->cork.view_count;
+    if (count + n > self->cork.view_capacity) {
+        capacity = self->cork.view_capacity ? self->cork.view_capacity * 2 : 8;
+        if (capacity < count + n)
+            capacity = count + n;
+        views = PyMem_Realloc(self->cork.views, sizeof(Py_buffer) * capacity);
+        if (views == NULL) {
+            PyErr_NoMemory();
+            goto error;
+        }
+        self->cork.views = views;
+        self->cork.view_capacity = capacity;
+    }
+
+    for (i = 0; i < n; i++) {
+        if (PyObject_GetBuffer(items[i], &self->cork.views[count + i], PyBUF_SIMPLE) != 0) {
+            for (j = 0; j < i; j++)
+                PyBuffer_Release(&self->cork.views[count + j]);
+            goto error;
+        }
+    }
+
+    if (PyList_Append(self->cork.callbacks, callback) < 0) {
+        for (i = 0; i < n; i++)
+            PyBuffer_Release(&self->cork.views[count + i]);
+        goto error;
+    }
+
+    for (i = 0; i < n; i++)
+        self->cork.size += self->cork.views[count + i].len;
+    self->cork.view_count += n;
+    Py_XDECREF(data_fast);
+    pyuv__stream_stats_queued(self);
+
+    /* Increase refcount so that object is not removed while data is queued */
+    if (count == 0) {
+        Py_INCREF(self);
+    }
+
+    if (self->cork.view_count >= PYUV_CORK_MAX_BUFS) {
+        if (pyuv__stream_cork_flush(self) < 0)
+            return NULL;
+    } else if (!self->cork.corked) {
+        if (pyuv__stream_schedule_flush(self) < 0)
+            return NULL;
+    }
+
+    Py_RETURN_NONE;
+
+error:
+    Py_XDECREF(data_fast);
+    return NULL;
 }
 
 
@@ -163,9 +864,12 @@ Stream_func_shutdown(Stream *self, PyObject *args)
         return NULL;
     }
 
-    ctx = PyMem_Malloc(sizeof *ctx);
+    if (pyuv__stream_cork_flush(self) < 0) {
+        return NULL;
+    }
+
+    ctx = pyuv__request_pool_alloc(HANDLE(self)->loop, PYUV_REQUEST_POOL_SHUTDOWN, sizeof *ctx);
     if (!ctx) {
-        PyErr_NoMemory();
         return NULL;
     }
 
@@ -187,23 +891,106 @@ Stream_func_shutdown(Stream *self, PyObject *args)
 
 error:
     Py_DECREF(callback);
-    PyMem_Free(ctx);
+    pyuv__request_pool_free(HANDLE(self)->loop, PYUV_REQUEST_POOL_SHUTDOWN, ctx);
     return NULL;
 }
 
 
 static PyObject *
-Stream_func_start_read(Stream *self, PyObject *args)
+Stream_func_start_read(Stream *self, PyObject *args, PyObject *kwargs)
+{
+    int err;
+    Py_ssize_t buffer_size, batch;
+    PyObject *tmp, *callback, *zerocopy, *join;
+
+    static char *kwlist[] = {"callback", "buffer_size", "zerocopy", "batch", "join", NULL};
+
+    tmp = NULL;
+    buffer_size = 0;
+    zerocopy = Py_False;
+    batch = 0;
+    join = Py_False;
+
+    RAISE_IF_HANDLE_NOT_INITIALIZED(self, NULL);
+    RAISE_IF_HANDLE_CLOSED(self, PyExc_HandleClosedError, NULL);
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|nO!nO!:start_read", kwlist, &callback, &buffer_size, &PyBool_Type, &zerocopy, &batch, &PyBool_Type, &join)) {
+        return NULL;
+    }
+
+    if (!PyCallable_Check(callback)) {
+        PyErr_SetString(PyExc_TypeError, "a callable is required");
+        return NULL;
+    }
+
+    if (buffer_size < 0 || (size_t)buffer_size > PYUV_BUFFER_POOL_MAX_SIZE) {
+        PyErr_Format(PyExc_ValueError, "buffer size must be between 0 and %zu", PYUV_BUFFER_POOL_MAX_SIZE);
+        return NULL;
+    }
+
+    if (batch < 0) {
+        PyErr_SetString(PyExc_ValueError, "batch must be positive or 0");
+        return NULL;
+    }
+
+    if (join == Py_True && (batch == 0 || zerocopy == Py_True)) {
+        PyErr_SetString(PyExc_ValueError, "join requires batch mode and can't be used with zerocopy");
+        return NULL;
+    }
+
+    if (batch > 0) {
+        err = uv_read_start((uv_stream_t *)UV_HANDLE(self), (uv_alloc_cb)pyuv__alloc_cb, (uv_read_cb)pyuv__stream_read_batch_cb);
+    } else {
+        err = uv_read_start((uv_stream_t *)UV_HANDLE(self), (uv_alloc_cb)pyuv__alloc_cb, (uv_read_cb)pyuv__stream_read_cb);
+    }
+    if (err < 0) {
+        RAISE_STREAM_EXCEPTION(err, UV_HANDLE(self));
+        return NULL;
+    }
+
+    tmp = self->on_read_cb;
+    Py_INCREF(callback);
+    self->on_read_cb = callback;
+    Py_XDECREF(tmp);
+
+    pyuv__stream_read_into_clear(self);
+
+    HANDLE(self)->read_buffer_size = buffer_size ? pyuv__buffer_pool_round((size_t)buffer_size) : 0;
+    if (zerocopy == Py_True) {
+        HANDLE(self)->flags |= PYUV__READ_ZEROCOPY;
+    } else {
+        HANDLE(self)->flags &= ~PYUV__READ_ZEROCOPY;
+    }
+
+    self->read_batch.limit = (size_t)batch;
+    self->read_batch.join = join == Py_True;
+
+    PYUV_HANDLE_INCREF(self);
+
+    /* Data read in batch mode before reading was stopped */
+    if (self->read_batch.count > 0 && pyuv__stream_schedule_flush(self) < 0) {
+        return NULL;
+    }
+
+    Py_RETURN_NONE;
+}
+
+
+static PyObject *
+Stream_func_start_read_into(Stream *self, PyObject *args)
 {
     int err;
-    PyObject *tmp, *callback;
+    Bool factory;
+    Py_buffer view;
+    PyObject *tmp, *buffer, *callback;
 
     tmp = NULL;
+    view.obj = NULL;
 
     RAISE_IF_HANDLE_NOT_INITIALIZED(self, NULL);
     RAISE_IF_HANDLE_CLOSED(self, PyExc_HandleClosedError, NULL);
 
-    if (!PyArg_ParseTuple(args, "O:start_read", &callback)) {
+    if (!PyArg_ParseTuple(args, "OO:start_read_into", &buffer, &callback)) {
         return NULL;
     }
 
@@ -212,12 +999,39 @@ Stream_func_start_read(Stream *self, PyObject *args)
         return NULL;
     }
 
-    err = uv_read_start((uv_stream_t *)UV_HANDLE(self), (uv_alloc_cb)pyuv__alloc_cb, (uv_read_cb)pyuv__stream_read_cb);
+    if (PyObject_CheckBuffer(buffer)) {
+        factory = False;
+        if (PyObject_GetBuffer(buffer, &view, PyBUF_WRITABLE) != 0) {
+            return NULL;
+        }
+        if (view.len == 0) {
+            PyErr_SetString(PyExc_ValueError, "buffer must not be empty");
+            PyBuffer_Release(&view);
+            return NULL;
+        }
+    } else if (PyCallable_Check(buffer)) {
+        factory = True;
+    } else {
+        PyErr_SetString(PyExc_TypeError, "buffer must be a writable buffer object or a callable");
+        return NULL;
+    }
+
+    err = uv_read_start((uv_stream_t *)UV_HANDLE(self), (uv_alloc_cb)pyuv__stream_read_into_alloc_cb, (uv_read_cb)pyuv__stream_read_into_cb);
     if (err < 0) {
         RAISE_STREAM_EXCEPTION(err, UV_HANDLE(self));
+        PyBuffer_Release(&view);
         return NULL;
     }
 
+    pyuv__stream_read_into_clear(self);
+
+    Py_INCREF(buffer);
+    self->read_into = buffer;
+    self->read_into_view = view;
+    if (factory) {
+        HANDLE(self)->flags |= PYUV__READ_INTO_FACTORY;
+    }
+
     tmp = self->on_read_cb;
     Py_INCREF(callback);
     self->on_read_cb = callback;
@@ -225,6 +1039,11 @@ Stream_func_start_read(Stream *self, PyObject *args)
 
     PYUV_HANDLE_INCREF(self);
 
+    /* Data read in batch mode before reading was stopped */
+    if (self->read_batch.count > 0 && pyuv__stream_schedule_flush(self) < 0) {
+        return NULL;
+    }
+
     Py_RETURN_NONE;
 }
 
@@ -246,6 +1065,8 @@ Stream_func_stop_read(Stream *self)
     Py_XDECREF(self->on_read_cb);
     self->on_read_cb = NULL;
 
+    pyuv__stream_read_into_clear(self);
+
     PYUV_HANDLE_DECREF(self);
 
     Py_RETURN_NONE;
@@ -266,6 +1087,12 @@ Stream_func_try_write(Stream *self, PyObject *args)
         return NULL;
     }
 
+    /* Data queued while corked goes first */
+    if (pyuv__stream_cork_flush(self) < 0) {
+        PyBuffer_Release(&view);
+        return NULL;
+    }
+
     buf = uv_buf_init(view.buf, view.len);
     err = uv_try_write((uv_stream_t *)UV_HANDLE(self), &buf, 1);
     if (err < 0) {
@@ -273,6 +1100,7 @@ Stream_func_try_write(Stream *self, PyObject *args)
         PyBuffer_Release(&view);
         return NULL;
     }
+    pyuv__handle_stats_written(HANDLE(self), (size_t)err);
 
     PyBuffer_Release(&view);
     return PyInt_FromLong((long)err);
@@ -287,9 +1115,13 @@ pyuv__stream_write_bytes(Stream *self, PyObject *data, PyObject *callback, PyObj
     stream_write_ctx *ctx;
     Py_buffer *view;
 
-    ctx = PyMem_Malloc(sizeof *ctx);
+    /* Data queued while corked goes first */
+    if (pyuv__stream_cork_flush(self) < 0) {
+        return NULL;
+    }
+
+    ctx = pyuv__request_pool_alloc(HANDLE(self)->loop, PYUV_REQUEST_POOL_WRITE, sizeof *ctx);
     if (!ctx) {
-        PyErr_NoMemory();
         return NULL;
     }
 
@@ -297,13 +1129,14 @@ pyuv__stream_write_bytes(Stream *self, PyObject *data, PyObject *callback, PyObj
     view = &ctx->views[0];
 
     if (PyObject_GetBuffer(data, view, PyBUF_SIMPLE) != 0) {
-        PyMem_Free(ctx);
+        pyuv__request_pool_free(HANDLE(self)->loop, PYUV_REQUEST_POOL_WRITE, ctx);
         return NULL;
     }
 
     ctx->view_count = 1;
     ctx->obj = self;
     ctx->callback = callback;
+    ctx->callbacks = NULL;
     ctx->send_handle = send_handle;
 
     Py_INCREF(callback);
@@ -322,13 +1155,14 @@ pyuv__stream_write_bytes(Stream *self, PyObject *data, PyObject *callback, PyObj
         Py_DECREF(callback);
         Py_XDECREF(send_handle);
         PyBuffer_Release(view);
-        PyMem_Free(ctx);
+        pyuv__request_pool_free(HANDLE(self)->loop, PYUV_REQUEST_POOL_WRITE, ctx);
         return NULL;
     }
 
     /* Increase refcount so that object is not removed before the callback is called */
     Py_INCREF(self);
 
+    pyuv__stream_stats_queued(self);
     Py_RETURN_NONE;
 }
 
@@ -341,6 +1175,11 @@ pyuv__stream_write_sequence(Stream *self, PyObject *data, PyObject *callback, Py
     PyObject *data_fast, *item;
     Py_ssize_t i, j, buf_count;
 
+    /* Data queued while corked goes first */
+    if (pyuv__stream_cork_flush(self) < 0) {
+        return NULL;
+    }
+
     data_fast = PySequence_Fast(data, "data must be an iterable");
     if (data_fast == NULL)
         return NULL;
@@ -358,9 +1197,8 @@ pyuv__stream_write_sequence(Stream *self, PyObject *data, PyObject *callback, Py
         return NULL;
     }
 
-    ctx = PyMem_Malloc(sizeof *ctx);
+    ctx = pyuv__request_pool_alloc(HANDLE(self)->loop, PYUV_REQUEST_POOL_WRITE, sizeof *ctx);
     if (!ctx) {
-        PyErr_NoMemory();
         Py_DECREF(data_fast);
         return NULL;
     }
@@ -370,7 +1208,7 @@ pyuv__stream_write_sequence(Stream *self, PyObject *data, PyObject *callback, Py
         ctx->views = PyMem_Malloc(sizeof(Py_buffer) * buf_count);
     if (!ctx->views) {
         PyErr_NoMemory();
-        PyMem_Free(ctx);
+        pyuv__request_pool_free(HANDLE(self)->loop, PYUV_REQUEST_POOL_WRITE, ctx);
         Py_DECREF(data_fast);
         return NULL;
     }
@@ -389,6 +1227,7 @@ pyuv__stream_write_sequence(Stream *self, PyObject *data, PyObject *callback, Py
 
         ctx->obj = self;
         ctx->callback = callback;
+        ctx->callbacks = NULL;
         ctx->send_handle = send_handle;
 
         Py_INCREF(callback);
@@ -412,6 +1251,7 @@ pyuv__stream_write_sequence(Stream *self, PyObject *data, PyObject *callback, Py
     /* Increase refcount so that object is not removed before the callback is called */
     Py_INCREF(self);
 
+    pyuv__stream_stats_queued(self);
     Py_RETURN_NONE;
 
 error:
@@ -419,7 +1259,7 @@ error:
         PyBuffer_Release(&ctx->views[j]);
     if (ctx->views != ctx->viewsml)
         PyMem_Free(ctx->views);
-    PyMem_Free(ctx);
+    pyuv__request_pool_free(HANDLE(self)->loop, PYUV_REQUEST_POOL_WRITE, ctx);
     Py_XDECREF(data_fast);
     return NULL;
 }
@@ -443,7 +1283,9 @@ Stream_func_write(Stream *self, PyObject *args)
         return NULL;
     }
 
-    if (PyObject_CheckBuffer(data)) {
+    if ((self->cork.corked || self->cork.autocork) && (PyObject_CheckBuffer(data) || (!PyUnicode_Check(data) && PySequence_Check(data)))) {
+        return pyuv__stream_cork_write(self, data, callback);
+    } else if (PyObject_CheckBuffer(data)) {
         return pyuv__stream_write_bytes(self, data, callback, NULL);
     } else if (!PyUnicode_Check(data) && PySequence_Check(data)) {
         return pyuv__stream_write_sequence(self, data, callback, NULL);
@@ -454,6 +1296,52 @@ Stream_func_write(Stream *self, PyObject *args)
 }
 
 
+static PyObject *
+Stream_func_cork(Stream *self)
+{
+    RAISE_IF_HANDLE_NOT_INITIALIZED(self, NULL);
+    RAISE_IF_HANDLE_CLOSED(self, PyExc_HandleClosedError, NULL);
+
+    self->cork.corked = True;
+
+    Py_RETURN_NONE;
+}
+
+
+static PyObject *
+Stream_func_uncork(Stream *self)
+{
+    RAISE_IF_HANDLE_NOT_INITIALIZED(self, NULL);
+    RAISE_IF_HANDLE_CLOSED(self, PyExc_HandleClosedError, NULL);
+
+    self->cork.corked = False;
+
+    if (pyuv__stream_cork_flush(self) < 0) {
+        return NULL;
+    }
+
+    Py_RETURN_NONE;
+}
+
+
+static PyObject *
+Stream_func_close(Stream *self, PyObject *args)
+{
+    RAISE_IF_HANDLE_NOT_INITIALIZED(self, NULL);
+
+    if (!uv_is_closing(UV_HANDLE(self))) {
+        /* Don't lose writes still queued by cork / autocork */
+        if (pyuv__stream_cork_flush(self) < 0) {
+            return NULL;
+        }
+        /* Reads not delivered yet are dropped, like libuv does with those pending in the kernel */
+        pyuv__stream_read_batch_clear(self);
+    }
+
+    return Handle_func_close((Handle *)self, args);
+}
+
+
 static PyObject *
 Stream_func_fileno(Stream *self)
 {
@@ -528,7 +1416,46 @@ Stream_write_queue_size_get(Stream *self, void *closure)
 
     RAISE_IF_HANDLE_NOT_INITIALIZED(self, NULL);
 
-    return PyLong_FromSize_t(((uv_stream_t *)UV_HANDLE(self))->write_queue_size);
+    return PyLong_FromSize_t(((uv_stream_t *)UV_HANDLE(self))->write_queue_size + self->cork.size);
+}
+
+
+static PyObject *
+Stream_autocork_get(Stream *self, void *closure)
+{
+    UNUSED_ARG(closure);
+
+    RAISE_IF_HANDLE_NOT_INITIALIZED(self, NULL);
+
+    return PyBool_FromLong((long)self->cork.autocork);
+}
+
+
+static int
+Stream_autocork_set(Stream *self, PyObject *value, void *closure)
+{
+    int enable;
+
+    UNUSED_ARG(closure);
+
+    RAISE_IF_HANDLE_NOT_INITIALIZED(self, -1);
+
+    if (!value) {
+        PyErr_SetString(PyExc_TypeError, "cannot delete attribute");
+        return -1;
+    }
+
+    enable = PyObject_IsTrue(value);
+    if (enable < 0) {
+        return -1;
+    }
+
+    self->cork.autocork = enable ? True : False;
+    if (!enable && !self->cork.corked) {
+        return pyuv__stream_cork_flush(self);
+    }
+
+    return 0;
 }
 
 
@@ -547,6 +1474,7 @@ static int
 Stream_tp_traverse(Stream *self, visitproc visit, void *arg)
 {
     Py_VISIT(self->on_read_cb);
+    Py_VISIT(self->read_into);
     return HandleType.tp_traverse((PyObject *)self, visit, arg);
 }
 
@@ -555,6 +1483,8 @@ static int
 Stream_tp_clear(Stream *self)
 {
     Py_CLEAR(self->on_read_cb);
+    pyuv__stream_read_into_clear(self);
+    pyuv__stream_read_batch_clear(self);
     return HandleType.tp_clear((PyObject *)self);
 }
 
@@ -564,7 +1494,11 @@ Stream_tp_methods[] = {
     { "shutdown", (PyCFunction)Stream_func_shutdown, METH_VARARGS, "Shutdown the write side of this Stream." },
     { "try_write", (PyCFunction)Stream_func_try_write, METH_VARARGS, "Try to write data on the stream." },
     { "write", (PyCFunction)Stream_func_write, METH_VARARGS, "Write data on the stream." },
-    { "start_read", (PyCFunction)Stream_func_start_read, METH_VARARGS, "Start read data from the connected endpoint." },
+    { "cork", (PyCFunction)Stream_func_cork, METH_NOARGS, "Queue writes until uncork is called." },
+    { "uncork", (PyCFunction)Stream_func_uncork, METH_NOARGS, "Write all queued data at once and stop queueing writes." },
+    { "close", (PyCFunction)Stream_func_close, METH_VARARGS, "Close handle." },
+    { "start_read", (PyCFunction)Stream_func_start_read, METH_VARARGS|METH_KEYWORDS, "Start read data from the connected endpoint." },
+    { "start_read_into", (PyCFunction)Stream_func_start_read_into, METH_VARARGS, "Start read data from the connected endpoint into the given buffers." },
     { "stop_read", (PyCFunction)Stream_func_stop_read, METH_NOARGS, "Stop read data from the connected endpoint." },
     { "fileno", (PyCFunction)Stream_func_fileno, METH_NOARGS, "Returns the libuv OS handle." },
     { "set_blocking", (PyCFunction)Stream_func_set_blocking, METH_VARARGS, "Set the stream to be blocking." },
@@ -576,6 +1510,7 @@ static PyGetSetDef Stream_tp_getsets[] = {
     {"readable", (getter)Stream_readable_get, 0, "Indicates if stream is readable.", NULL},
     {"writable", (getter)Stream_writable_get, 0, "Indicates if stream is writable.", NULL},
     {"write_queue_size", (getter)Stream_write_queue_size_get, 0, "Returns the size of the write queue.", NULL},
+    {"autocork", (getter)Stream_autocork_get, (setter)Stream_autocork_set, "Queue writes and send them together at the end of the loop iteration.", NULL},
     {NULL}
 };
 
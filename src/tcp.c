@@ -2,9 +2,10 @@
 static void
 pyuv__tcp_listen_cb(uv_stream_t *handle, int status)
 {
-    PyGILState_STATE gstate = PyGILState_Ensure();
+    gil_state gstate = pyuv__gil_ensure(handle->loop);
     TCP *self;
     PyObject *result, *py_errorno;
+    uint64_t start;
 
     ASSERT(handle);
 
@@ -20,7 +21,9 @@ pyuv__tcp_listen_cb(uv_stream_t *handle, int status)
         Py_INCREF(Py_None);
     }
 
+    start = pyuv__handle_call_start(HANDLE(self));
     result = PyObject_CallFunctionObjArgs(self->on_new_connection_cb, self, py_errorno, NULL);
+    pyuv__handle_call_end(HANDLE(self), self->on_new_connection_cb, start);
     if (result == NULL) {
         handle_uncaught_exception(HANDLE(self)->loop);
     }
@@ -28,16 +31,17 @@ pyuv__tcp_listen_cb(uv_stream_t *handle, int status)
     Py_DECREF(py_errorno);
 
     Py_DECREF(self);
-    PyGILState_Release(gstate);
+    pyuv__gil_release(gstate);
 }
 
 
 static void
 pyuv__tcp_connect_cb(uv_connect_t *req, int status)
 {
-    PyGILState_STATE gstate = PyGILState_Ensure();
+    gil_state gstate = pyuv__gil_ensure(req->handle->loop);
     TCP *self;
     PyObject *callback, *result, *py_errorno;
+    uint64_t start;
 
     ASSERT(req);
     self = PYUV_CONTAINER_OF(req->handle, TCP, tcp_h);
@@ -50,7 +54,9 @@ pyuv__tcp_connect_cb(uv_connect_t *req, int status)
         Py_INCREF(Py_None);
     }
 
+    start = pyuv__handle_call_start(HANDLE(self));
     result = PyObject_CallFunctionObjArgs(callback, self, py_errorno, NULL);
+    pyuv__handle_call_end(HANDLE(self), callback, start);
     if (result == NULL) {
         handle_uncaught_exception(HANDLE(self)->loop);
     }
@@ -58,12 +64,12 @@ pyuv__tcp_connect_cb(uv_connect_t *req, int status)
     Py_DECREF(py_errorno);
 
     Py_DECREF(callback);
-    PyMem_Free(req);
+    pyuv__request_pool_free(req->handle->loop->data, PYUV_REQUEST_POOL_CONNECT, req);
 
     /* Refcount was increased in the caller function */
     Py_DECREF(self);
 
-    PyGILState_Release(gstate);
+    pyuv__gil_release(gstate);
 }
 
 
@@ -88,6 +94,17 @@ TCP_func_bind(TCP *self, PyObject *args)
         return NULL;
     }
 
+#ifdef PYUV_EMULATE_REUSEPORT
+    if (flags & UV_TCP_REUSEPORT) {
+        flags &= ~UV_TCP_REUSEPORT;
+        err = pyuv__set_reuseport(UV_HANDLE(self), ss.ss_family);
+        if (err < 0) {
+            RAISE_UV_EXCEPTION(err, PyExc_TCPError);
+            return NULL;
+        }
+    }
+#endif
+
     err = uv_tcp_bind(&self->tcp_h, (struct sockaddr *)&ss, flags);
     if (err < 0) {
         RAISE_UV_EXCEPTION(err, PyExc_TCPError);
@@ -194,9 +211,8 @@ TCP_func_connect(TCP *self, PyObject *args)
 
     Py_INCREF(callback);
 
-    connect_req = PyMem_Malloc(sizeof *connect_req);
+    connect_req = pyuv__request_pool_alloc(HANDLE(self)->loop, PYUV_REQUEST_POOL_CONNECT, sizeof *connect_req);
     if (!connect_req) {
-        PyErr_NoMemory();
         goto error;
     }
 
@@ -215,7 +231,9 @@ TCP_func_connect(TCP *self, PyObject *args)
 
 error:
     Py_DECREF(callback);
-    PyMem_Free(connect_req);
+    if (connect_req) {
+        pyuv__request_pool_free(HANDLE(self)->loop, PYUV_REQUEST_POOL_CONNECT, connect_req);
+    }
     return NULL;
 }
 
@@ -1,25 +1,242 @@
 
+/* Batch mode: expired timers are queued on the loop without taking the GIL and their callbacks
+ * are called from a prepare handle, once per callback object, with the list of timers which
+ * expired since the last delivery. The reference held on behalf of the active handle (see
+ * PYUV_HANDLE_INCREF) is moved to the queue, and given back on delivery. */
+#define PYUV_TIMER_BATCH_NONE       0
+#define PYUV_TIMER_BATCH_QUEUED     1
+#define PYUV_TIMER_BATCH_COLLECTED  2
+
+/* Timers are grouped by the identity of their callback, so it doesn't need to be hashable.
+ * Bound methods are created on every attribute access, those are grouped by instance and
+ * function instead. */
+static PyObject *
+pyuv__timer_batch_key(PyObject *callback)
+{
+    if (PyMethod_Check(callback) && PyMethod_GET_SELF(callback) != NULL) {
+        return Py_BuildValue("(NN)", PyLong_FromVoidPtr(PyMethod_GET_SELF(callback)), PyLong_FromVoidPtr(PyMethod_GET_FUNCTION(callback)));
+    }
+    return PyLong_FromVoidPtr(callback);
+}
+
+
+static void
+pyuv__timer_batch_deliver(Loop *loop)
+{
+    Timer **timers, *timer;
+    size_t i, count;
+    PyObject *groups, *key, *list, *result;
+    uint64_t start;
+
+    timers = loop->timer_batch.timers;
+    count = loop->timer_batch.count;
+    loop->timer_batch.timers = NULL;
+    loop->timer_batch.count = 0;
+    loop->timer_batch.capacity = 0;
+    uv_prepare_stop(&loop->timer_batch.prepare);
+
+    groups = PyDict_New();
+    if (groups == NULL) {
+        handle_uncaught_exception(loop);
+    }
+
+    /* stop() resets the state, so a stopped timer is not delivered and a timer which was queued
+     * again after being restarted is only delivered once */
+    for (i = 0; i < count; i++) {
+        timer = timers[i];
+        if (timer->batch_state != PYUV_TIMER_BATCH_QUEUED) {
+            continue;
+        }
+        if (groups == NULL || uv_is_closing(UV_HANDLE(timer)) || timer->callback == NULL) {
+            timer->batch_state = PYUV_TIMER_BATCH_NONE;
+            continue;
+        }
+        timer->batch_state = PYUV_TIMER_BATCH_COLLECTED;
+        key = pyuv__timer_batch_key(timer->callback);
+        if (key == NULL) {
+            handle_uncaught_exception(loop);
+            continue;
+        }
+        list = PyDict_GetItem(groups, key);
+        if (list == NULL) {
+            list = PyList_New(0);
+            if (list == NULL || PyDict_SetItem(groups, key, list) < 0) {
+                Py_XDECREF(list);
+                Py_DECREF(key);
+                handle_uncaught_exception(loop);
+                continue;
+            }
+            Py_DECREF(list);
+        }
+        Py_DECREF(key);
+        if (PyList_Append(list, (PyObject *)timer) < 0) {
+            handle_uncaught_exception(loop);
+        }
+    }
+
+    /* callbacks are called in the order their first timer expired */
+    for (i = 0; groups != NULL && i < count; i++) {
+        timer = timers[i];
+        if (timer->batch_state != PYUV_TIMER_BATCH_COLLECTED || timer->callback == NULL) {
+            continue;
+        }
+        key = pyuv__timer_batch_key(timer->callback);
+        if (key == NULL) {
+            handle_uncaught_exception(loop);
+            continue;
+        }
+        list = PyDict_GetItem(groups, key);
+        if (list == NULL) {
+            Py_DECREF(key);
+            continue;
+        }
+        Py_INCREF(list);
+        PyDict_DelItem(groups, key);
+        Py_DECREF(key);
+        start = pyuv__loop_call_start(loop);
+        result = PyObject_CallFunctionObjArgs(timer->callback, list, NULL);
+        pyuv__loop_call_end(loop, list, timer->callback, start);
+        if (result == NULL) {
+            handle_uncaught_exception(loop);
+        }
+        Py_XDECREF(result);
+        Py_DECREF(list);
+    }
+
+    /* delivered timers keep their reference like non batched ones do after running, unless they
+     * were started again in the meantime */
+    for (i = 0; i < count; i++) {
+        timer = timers[i];
+        if (timer->batch_state == PYUV_TIMER_BATCH_COLLECTED && !uv_is_closing(UV_HANDLE(timer)) && !(HANDLE(timer)->flags & PYUV__PYREF)) {
+            timer->batch_state = PYUV_TIMER_BATCH_NONE;
+            HANDLE(timer)->flags |= PYUV__PYREF;
+        } else {
+            if (timer->batch_state == PYUV_TIMER_BATCH_COLLECTED) {
+                timer->batch_state = PYUV_TIMER_BATCH_NONE;
+            }
+            Py_DECREF(timer);
+        }
+    }
+
+    Py_XDECREF(groups);
+    free(timers);
+}
+
+
+static void
+pyuv__timer_batch_prepare_cb(uv_prepare_t *handle)
+{
+    gil_state gstate = pyuv__gil_ensure(handle->loop);
+    pyuv__timer_batch_deliver(PYUV_CONTAINER_OF(handle, Loop, timer_batch.prepare));
+    pyuv__gil_release(gstate);
+}
+
+
+/* Called without the GIL, returns 0 if the timer was queued */
+static int
+pyuv__timer_batch_add(Timer *self)
+{
+    Loop *loop;
+    Timer **timers;
+    size_t capacity;
+
+    loop = (Loop *)self->timer_h.loop->data;
+
+    if (self->batch_state == PYUV_TIMER_BATCH_QUEUED) {
+        return 0;
+    }
+
+    if (loop == NULL || !(HANDLE(self)->flags & PYUV__PYREF)) {
+        return -1;
+    }
+
+    if (loop->timer_batch.count == loop->timer_batch.capacity) {
+        capacity = loop->timer_batch.capacity ? loop->timer_batch.capacity * 2 : 64;
+        timers = realloc(loop->timer_batch.timers, capacity * sizeof *timers);
+        if (timers == NULL) {
+            return -1;
+        }
+        loop->timer_batch.timers = timers;
+        loop->timer_batch.capacity = capacity;
+    }
+
+    if (!loop->timer_batch.init) {
+        uv_prepare_init(loop->uv_loop, &loop->timer_batch.prepare);
+        loop->timer_batch.prepare.data = NULL;
+        loop->timer_batch.init = True;
+    }
+    if (loop->timer_batch.count == 0) {
+        uv_prepare_start(&loop->timer_batch.prepare, pyuv__timer_batch_prepare_cb);
+    }
+
+    HANDLE(self)->flags &= ~PYUV__PYREF;
+    self->batch_state = PYUV_TIMER_BATCH_QUEUED;
+    loop->timer_batch.timers[loop->timer_batch.count++] = self;
+
+    return 0;
+}
+
+
+/* Timeout for a deadline within [timeout, timeout + slack]. The last deadline picked by a timer
+ * with slack is reused when it falls in the window, otherwise the latest one is picked, so timers
+ * with overlapping windows expire together in the same loop iteration */
+static uint64_t
+pyuv__timer_slack_timeout(Timer *self, uint64_t timeout)
+{
+    Loop *loop;
+    uint64_t now, due;
+
+    loop = (Loop *)self->timer_h.loop->data;
+    if (self->slack == 0 || loop == NULL) {
+        return timeout;
+    }
+
+    now = uv_now(self->timer_h.loop);
+    due = loop->timer_batch.slack_due;
+    if (due < now + timeout || due > now + timeout + self->slack) {
+        due = now + timeout + self->slack;
+        loop->timer_batch.slack_due = due;
+    }
+    return due - now;
+}
+
+
 static void
 pyuv__timer_cb(uv_timer_t *handle)
 {
-    PyGILState_STATE gstate = PyGILState_Ensure();
+    gil_state gstate;
     Timer *self;
     PyObject *result;
+    uint64_t start, repeat;
 
     ASSERT(handle);
     self = PYUV_CONTAINER_OF(handle, Timer, timer_h);
 
+    /* libuv rescheduled the timer relative to the current loop time, apply the slack again */
+    repeat = uv_timer_get_repeat(handle);
+    if (self->slack != 0 && repeat != 0) {
+        uv_timer_start(handle, pyuv__timer_cb, pyuv__timer_slack_timeout(self, repeat), repeat);
+    }
+
+    if (self->batch && pyuv__timer_batch_add(self) == 0) {
+        return;
+    }
+
+    gstate = pyuv__gil_ensure(handle->loop);
+
     /* Object could go out of scope in the callback, increase refcount to avoid it */
     Py_INCREF(self);
 
+    start = pyuv__handle_call_start(HANDLE(self));
     result = PyObject_CallFunctionObjArgs(self->callback, self, NULL);
+    pyuv__handle_call_end(HANDLE(self), self->callback, start);
     if (result == NULL) {
         handle_uncaught_exception(HANDLE(self)->loop);
     }
     Py_XDECREF(result);
 
     Py_DECREF(self);
-    PyGILState_Release(gstate);
+    pyuv__gil_release(gstate);
 }
 
 
@@ -27,17 +244,19 @@ static PyObject *
 Timer_func_start(Timer *self, PyObject *args, PyObject *kwargs)
 {
     int err;
-    double timeout, repeat;
-    PyObject *tmp, *callback;
+    double timeout, repeat, slack;
+    PyObject *tmp, *callback, *batch;
 
-    static char *kwlist[] = {"callback", "timeout", "repeat", NULL};
+    static char *kwlist[] = {"callback", "timeout", "repeat", "slack", "batch", NULL};
 
     tmp = NULL;
+    slack = 0.0;
+    batch = Py_False;
 
     RAISE_IF_HANDLE_NOT_INITIALIZED(self, NULL);
     RAISE_IF_HANDLE_CLOSED(self, PyExc_HandleClosedError, NULL);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Odd:__init__", kwlist, &callback, &timeout, &repeat)) {
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Odd|dO!:__init__", kwlist, &callback, &timeout, &repeat, &slack, &PyBool_Type, &batch)) {
         return NULL;
     }
 
@@ -70,7 +289,15 @@ Timer_func_start(Timer *self, PyObject *args, PyObject *kwargs)
         repeat = 0.001;
     }
 
-    err = uv_timer_start(&self->timer_h, pyuv__timer_cb, (uint64_t)(timeout * 1000), (uint64_t)(repeat * 1000));
+    if (slack < 0.0) {
+        PyErr_SetString(PyExc_ValueError, "a positive value or zero is required");
+        return NULL;
+    }
+
+    self->slack = (uint64_t)(slack * 1000);
+    self->batch = batch == Py_True;
+
+    err = uv_timer_start(&self->timer_h, pyuv__timer_cb, pyuv__timer_slack_timeout(self, (uint64_t)(timeout * 1000)), (uint64_t)(repeat * 1000));
     if (err < 0) {
         RAISE_UV_EXCEPTION(err, PyExc_TimerError);
         return NULL;
@@ -101,6 +328,9 @@ Timer_func_stop(Timer *self)
         return NULL;
     }
 
+    /* a queued expiration is not delivered, the queue releases its reference */
+    self->batch_state = PYUV_TIMER_BATCH_NONE;
+
     PYUV_HANDLE_DECREF(self);
 
     Py_RETURN_NONE;
@@ -0,0 +1,639 @@
+
+/* TimerWheel
+ *
+ * A hashed timer wheel driven by a single repeating uv_timer_t. Entries are
+ * kept in doubly linked lists, one per slot, so scheduling and cancelling are
+ * O(1). Timeouts longer than a full turn of the wheel are stored with the
+ * number of remaining turns. The wheel holds a reference to every scheduled
+ * entry, and the entry holds a reference to the wheel.
+ */
+
+static void
+pyuv__timer_wheel_link(TimerWheelEntry *entry, TimerWheelEntry **list)
+{
+    ASSERT(entry->list == NULL);
+
+    entry->list = list;
+    entry->prev = NULL;
+    entry->next = *list;
+    if (entry->next != NULL) {
+        entry->next->prev = entry;
+    }
+    *list = entry;
+}
+
+
+static void
+pyuv__timer_wheel_unlink(TimerWheelEntry *entry)
+{
+    ASSERT(entry->list != NULL);
+
+    if (entry->prev != NULL) {
+        entry->prev->next = entry->next;
+    } else {
+        *entry->list = entry->next;
+    }
+    if (entry->next != NULL) {
+        entry->next->prev = entry->prev;
+    }
+    entry->list = NULL;
+    entry->prev = NULL;
+    entry->next = NULL;
+}
+
+
+static void pyuv__timer_wheel_cb(uv_timer_t *handle);
+
+
+/* Run the libuv timer only while there are scheduled entries */
+static int
+pyuv__timer_wheel_update(TimerWheel *self)
+{
+    int err;
+
+    if (self->count > 0 && !self->running) {
+        if (uv_is_closing(UV_HANDLE(self))) {
+            return 0;
+        }
+        self->last_tick = uv_now(self->timer_h.loop);
+        err = uv_timer_start(&self->timer_h, pyuv__timer_wheel_cb, self->granularity, self->granularity);
+        if (err < 0) {
+            return err;
+        }
+        self->running = True;
+        PYUV_HANDLE_INCREF(self);
+    } else if (self->count == 0 && self->running) {
+        uv_timer_stop(&self->timer_h);
+        self->running = False;
+        PYUV_HANDLE_DECREF(self);
+    }
+
+    return 0;
+}
+
+
+static int
+pyuv__timer_wheel_schedule(TimerWheel *self, TimerWheelEntry *entry, uint64_t timeout)
+{
+    int err;
+    uint64_t ticks;
+
+    if (entry->list != NULL) {
+        pyuv__timer_wheel_unlink(entry);
+    } else {
+        Py_INCREF(entry);
+        self->count++;
+    }
+
+    err = pyuv__timer_wheel_update(self);
+    if (err < 0) {
+        self->count--;
+        Py_DECREF(entry);
+        return err;
+    }
+
+    /* ticks are counted from the last one processed, which may be in the past */
+    ticks = (uv_now(self->timer_h.loop) - self->last_tick + timeout + self->granularity - 1) / self->granularity;
+    if (ticks == 0) {
+        ticks = 1;
+    }
+    entry->rounds = (ticks - 1) / self->nslots;
+    pyuv__timer_wheel_link(entry, &self->slots[(self->current + ticks) % self->nslots]);
+
+    return 0;
+}
+
+
+static void
+pyuv__timer_wheel_cancel(TimerWheel *self, TimerWheelEntry *entry)
+{
+    if (entry->list == NULL) {
+        return;
+    }
+
+    pyuv__timer_wheel_unlink(entry);
+    self->count--;
+    Py_DECREF(entry);
+}
+
+
+static void
+pyuv__timer_wheel_cancel_all(TimerWheel *self)
+{
+    unsigned int i;
+
+    if (self->slots == NULL) {
+        return;
+    }
+
+    for (i = 0; i < self->nslots; i++) {
+        while (self->slots[i] != NULL) {
+            pyuv__timer_wheel_cancel(self, self->slots[i]);
+        }
+    }
+    while (self->expired != NULL) {
+        pyuv__timer_wheel_cancel(self, self->expired);
+    }
+}
+
+
+static void
+pyuv__timer_wheel_cb(uv_timer_t *handle)
+{
+    gil_state gstate = pyuv__gil_ensure(handle->loop);
+    TimerWheel *self;
+    TimerWheelEntry *entry, *next;
+    PyObject *result;
+    uint64_t now, start;
+
+    ASSERT(handle);
+    self = PYUV_CONTAINER_OF(handle, TimerWheel, timer_h);
+
+    /* Object could go out of scope in the callback, increase refcount to avoid it */
+    Py_INCREF(self);
+
+    now = uv_now(handle->loop);
+    while (self->count > 0 && now - self->last_tick >= self->granularity) {
+        self->last_tick += self->granularity;
+        self->current = (self->current + 1) % self->nslots;
+
+        for (entry = self->slots[self->current]; entry != NULL; entry = next) {
+            next = entry->next;
+            if (entry->rounds > 0) {
+                entry->rounds--;
+            } else {
+                pyuv__timer_wheel_unlink(entry);
+                pyuv__timer_wheel_link(entry, &self->expired);
+            }
+        }
+
+        /* callbacks may schedule or cancel any entry, including expired ones */
+        while (self->expired != NULL) {
+            entry = self->expired;
+            pyuv__timer_wheel_unlink(entry);
+            self->count--;
+
+            /* the reference held by the wheel is released after the callback */
+            start = pyuv__handle_call_start(HANDLE(self));
+            result = PyObject_CallFunctionObjArgs(entry->callback, entry, NULL);
+            pyuv__handle_call_end(HANDLE(self), entry->callback, start);
+            if (result == NULL) {
+                handle_uncaught_exception(HANDLE(self)->loop);
+            }
+            Py_XDECREF(result);
+            Py_DECREF(entry);
+        }
+    }
+
+    pyuv__timer_wheel_update(self);
+
+    Py_DECREF(self);
+    pyuv__gil_release(gstate);
+}
+
+
+static int
+pyuv__timer_wheel_timeout(double timeout, uint64_t *result)
+{
+    if (timeout < 0.0) {
+        PyErr_SetString(PyExc_ValueError, "a positive value or zero is required");
+        return -1;
+    }
+
+    *result = (uint64_t)(timeout * 1000);
+    return 0;
+}
+
+
+static PyObject *
+TimerWheel_func_schedule(TimerWheel *self, PyObject *args, PyObject *kwargs)
+{
+    int err;
+    double timeout;
+    uint64_t timeout_ms;
+    PyObject *callback;
+    TimerWheelEntry *entry;
+
+    static char *kwlist[] = {"callback", "timeout", NULL};
+
+    RAISE_IF_HANDLE_NOT_INITIALIZED(self, NULL);
+    RAISE_IF_HANDLE_CLOSED(self, PyExc_HandleClosedError, NULL);
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Od:schedule", kwlist, &callback, &timeout)) {
+        return NULL;
+    }
+
+    if (!PyCallable_Check(callback)) {
+        PyErr_SetString(PyExc_TypeError, "a callable is required");
+        return NULL;
+    }
+
+    if (pyuv__timer_wheel_timeout(timeout, &timeout_ms) < 0) {
+        return NULL;
+    }
+
+    entry = PyObject_GC_New(TimerWheelEntry, &TimerWheelEntryType);
+    if (!entry) {
+        return NULL;
+    }
+
+    Py_INCREF(self);
+    entry->wheel = self;
+    Py_INCREF(callback);
+    entry->callback = callback;
+    entry->list = NULL;
+    entry->prev = NULL;
+    entry->next = NULL;
+    entry->rounds = 0;
+    PyObject_GC_Track(entry);
+
+    err = pyuv__timer_wheel_schedule(self, entry, timeout_ms);
+    if (err < 0) {
+        RAISE_UV_EXCEPTION(err, PyExc_TimerError);
+        Py_DECREF(entry);
+        return NULL;
+    }
+
+    return (PyObject *)entry;
+}
+
+
+static PyObject *
+TimerWheel_func_close(TimerWheel *self, PyObject *args)
+{
+    PyObject *result;
+
+    result = Handle_func_close(HANDLE(self), args);
+    if (result != NULL) {
+        pyuv__timer_wheel_cancel_all(self);
+        pyuv__timer_wheel_update(self);
+    }
+
+    return result;
+}
+
+
+static PyObject *
+TimerWheel_count_get(TimerWheel *self, void *closure)
+{
+    UNUSED_ARG(closure);
+
+    RAISE_IF_HANDLE_NOT_INITIALIZED(self, NULL);
+
+    return PyLong_FromSize_t(self->count);
+}
+
+
+static PyObject *
+TimerWheel_granularity_get(TimerWheel *self, void *closure)
+{
+    UNUSED_ARG(closure);
+
+    RAISE_IF_HANDLE_NOT_INITIALIZED(self, NULL);
+
+    return PyFloat_FromDouble(self->granularity/1000.0);
+}
+
+
+static PyObject *
+TimerWheel_slots_get(TimerWheel *self, void *closure)
+{
+    UNUSED_ARG(closure);
+
+    RAISE_IF_HANDLE_NOT_INITIALIZED(self, NULL);
+
+    return PyInt_FromLong((long)self->nslots);
+}
+
+
+static int
+TimerWheel_tp_init(TimerWheel *self, PyObject *args, PyObject *kwargs)
+{
+    int err;
+    unsigned int nslots;
+    double granularity;
+    Loop *loop;
+
+    static char *kwlist[] = {"loop", "granularity", "slots", NULL};
+
+    RAISE_IF_HANDLE_INITIALIZED(self, -1);
+
+    granularity = 0.01;
+    nslots = 512;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O!|dI:__init__", kwlist, &LoopType, &loop, &granularity, &nslots)) {
+        return -1;
+    }
+
+    if (granularity < 0.001) {
+        PyErr_SetString(PyExc_ValueError, "granularity must be at least 1ms");
+        return -1;
+    }
+
+    if (nslots == 0) {
+        PyErr_SetString(PyExc_ValueError, "a positive number of slots is required");
+        return -1;
+    }
+
+    self->slots = PyMem_Malloc(nslots * sizeof *self->slots);
+    if (!self->slots) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    memset(self->slots, 0, nslots * sizeof *self->slots);
+
+    err = uv_timer_init(loop->uv_loop, &self->timer_h);
+    if (err < 0) {
+        PyMem_Free(self->slots);
+        self->slots = NULL;
+        RAISE_UV_EXCEPTION(err, PyExc_TimerError);
+        return -1;
+    }
+
+    self->granularity = (uint64_t)(granularity * 1000);
+    self->nslots = nslots;
+
+    initialize_handle(HANDLE(self), loop);
+
+    return 0;
+}
+
+
+static PyObject *
+TimerWheel_tp_new(PyTypeObject *type, PyObject *args, PyObject *kwargs)
+{
+    TimerWheel *self;
+
+    self = (TimerWheel *)HandleType.tp_new(type, args, kwargs);
+    if (!self) {
+        return NULL;
+    }
+
+    self->timer_h.data = self;
+    UV_HANDLE(self) = (uv_handle_t *)&self->timer_h;
+    self->slots = NULL;
+    self->expired = NULL;
+    self->count = 0;
+    self->running = False;
+
+    return (PyObject *)self;
+}
+
+
+static int
+TimerWheel_tp_traverse(TimerWheel *self, visitproc visit, void *arg)
+{
+    unsigned int i;
+    TimerWheelEntry *entry;
+
+    if (self->slots != NULL) {
+        for (i = 0; i < self->nslots; i++) {
+            for (entry = self->slots[i]; entry != NULL; entry = entry->next) {
+                Py_VISIT(entry);
+            }
+        }
+    }
+    for (entry = self->expired; entry != NULL; entry = entry->next) {
+        Py_VISIT(entry);
+    }
+    return HandleType.tp_traverse((PyObject *)self, visit, arg);
+}
+
+
+static int
+TimerWheel_tp_clear(TimerWheel *self)
+{
+    pyuv__timer_wheel_cancel_all(self);
+    if (self->slots != NULL) {
+        PyMem_Free(self->slots);
+        self->slots = NULL;
+    }
+    return HandleType.tp_clear((PyObject *)self);
+}
+
+
+static PyMethodDef
+TimerWheel_tp_methods[] = {
+    { "schedule", (PyCFunction)TimerWheel_func_schedule, METH_VARARGS|METH_KEYWORDS, "Schedule a callback to be run after the given timeout." },
+    { "close", (PyCFunction)TimerWheel_func_close, METH_VARARGS, "Close the TimerWheel, cancelling all scheduled entries." },
+    { NULL }
+};
+
+
+static PyGetSetDef TimerWheel_tp_getsets[] = {
+    {"count", (getter)TimerWheel_count_get, NULL, "Number of scheduled entries.", NULL},
+    {"granularity", (getter)TimerWheel_granularity_get, NULL, "Duration of a wheel tick.", NULL},
+    {"slots", (getter)TimerWheel_slots_get, NULL, "Number of slots in the wheel.", NULL},
+    {NULL}
+};
+
+
+static PyTypeObject TimerWheelType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "pyuv._cpyuv.TimerWheel",                                       /*tp_name*/
+    sizeof(TimerWheel),                                             /*tp_basicsize*/
+    0,                                                              /*tp_itemsize*/
+    0,                                                              /*tp_dealloc*/
+    0,                                                              /*tp_print*/
+    0,                                                              /*tp_getattr*/
+    0,                                                              /*tp_setattr*/
+    0,                                                              /*tp_compare*/
+    0,                                                              /*tp_repr*/
+    0,                                                              /*tp_as_number*/
+    0,                                                              /*tp_as_sequence*/
+    0,                                                              /*tp_as_mapping*/
+    0,                                                              /*tp_hash */
+    0,                                                              /*tp_call*/
+    0,                                                              /*tp_str*/
+    0,                                                              /*tp_getattro*/
+    0,                                                              /*tp_setattro*/
+    0,                                                              /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HAVE_GC,  /*tp_flags*/
+    0,                                                              /*tp_doc*/
+    (traverseproc)TimerWheel_tp_traverse,                           /*tp_traverse*/
+    (inquiry)TimerWheel_tp_clear,                                   /*tp_clear*/
+    0,                                                              /*tp_richcompare*/
+    0,                                                              /*tp_weaklistoffset*/
+    0,                                                              /*tp_iter*/
+    0,                                                              /*tp_iternext*/
+    TimerWheel_tp_methods,                                          /*tp_methods*/
+    0,                                                              /*tp_members*/
+    TimerWheel_tp_getsets,                                          /*tp_getsets*/
+    0,                                                              /*tp_base*/
+    0,                                                              /*tp_dict*/
+    0,                                                              /*tp_descr_get*/
+    0,                                                              /*tp_descr_set*/
+    0,                                                              /*tp_dictoffset*/
+    (initproc)TimerWheel_tp_init,                                   /*tp_init*/
+    0,                                                              /*tp_alloc*/
+    TimerWheel_tp_new,                                              /*tp_new*/
+};
+
+
+/* TimerWheel entries, created by TimerWheel.schedule */
+
+static PyObject *
+TimerWheelEntry_func_cancel(TimerWheelEntry *self)
+{
+    if (self->wheel != NULL) {
+        pyuv__timer_wheel_cancel(self->wheel, self);
+        pyuv__timer_wheel_update(self->wheel);
+    }
+
+    Py_RETURN_NONE;
+}
+
+
+static PyObject *
+TimerWheelEntry_func_reschedule(TimerWheelEntry *self, PyObject *args)
+{
+    int err;
+    double timeout;
+    uint64_t timeout_ms;
+
+    if (!PyArg_ParseTuple(args, "d:reschedule", &timeout)) {
+        return NULL;
+    }
+
+    if (self->wheel == NULL || self->callback == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "entry is no longer valid");
+        return NULL;
+    }
+
+    RAISE_IF_HANDLE_CLOSED(self->wheel, PyExc_HandleClosedError, NULL);
+
+    if (pyuv__timer_wheel_timeout(timeout, &timeout_ms) < 0) {
+        return NULL;
+    }
+
+    err = pyuv__timer_wheel_schedule(self->wheel, self, timeout_ms);
+    if (err < 0) {
+        RAISE_UV_EXCEPTION(err, PyExc_TimerError);
+        return NULL;
+    }
+
+    Py_RETURN_NONE;
+}
+
+
+static PyObject *
+TimerWheelEntry_active_get(TimerWheelEntry *self, void *closure)
+{
+    UNUSED_ARG(closure);
+
+    return PyBool_FromLong((long)(self->list != NULL));
+}
+
+
+static PyObject *
+TimerWheelEntry_wheel_get(TimerWheelEntry *self, void *closure)
+{
+    UNUSED_ARG(closure);
+
+    if (self->wheel == NULL) {
+        Py_RETURN_NONE;
+    }
+    Py_INCREF(self->wheel);
+    return (PyObject *)self->wheel;
+}
+
+
+static PyObject *
+TimerWheelEntry_callback_get(TimerWheelEntry *self, void *closure)
+{
+    UNUSED_ARG(closure);
+
+    if (self->callback == NULL) {
+        Py_RETURN_NONE;
+    }
+    Py_INCREF(self->callback);
+    return self->callback;
+}
+
+
+static int
+TimerWheelEntry_tp_traverse(TimerWheelEntry *self, visitproc visit, void *arg)
+{
+    Py_VISIT(self->wheel);
+    Py_VISIT(self->callback);
+    return 0;
+}
+
+
+static int
+TimerWheelEntry_tp_clear(TimerWheelEntry *self)
+{
+    /* a scheduled entry stays linked, the wheel releases it when cleared */
+    Py_CLEAR(self->wheel);
+    Py_CLEAR(self->callback);
+    return 0;
+}
+
+
+static void
+TimerWheelEntry_tp_dealloc(TimerWheelEntry *self)
+{
+    ASSERT(self->list == NULL);
+    PyObject_GC_UnTrack(self);
+    TimerWheelEntry_tp_clear(self);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+
+static PyMethodDef
+TimerWheelEntry_tp_methods[] = {
+    { "cancel", (PyCFunction)TimerWheelEntry_func_cancel, METH_NOARGS, "Cancel the entry." },
+    { "reschedule", (PyCFunction)TimerWheelEntry_func_reschedule, METH_VARARGS, "Schedule the entry again with the given timeout." },
+    { NULL }
+};
+
+
+static PyGetSetDef TimerWheelEntry_tp_getsets[] = {
+    {"active", (getter)TimerWheelEntry_active_get, NULL, "Indicates if the entry is scheduled.", NULL},
+    {"wheel", (getter)TimerWheelEntry_wheel_get, NULL, "TimerWheel this entry belongs to.", NULL},
+    {"callback", (getter)TimerWheelEntry_callback_get, NULL, "Callback run when the entry expires.", NULL},
+    {NULL}
+};
+
+
+static PyTypeObject TimerWheelEntryType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "pyuv._cpyuv.TimerWheelEntry",                                  /*tp_name*/
+    sizeof(TimerWheelEntry),                                        /*tp_basicsize*/
+    0,                                                              /*tp_itemsize*/
+    (destructor)TimerWheelEntry_tp_dealloc,                         /*tp_dealloc*/
+    0,                                                              /*tp_print*/
+    0,                                                              /*tp_getattr*/
+    0,                                                              /*tp_setattr*/
+    0,                                                              /*tp_compare*/
+    0,                                                              /*tp_repr*/
+    0,                                                              /*tp_as_number*/
+    0,                                                              /*tp_as_sequence*/
+    0,                                                              /*tp_as_mapping*/
+    0,                                                              /*tp_hash */
+    0,                                                              /*tp_call*/
+    0,                                                              /*tp_str*/
+    0,                                                              /*tp_getattro*/
+    0,                                                              /*tp_setattro*/
+    0,                                                              /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,                        /*tp_flags*/
+    0,                                                              /*tp_doc*/
+    (traverseproc)TimerWheelEntry_tp_traverse,                      /*tp_traverse*/
+    (inquiry)TimerWheelEntry_tp_clear,                              /*tp_clear*/
+    0,                                                              /*tp_richcompare*/
+    0,                                                              /*tp_weaklistoffset*/
+    0,                                                              /*tp_iter*/
+    0,                                                              /*tp_iternext*/
+    TimerWheelEntry_tp_methods,                                     /*tp_methods*/
+    0,                                                              /*tp_members*/
+    TimerWheelEntry_tp_getsets,                                     /*tp_getsets*/
+    0,                                                              /*tp_base*/
+    0,                                                              /*tp_dict*/
+    0,                                                              /*tp_descr_get*/
+    0,                                                              /*tp_descr_set*/
+    0,                                                              /*tp_dictoffset*/
+    0,                                                              /*tp_init*/
+    0,                                                              /*tp_alloc*/
+    0,                                                              /*tp_new*/
+};
+
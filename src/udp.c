@@ -1,3 +1,26 @@
+#if defined(__linux__)
+# include <netinet/udp.h>
+# define PYUV_HAVE_RECVMMSG 1
+# define PYUV_HAVE_SENDMMSG 1
+# define PYUV_HAVE_UDP_OFFLOAD 1
+/* Segmentation offload options, missing from older headers */
+# ifndef SOL_UDP
+#  define SOL_UDP 17
+# endif
+# ifndef UDP_SEGMENT
+#  define UDP_SEGMENT 103
+# endif
+# ifndef UDP_GRO
+#  define UDP_GRO 104
+# endif
+# define PYUV_UDP_CONTROL_SIZE CMSG_SPACE(sizeof(int))
+# define PYUV_UDP_SEGMENT UDP_SEGMENT
+# define PYUV_UDP_GRO UDP_GRO
+#else
+# define PYUV_UDP_SEGMENT 0
+# define PYUV_UDP_GRO 0
+#endif
+
 
 typedef struct {
     uv_udp_send_t req;
@@ -8,16 +31,52 @@ typedef struct {
 } udp_send_ctx;
 
 
+/* State for batch mode receives. On Linux datagrams are read with recvmmsg from the alloc
+ * callback, which then hands libuv an empty buffer so it doesn't read itself, and all of them
+ * are delivered in a single callback. With GRO, coalesced datagrams are split in segments. */
+typedef struct udp_recv_batch_s {
+    Loop *loop;
+    int size;
+    int count;
+    int error;
+    int gro;
+    size_t chunk_size;
+    char **chunks;
+    struct sockaddr_storage *addrs;
+#ifdef PYUV_HAVE_RECVMMSG
+    struct mmsghdr *msgs;
+    struct iovec *iovs;
+    char *controls;
+#endif
+} udp_recv_batch;
+
+
+/* Context for send_many, allocated in one go together with the arrays it points to */
+typedef struct {
+    UDP *obj;
+    PyObject *callback;
+    int count;
+    int pending;
+    int error;
+    uv_udp_send_t *reqs;
+    struct sockaddr_storage *addrs;
+    Py_buffer *views;
+#ifdef PYUV_HAVE_SENDMMSG
+    struct mmsghdr *msgs;
+    struct iovec *iovs;
+#endif
+} udp_send_many_ctx;
+
+
 static void
 pyuv__udp_recv_cd(uv_udp_t* handle, int nread, const uv_buf_t* buf, struct sockaddr* addr, unsigned flags)
 {
-    PyGILState_STATE gstate = PyGILState_Ensure();
-    Loop *loop;
+    gil_state gstate = pyuv__gil_ensure(handle->loop);
     UDP *self;
-    PyObject *result, *address_tuple, *data, *py_errorno;
+    PyObject *result, *address_tuple, *data, *py_flags, *py_errorno;
+    uint64_t start;
 
     ASSERT(handle);
-    ASSERT(flags == 0);
 
     self = PYUV_CONTAINER_OF(handle, UDP, udp_h);
 
@@ -31,12 +90,19 @@ pyuv__udp_recv_cd(uv_udp_t* handle, int nread, const uv_buf_t* buf, struct socka
 
     if (nread >= 0) {
         ASSERT(addr);
-        address_tuple = makesockaddr(addr);
-        if (nread == 0) {
-            data = PyBytes_FromString("");
+        pyuv__handle_stats_read(HANDLE(self), (size_t)nread);
+        if (HANDLE(self)->flags & PYUV__READ_ZEROCOPY) {
+            /* The Buffer object takes ownership of the chunk */
+            data = pyuv__alloc_to_buffer((uv_handle_t *)handle, buf, nread);
+            buf = NULL;
         } else {
             data = PyBytes_FromStringAndSize(buf->base, nread);
         }
+        if (data == NULL) {
+            handle_uncaught_exception(HANDLE(self)->loop);
+            goto done;
+        }
+        address_tuple = makesockaddr(addr);
         py_errorno = Py_None;
         Py_INCREF(Py_None);
     } else {
@@ -47,34 +113,387 @@ pyuv__udp_recv_cd(uv_udp_t* handle, int nread, const uv_buf_t* buf, struct socka
         py_errorno = PyInt_FromLong((long)nread);
     }
 
-    result = PyObject_CallFunctionObjArgs(self->on_read_cb, self, address_tuple, PyInt_FromLong((long)flags), data, py_errorno, NULL);
+    py_flags = PyInt_FromLong((long)flags);
+
+    start = pyuv__handle_call_start(HANDLE(self));
+    result = PyObject_CallFunctionObjArgs(self->on_read_cb, self, address_tuple, py_flags, data, py_errorno, NULL);
+    pyuv__handle_call_end(HANDLE(self), self->on_read_cb, start);
     if (result == NULL) {
         handle_uncaught_exception(HANDLE(self)->loop);
     }
     Py_XDECREF(result);
     Py_DECREF(address_tuple);
+    Py_DECREF(py_flags);
     Py_DECREF(data);
     Py_DECREF(py_errorno);
 
 done:
-    /* data has been read, unlock the buffer */
-    loop = handle->loop->data;
-    ASSERT(loop);
-    loop->buffer.in_use = False;
+    /* data has been read, return the buffer to the pool */
+    if (buf != NULL) {
+        pyuv__alloc_release((uv_handle_t *)handle, buf);
+    }
+
+    Py_DECREF(self);
+    pyuv__gil_release(gstate);
+}
+
+
+static udp_recv_batch *
+pyuv__udp_batch_new(Loop *loop, int size, size_t chunk_size, int gro)
+{
+    udp_recv_batch *batch;
+
+    batch = PyMem_Malloc(sizeof *batch);
+    if (batch == NULL) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    memset(batch, 0, sizeof *batch);
+    batch->size = size;
+    batch->chunk_size = chunk_size;
+    batch->gro = gro;
+    batch->chunks = PyMem_Malloc(sizeof(char *) * size);
+    batch->addrs = PyMem_Malloc(sizeof(struct sockaddr_storage) * size);
+#ifdef PYUV_HAVE_RECVMMSG
+    batch->msgs = PyMem_Malloc(sizeof(struct mmsghdr) * size);
+    batch->iovs = PyMem_Malloc(sizeof(struct iovec) * size);
+    batch->controls = PyMem_Malloc(PYUV_UDP_CONTROL_SIZE * size);
+    if (batch->msgs == NULL || batch->iovs == NULL || batch->controls == NULL)
+        goto error;
+#endif
+    if (batch->chunks == NULL || batch->addrs == NULL)
+        goto error;
+
+    memset(batch->chunks, 0, sizeof(char *) * size);
+
+    /* Chunks go back to the loop's pool, which must outlive the handle's loop reference */
+    Py_INCREF(loop);
+    batch->loop = loop;
+
+    return batch;
+
+error:
+    PyMem_Free(batch->chunks);
+    PyMem_Free(batch->addrs);
+#ifdef PYUV_HAVE_RECVMMSG
+    PyMem_Free(batch->msgs);
+    PyMem_Free(batch->iovs);
+    PyMem_Free(batch->controls);
+#endif
+    PyMem_Free(batch);
+    PyErr_NoMemory();
+    return NULL;
+}
+
+
+static void
+pyuv__udp_batch_free(udp_recv_batch *batch)
+{
+    int i;
+
+    if (batch == NULL) {
+        return;
+    }
+
+    for (i = 0; i < batch->size; i++) {
+        if (batch->chunks[i] != NULL)
+            pyuv__buffer_pool_put(&batch->loop->buffer_pool, batch->chunks[i], batch->chunk_size);
+    }
+
+    PyMem_Free(batch->chunks);
+    PyMem_Free(batch->addrs);
+#ifdef PYUV_HAVE_RECVMMSG
+    PyMem_Free(batch->msgs);
+    PyMem_Free(batch->iovs);
+    PyMem_Free(batch->controls);
+#endif
+    Py_DECREF(batch->loop);
+    PyMem_Free(batch);
+}
+
+
+#ifdef PYUV_HAVE_RECVMMSG
+/* Read as many datagrams as possible with a single system call. Runs without the GIL. */
+static void
+pyuv__udp_batch_recvmmsg(UDP *self, udp_recv_batch *batch)
+{
+    int i, n;
+    uv_os_fd_t fd;
+    struct msghdr *h;
+
+    if (uv_fileno(UV_HANDLE(self), &fd) < 0) {
+        return;
+    }
+
+    ASSERT(batch->count == 0);
+
+    for (i = 0; i < batch->size; i++) {
+        if (batch->chunks[i] == NULL) {
+            batch->chunks[i] = pyuv__buffer_pool_get(&batch->loop->buffer_pool, batch->chunk_size);
+            if (batch->chunks[i] == NULL)
+                break;
+        }
+        batch->iovs[i].iov_base = batch->chunks[i];
+        batch->iovs[i].iov_len = batch->chunk_size;
+        h = &batch->msgs[i].msg_hdr;
+        memset(h, 0, sizeof *h);
+        h->msg_name = &batch->addrs[i];
+        h->msg_namelen = sizeof(struct sockaddr_storage);
+        h->msg_iov = &batch->iovs[i];
+        h->msg_iovlen = 1;
+        if (batch->gro) {
+            h->msg_control = batch->controls + i * PYUV_UDP_CONTROL_SIZE;
+            h->msg_controllen = PYUV_UDP_CONTROL_SIZE;
+        }
+    }
+
+    if (i == 0) {
+        batch->error = UV_ENOBUFS;
+        return;
+    }
+
+    do {
+        n = recvmmsg(fd, batch->msgs, i, MSG_DONTWAIT, NULL);
+    } while (n == -1 && errno == EINTR);
+
+    if (n == -1) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            batch->error = -errno;
+    } else {
+        batch->count = n;
+    }
+}
+#endif
+
+
+static void
+pyuv__udp_batch_alloc_cb(uv_handle_t* handle, size_t suggested_size, uv_buf_t *buf)
+{
+#ifdef PYUV_HAVE_RECVMMSG
+    UDP *self;
+
+    UNUSED_ARG(suggested_size);
+
+    self = PYUV_CONTAINER_OF(handle, UDP, udp_h);
+    ASSERT(self->recv_batch);
+
+    pyuv__udp_batch_recvmmsg(self, self->recv_batch);
+
+    /* libuv doesn't read into an empty buffer, it calls the receive callback with
+     * UV_ENOBUFS right away and the datagrams read above are delivered then */
+    buf->base = NULL;
+    buf->len = 0;
+#else
+    pyuv__alloc_cb(handle, suggested_size, buf);
+#endif
+}
+
+
+/* Build the (address, flags, data) tuple for a received datagram. In zerocopy mode the chunk is
+ * owned by the returned data, else it's left untouched. */
+static PyObject *
+pyuv__udp_batch_packet(UDP *self, const uv_buf_t *buf, Py_ssize_t nread, const struct sockaddr *addr, unsigned flags)
+{
+    PyObject *data, *address_tuple, *packet;
+
+    if (HANDLE(self)->flags & PYUV__READ_ZEROCOPY) {
+        data = pyuv__alloc_to_buffer(UV_HANDLE(self), buf, nread);
+    } else {
+        data = PyBytes_FromStringAndSize(buf->base, nread);
+    }
+    if (data == NULL) {
+        return NULL;
+    }
+
+    address_tuple = makesockaddr((struct sockaddr *)addr);
+    if (address_tuple == NULL) {
+        Py_DECREF(data);
+        return NULL;
+    }
+
+    packet = Py_BuildValue("(NIN)", address_tuple, flags, data);
+    return packet;
+}
+
+
+#ifdef PYUV_HAVE_RECVMMSG
+/* Returns the segment size of a datagram coalesced by GRO, or 0 */
+static int
+pyuv__udp_gro_segment_size(struct msghdr *h)
+{
+    int size;
+    struct cmsghdr *cmsg;
+
+    for (cmsg = CMSG_FIRSTHDR(h); cmsg != NULL; cmsg = CMSG_NXTHDR(h, cmsg)) {
+        if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+            memcpy(&size, CMSG_DATA(cmsg), sizeof size);
+            return size;
+        }
+    }
+
+    return 0;
+}
+
+
+/* Append the packet(s) for the i-th datagram read by recvmmsg to the given list */
+static int
+pyuv__udp_batch_append(UDP *self, udp_recv_batch *batch, int i, PyObject *packets)
+{
+    int r;
+    unsigned flags;
+    size_t len, offset, segment;
+    uv_buf_t chunk;
+    PyObject *packet;
+
+    len = batch->msgs[i].msg_len;
+    flags = (batch->msgs[i].msg_hdr.msg_flags & MSG_TRUNC) ? UV_UDP_PARTIAL : 0;
+    pyuv__handle_stats_read(HANDLE(self), len);
+
+    segment = batch->gro ? (size_t)pyuv__udp_gro_segment_size(&batch->msgs[i].msg_hdr) : 0;
+    if (segment == 0 || segment > len) {
+        segment = len;
+    }
+
+    offset = 0;
+    do {
+        if (segment > len - offset) {
+            segment = len - offset;
+        }
+        chunk = uv_buf_init(batch->chunks[i] + offset, batch->chunk_size - offset);
+        packet = pyuv__udp_batch_packet(self,
+                                        &chunk,
+                                        segment,
+                                        (struct sockaddr *)&batch->addrs[i],
+                                        offset + segment == len ? flags : 0);
+        if (HANDLE(self)->flags & PYUV__READ_ZEROCOPY) {
+            /* The chunk is now owned by the Buffer object (or was returned to the pool). No GRO
+             * in zerocopy mode, so there is a single segment. */
+            batch->chunks[i] = NULL;
+        }
+        if (packet == NULL) {
+            return -1;
+        }
+        r = PyList_Append(packets, packet);
+        Py_DECREF(packet);
+        if (r < 0) {
+            return -1;
+        }
+        offset += segment;
+    } while (offset < len);
+
+    return 0;
+}
+#endif
+
+
+static void
+pyuv__udp_batch_recv_cb(uv_udp_t* handle, int nread, const uv_buf_t* buf, struct sockaddr* addr, unsigned flags)
+{
+    gil_state gstate = pyuv__gil_ensure(handle->loop);
+    int i, error;
+    UDP *self;
+    udp_recv_batch *batch;
+    PyObject *result, *packets, *packet, *py_errorno;
+    uint64_t start;
+
+    ASSERT(handle);
+
+    self = PYUV_CONTAINER_OF(handle, UDP, udp_h);
+    batch = self->recv_batch;
+    ASSERT(batch);
+
+    /* Object could go out of scope in the callback, increase refcount to avoid it */
+    Py_INCREF(self);
+
+    packets = NULL;
+    error = batch->error;
+    batch->error = 0;
+#ifdef PYUV_HAVE_RECVMMSG
+    /* Expected, see pyuv__udp_batch_alloc_cb */
+    if (nread == UV_ENOBUFS) {
+        nread = 0;
+    }
+#endif
+    if (nread < 0) {
+        error = nread;
+    }
+
+    if (batch->count > 0 || (nread >= 0 && addr != NULL)) {
+        packets = PyList_New(0);
+        if (packets == NULL)
+            goto error;
+
+#ifdef PYUV_HAVE_RECVMMSG
+        for (i = 0; i < batch->count; i++) {
+            if (pyuv__udp_batch_append(self, batch, i, packets) < 0)
+                goto error;
+        }
+#endif
+        batch->count = 0;
+
+        if (nread >= 0 && addr != NULL) {
+            packet = pyuv__udp_batch_packet(self, buf, nread, addr, flags);
+            if (HANDLE(self)->flags & PYUV__READ_ZEROCOPY) {
+                buf = NULL;
+            }
+            if (packet == NULL || PyList_Append(packets, packet) < 0) {
+                Py_XDECREF(packet);
+                goto error;
+            }
+            Py_DECREF(packet);
+        }
+
+        start = pyuv__handle_call_start(HANDLE(self));
+        result = PyObject_CallFunctionObjArgs(self->on_read_cb, self, packets, Py_None, NULL);
+        pyuv__handle_call_end(HANDLE(self), self->on_read_cb, start);
+        if (result == NULL) {
+            handle_uncaught_exception(HANDLE(self)->loop);
+        }
+        Py_XDECREF(result);
+        Py_CLEAR(packets);
+    }
+
+    /* The callback may have stopped receiving */
+    if (error < 0 && self->on_read_cb != NULL) {
+        py_errorno = PyInt_FromLong((long)error);
+        start = pyuv__handle_call_start(HANDLE(self));
+        result = PyObject_CallFunctionObjArgs(self->on_read_cb, self, Py_None, py_errorno, NULL);
+        pyuv__handle_call_end(HANDLE(self), self->on_read_cb, start);
+        if (result == NULL) {
+            handle_uncaught_exception(HANDLE(self)->loop);
+        }
+        Py_XDECREF(result);
+        Py_DECREF(py_errorno);
+    }
+
+    goto done;
+
+error:
+    batch->count = 0;
+    Py_XDECREF(packets);
+    handle_uncaught_exception(HANDLE(self)->loop);
+
+done:
+    /* data has been read, return the buffer to the pool */
+    if (buf != NULL) {
+        pyuv__alloc_release((uv_handle_t *)handle, buf);
+    }
 
     Py_DECREF(self);
-    PyGILState_Release(gstate);
+    pyuv__gil_release(gstate);
 }
 
 
 static void
 pyuv__udp_send_cb(uv_udp_send_t* req, int status)
 {
-    PyGILState_STATE gstate = PyGILState_Ensure();
+    gil_state gstate = pyuv__gil_ensure(req->handle->loop);
     int i;
     udp_send_ctx *ctx;
     UDP *self;
     PyObject *callback, *result, *py_errorno;
+    uint64_t start;
 
     ASSERT(req);
 
@@ -84,6 +503,11 @@ pyuv__udp_send_cb(uv_udp_send_t* req, int status)
 
     ASSERT(self);
 
+    if (status == 0) {
+        for (i = 0; i < ctx->view_count; i++)
+            pyuv__handle_stats_written(HANDLE(self), (size_t)ctx->views[i].len);
+    }
+
     if (callback != Py_None) {
         if (status < 0) {
             py_errorno = PyInt_FromLong((long)status);
@@ -91,7 +515,9 @@ pyuv__udp_send_cb(uv_udp_send_t* req, int status)
             py_errorno = Py_None;
             Py_INCREF(Py_None);
         }
+        start = pyuv__handle_call_start(HANDLE(self));
         result = PyObject_CallFunctionObjArgs(callback, self, py_errorno, NULL);
+        pyuv__handle_call_end(HANDLE(self), callback, start);
         if (result == NULL) {
             handle_uncaught_exception(HANDLE(self)->loop);
         }
@@ -105,12 +531,197 @@ pyuv__udp_send_cb(uv_udp_send_t* req, int status)
         PyBuffer_Release(&ctx->views[i]);
     if (ctx->views != ctx->viewsml)
         PyMem_Free(ctx->views);
+    pyuv__request_pool_free(req->handle->loop->data, PYUV_REQUEST_POOL_UDP_SEND, ctx);
+
+    /* Refcount was increased in the caller function */
+    Py_DECREF(self);
+
+    pyuv__gil_release(gstate);
+}
+
+
+static udp_send_many_ctx *
+pyuv__udp_send_many_ctx_new(int count)
+{
+    char *p;
+    size_t size;
+    udp_send_many_ctx *ctx;
+
+    size = sizeof(udp_send_many_ctx);
+    size += count * (sizeof(uv_udp_send_t) + sizeof(struct sockaddr_storage) + sizeof(Py_buffer));
+#ifdef PYUV_HAVE_SENDMMSG
+    size += count * (sizeof(struct mmsghdr) + sizeof(struct iovec));
+#endif
+
+    p = PyMem_Malloc(size);
+    if (p == NULL) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    ctx = (udp_send_many_ctx *)p;
+    memset(ctx, 0, sizeof *ctx);
+    p += sizeof(udp_send_many_ctx);
+    ctx->reqs = (uv_udp_send_t *)p;
+    p += count * sizeof(uv_udp_send_t);
+    ctx->addrs = (struct sockaddr_storage *)p;
+    p += count * sizeof(struct sockaddr_storage);
+    ctx->views = (Py_buffer *)p;
+#ifdef PYUV_HAVE_SENDMMSG
+    p += count * sizeof(Py_buffer);
+    ctx->msgs = (struct mmsghdr *)p;
+    p += count * sizeof(struct mmsghdr);
+    ctx->iovs = (struct iovec *)p;
+#endif
+
+    return ctx;
+}
+
+
+static void
+pyuv__udp_send_many_ctx_free(udp_send_many_ctx *ctx)
+{
+    int i;
+
+    for (i = 0; i < ctx->count; i++)
+        PyBuffer_Release(&ctx->views[i]);
     PyMem_Free(ctx);
+}
+
+
+/* Call the callback once all datagrams are gone, and release the context */
+static void
+pyuv__udp_send_many_done(udp_send_many_ctx *ctx)
+{
+    UDP *self;
+    PyObject *callback, *result, *py_errorno;
+    uint64_t start;
+
+    self = ctx->obj;
+    callback = ctx->callback;
+
+    if (callback != Py_None) {
+        if (ctx->error < 0) {
+            py_errorno = PyInt_FromLong((long)ctx->error);
+        } else {
+            py_errorno = Py_None;
+            Py_INCREF(Py_None);
+        }
+        start = pyuv__handle_call_start(HANDLE(self));
+        result = PyObject_CallFunctionObjArgs(callback, self, py_errorno, NULL);
+        pyuv__handle_call_end(HANDLE(self), callback, start);
+        if (result == NULL) {
+            handle_uncaught_exception(HANDLE(self)->loop);
+        }
+        Py_XDECREF(result);
+        Py_DECREF(py_errorno);
+    }
+
+    Py_DECREF(callback);
+    pyuv__udp_send_many_ctx_free(ctx);
 
     /* Refcount was increased in the caller function */
     Py_DECREF(self);
+}
+
+
+static void
+pyuv__udp_send_many_cb(uv_udp_send_t* req, int status)
+{
+    gil_state gstate = pyuv__gil_ensure(req->handle->loop);
+    udp_send_many_ctx *ctx;
+
+    ASSERT(req);
 
-    PyGILState_Release(gstate);
+    ctx = (udp_send_many_ctx *)req->data;
+    if (status < 0 && ctx->error == 0) {
+        ctx->error = status;
+    } else if (status == 0) {
+        pyuv__handle_stats_written(HANDLE(ctx->obj), (size_t)ctx->views[req - ctx->reqs].len);
+    }
+
+    if (--ctx->pending == 0) {
+        pyuv__udp_send_many_done(ctx);
+    }
+
+    pyuv__gil_release(gstate);
+}
+
+
+#ifdef PYUV_HAVE_SENDMMSG
+/* Send the first count datagrams with as few system calls as possible. Returns how many were sent,
+ * errors are left to be reported by libuv when sending the rest. */
+static int
+pyuv__udp_send_many_sendmmsg(UDP *self, udp_send_many_ctx *ctx, int count)
+{
+    int i, n, sent;
+    uv_os_fd_t fd;
+    struct msghdr *h;
+
+    if (uv_fileno(UV_HANDLE(self), &fd) < 0) {
+        /* The socket is created lazily by libuv */
+        return 0;
+    }
+
+    for (i = 0; i < count; i++) {
+        ctx->iovs[i].iov_base = ctx->views[i].buf;
+        ctx->iovs[i].iov_len = ctx->views[i].len;
+        h = &ctx->msgs[i].msg_hdr;
+        memset(h, 0, sizeof *h);
+        h->msg_name = &ctx->addrs[i];
+        h->msg_namelen = ctx->addrs[i].ss_family == AF_INET6 ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+        h->msg_iov = &ctx->iovs[i];
+        h->msg_iovlen = 1;
+    }
+
+    sent = 0;
+    while (sent < count) {
+        do {
+            n = sendmmsg(fd, ctx->msgs + sent, count - sent, 0);
+        } while (n == -1 && errno == EINTR);
+        if (n <= 0)
+            break;
+        sent += n;
+    }
+
+    for (i = 0; i < sent; i++)
+        pyuv__handle_stats_written(HANDLE(self), ctx->msgs[i].msg_len);
+
+    return sent;
+}
+#endif
+
+
+/* Get or set an integer UDP level socket option used for segmentation offload. The socket
+ * must exist already. */
+static int
+pyuv__udp_offload_option(UDP *self, int name, int *value, int set)
+{
+#ifdef PYUV_HAVE_UDP_OFFLOAD
+    int err, r;
+    uv_os_fd_t fd;
+    socklen_t len;
+
+    err = uv_fileno(UV_HANDLE(self), &fd);
+    if (err < 0) {
+        return err;
+    }
+
+    if (set) {
+        r = setsockopt(fd, SOL_UDP, name, value, sizeof *value);
+    } else {
+        len = sizeof *value;
+        r = getsockopt(fd, SOL_UDP, name, value, &len);
+    }
+
+    return r != 0 ? -errno : 0;
+#else
+    UNUSED_ARG(self);
+    UNUSED_ARG(name);
+    UNUSED_ARG(value);
+    UNUSED_ARG(set);
+    return UV_ENOTSUP;
+#endif
 }
 
 
@@ -135,6 +746,17 @@ UDP_func_bind(UDP *self, PyObject *args)
         return NULL;
     }
 
+#ifdef PYUV_EMULATE_REUSEPORT
+    if (flags & UV_UDP_REUSEPORT) {
+        flags &= ~UV_UDP_REUSEPORT;
+        err = pyuv__set_reuseport(UV_HANDLE(self), ss.ss_family);
+        if (err < 0) {
+            RAISE_UV_EXCEPTION(err, PyExc_UDPError);
+            return NULL;
+        }
+    }
+#endif
+
     err = uv_udp_bind(&self->udp_h, (struct sockaddr *)&ss, flags);
     if (err < 0) {
         RAISE_UV_EXCEPTION(err, PyExc_UDPError);
@@ -146,17 +768,27 @@ UDP_func_bind(UDP *self, PyObject *args)
 
 
 static PyObject *
-UDP_func_start_recv(UDP *self, PyObject *args)
+UDP_func_start_recv(UDP *self, PyObject *args, PyObject *kwargs)
 {
-    int err;
-    PyObject *tmp, *callback;
+    int err, batch, enable;
+    size_t chunk_size;
+    Py_ssize_t buffer_size;
+    udp_recv_batch *recv_batch;
+    PyObject *tmp, *callback, *zerocopy, *gro;
+
+    static char *kwlist[] = {"callback", "buffer_size", "zerocopy", "batch", "gro", NULL};
 
     tmp = NULL;
+    buffer_size = 0;
+    zerocopy = Py_False;
+    gro = Py_False;
+    batch = 0;
+    recv_batch = NULL;
 
     RAISE_IF_HANDLE_NOT_INITIALIZED(self, NULL);
     RAISE_IF_HANDLE_CLOSED(self, PyExc_HandleClosedError, NULL);
 
-    if (!PyArg_ParseTuple(args, "O:start_recv", &callback)) {
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|nO!iO!:start_recv", kwlist, &callback, &buffer_size, &PyBool_Type, &zerocopy, &batch, &PyBool_Type, &gro)) {
         return NULL;
     }
 
@@ -165,17 +797,69 @@ UDP_func_start_recv(UDP *self, PyObject *args)
         return NULL;
     }
 
-    err = uv_udp_recv_start(&self->udp_h, (uv_alloc_cb)pyuv__alloc_cb, (uv_udp_recv_cb)pyuv__udp_recv_cd);
+    if (buffer_size < 0 || (size_t)buffer_size > PYUV_BUFFER_POOL_MAX_SIZE) {
+        PyErr_Format(PyExc_ValueError, "buffer size must be between 0 and %zu", PYUV_BUFFER_POOL_MAX_SIZE);
+        return NULL;
+    }
+
+    if (batch < 0 || batch > PYUV_UDP_MAX_BATCH) {
+        PyErr_Format(PyExc_ValueError, "batch must be between 0 and %d", PYUV_UDP_MAX_BATCH);
+        return NULL;
+    }
+
+    if (gro == Py_True && (batch == 0 || zerocopy == Py_True)) {
+        PyErr_SetString(PyExc_ValueError, "gro requires batch mode and can't be used with zerocopy");
+        return NULL;
+    }
+
+    if (batch > 0) {
+        chunk_size = buffer_size ? pyuv__buffer_pool_round((size_t)buffer_size) : HANDLE(self)->loop->buffer_pool.chunk_size;
+        recv_batch = pyuv__udp_batch_new(HANDLE(self)->loop, batch, chunk_size, gro == Py_True);
+        if (recv_batch == NULL) {
+            return NULL;
+        }
+        err = uv_udp_recv_start(&self->udp_h, (uv_alloc_cb)pyuv__udp_batch_alloc_cb, (uv_udp_recv_cb)pyuv__udp_batch_recv_cb);
+    } else {
+        err = uv_udp_recv_start(&self->udp_h, (uv_alloc_cb)pyuv__alloc_cb, (uv_udp_recv_cb)pyuv__udp_recv_cd);
+    }
     if (err < 0) {
         RAISE_UV_EXCEPTION(err, PyExc_UDPError);
+        pyuv__udp_batch_free(recv_batch);
         return NULL;
     }
 
+    /* GRO is a socket option, turn it off again if a previous receive enabled it */
+    if (gro == Py_True || (HANDLE(self)->flags & PYUV__UDP_GRO)) {
+        enable = gro == Py_True;
+        err = pyuv__udp_offload_option(self, PYUV_UDP_GRO, &enable, 1);
+        if (err < 0) {
+            RAISE_UV_EXCEPTION(err, PyExc_UDPError);
+            uv_udp_recv_stop(&self->udp_h);
+            pyuv__udp_batch_free(recv_batch);
+            return NULL;
+        }
+        if (gro == Py_True) {
+            HANDLE(self)->flags |= PYUV__UDP_GRO;
+        } else {
+            HANDLE(self)->flags &= ~PYUV__UDP_GRO;
+        }
+    }
+
+    pyuv__udp_batch_free(self->recv_batch);
+    self->recv_batch = recv_batch;
+
     tmp = self->on_read_cb;
     Py_INCREF(callback);
     self->on_read_cb = callback;
     Py_XDECREF(tmp);
 
+    HANDLE(self)->read_buffer_size = buffer_size ? pyuv__buffer_pool_round((size_t)buffer_size) : 0;
+    if (zerocopy == Py_True) {
+        HANDLE(self)->flags |= PYUV__READ_ZEROCOPY;
+    } else {
+        HANDLE(self)->flags &= ~PYUV__READ_ZEROCOPY;
+    }
+
     PYUV_HANDLE_INCREF(self);
 
     Py_RETURN_NONE;
@@ -198,6 +882,8 @@ UDP_func_stop_recv(UDP *self)
 
     Py_XDECREF(self->on_read_cb);
     self->on_read_cb = NULL;
+    pyuv__udp_batch_free(self->recv_batch);
+    self->recv_batch = NULL;
 
     PYUV_HANDLE_DECREF(self);
 
@@ -234,6 +920,7 @@ UDP_func_try_send(UDP *self, PyObject *args)
         PyBuffer_Release(&view);
         return NULL;
     }
+    pyuv__handle_stats_written(HANDLE(self), (size_t)err);
 
     PyBuffer_Release(&view);
     return PyInt_FromLong((long)err);
@@ -248,9 +935,8 @@ pyuv__udp_send_bytes(UDP *self, struct sockaddr *addr, PyObject *data, PyObject
     udp_send_ctx *ctx;
     Py_buffer *view;
 
-    ctx = PyMem_Malloc(sizeof *ctx);
+    ctx = pyuv__request_pool_alloc(HANDLE(self)->loop, PYUV_REQUEST_POOL_UDP_SEND, sizeof *ctx);
     if (!ctx) {
-        PyErr_NoMemory();
         return NULL;
     }
 
@@ -258,7 +944,7 @@ pyuv__udp_send_bytes(UDP *self, struct sockaddr *addr, PyObject *data, PyObject
     view = &ctx->views[0];
 
     if (PyObject_GetBuffer(data, view, PyBUF_SIMPLE) != 0) {
-        PyMem_Free(ctx);
+        pyuv__request_pool_free(HANDLE(self)->loop, PYUV_REQUEST_POOL_UDP_SEND, ctx);
         return NULL;
     }
 
@@ -274,13 +960,14 @@ pyuv__udp_send_bytes(UDP *self, struct sockaddr *addr, PyObject *data, PyObject
         RAISE_UV_EXCEPTION(err, PyExc_UDPError);
         Py_DECREF(callback);
         PyBuffer_Release(view);
-        PyMem_Free(ctx);
+        pyuv__request_pool_free(HANDLE(self)->loop, PYUV_REQUEST_POOL_UDP_SEND, ctx);
         return NULL;
     }
 
     /* Increase refcount so that object is not removed before the callback is called */
     Py_INCREF(self);
 
+    pyuv__handle_stats_queued(HANDLE(self), self->udp_h.send_queue_size);
     Py_RETURN_NONE;
 }
 
@@ -310,9 +997,8 @@ pyuv__udp_send_sequence(UDP *self, struct sockaddr *addr, PyObject *data, PyObje
         return NULL;
     }
 
-    ctx = PyMem_Malloc(sizeof *ctx);
+    ctx = pyuv__request_pool_alloc(HANDLE(self)->loop, PYUV_REQUEST_POOL_UDP_SEND, sizeof *ctx);
     if (!ctx) {
-        PyErr_NoMemory();
         Py_DECREF(data_fast);
         return NULL;
     }
@@ -322,7 +1008,7 @@ pyuv__udp_send_sequence(UDP *self, struct sockaddr *addr, PyObject *data, PyObje
         ctx->views = PyMem_Malloc(sizeof(Py_buffer) * buf_count);
     if (!ctx->views) {
         PyErr_NoMemory();
-        PyMem_Free(ctx);
+        pyuv__request_pool_free(HANDLE(self)->loop, PYUV_REQUEST_POOL_UDP_SEND, ctx);
         Py_DECREF(data_fast);
         return NULL;
     }
@@ -354,6 +1040,7 @@ pyuv__udp_send_sequence(UDP *self, struct sockaddr *addr, PyObject *data, PyObje
     /* Increase refcount so that object is not removed before the callback is called */
     Py_INCREF(self);
 
+    pyuv__handle_stats_queued(HANDLE(self), self->udp_h.send_queue_size);
     Py_RETURN_NONE;
 
 error:
@@ -361,7 +1048,7 @@ error:
         PyBuffer_Release(&ctx->views[j]);
     if (ctx->views != ctx->viewsml)
         PyMem_Free(ctx->views);
-    PyMem_Free(ctx);
+    pyuv__request_pool_free(HANDLE(self)->loop, PYUV_REQUEST_POOL_UDP_SEND, ctx);
     Py_XDECREF(data_fast);
     return NULL;
 }
@@ -453,6 +1140,117 @@ UDP_func_set_multicast_interface(UDP *self, PyObject *args)
 }
 
 
+static PyObject *
+UDP_func_send_many(UDP *self, PyObject *args)
+{
+    int i, err, count, sent;
+    uv_buf_t buf;
+    udp_send_many_ctx *ctx;
+    PyObject *packets, *packets_fast, *item, *callback;
+
+    RAISE_IF_HANDLE_NOT_INITIALIZED(self, NULL);
+    RAISE_IF_HANDLE_CLOSED(self, PyExc_HandleClosedError, NULL);
+
+    callback = Py_None;
+
+    if (!PyArg_ParseTuple(args, "O|O:send_many", &packets, &callback)) {
+        return NULL;
+    }
+
+    if (callback != Py_None && !PyCallable_Check(callback)) {
+        PyErr_SetString(PyExc_TypeError, "'callback' must be a callable or None");
+        return NULL;
+    }
+
+    packets_fast = PySequence_Fast(packets, "packets must be an iterable");
+    if (packets_fast == NULL)
+        return NULL;
+
+    if (PySequence_Fast_GET_SIZE(packets_fast) > INT_MAX) {
+        PyErr_SetString(PyExc_ValueError, "iterable is too long");
+        Py_DECREF(packets_fast);
+        return NULL;
+    }
+
+    count = (int)PySequence_Fast_GET_SIZE(packets_fast);
+    if (count == 0) {
+        PyErr_SetString(PyExc_ValueError, "iterable is empty");
+        Py_DECREF(packets_fast);
+        return NULL;
+    }
+
+    ctx = pyuv__udp_send_many_ctx_new(count);
+    if (ctx == NULL) {
+        Py_DECREF(packets_fast);
+        return NULL;
+    }
+
+    for (i = 0; i < count; i++) {
+        item = PySequence_Fast_GET_ITEM(packets_fast, i);
+        if (!PyTuple_Check(item) || PyTuple_GET_SIZE(item) != 2) {
+            PyErr_SetString(PyExc_TypeError, "packets must be (address, data) tuples");
+            goto error;
+        }
+        if (pyuv_parse_addr_tuple(PyTuple_GET_ITEM(item, 0), &ctx->addrs[i]) < 0) {
+            /* Error is set by the function itself */
+            goto error;
+        }
+        if (PyObject_GetBuffer(PyTuple_GET_ITEM(item, 1), &ctx->views[i], PyBUF_SIMPLE) != 0) {
+            goto error;
+        }
+        ctx->count++;
+    }
+
+    Py_CLEAR(packets_fast);
+
+    sent = 0;
+#ifdef PYUV_HAVE_SENDMMSG
+    /* Datagrams can only go out right away if nothing is queued. The last one is always sent by libuv,
+     * so the callback is called from the loop once everything has been sent. */
+    if (self->udp_h.send_queue_count == 0) {
+        sent = pyuv__udp_send_many_sendmmsg(self, ctx, count - 1);
+    }
+#endif
+
+    for (i = sent; i < count; i++) {
+        buf = uv_buf_init(ctx->views[i].buf, ctx->views[i].len);
+        ctx->reqs[i].data = ctx;
+        err = uv_udp_send(&ctx->reqs[i], &self->udp_h, &buf, 1, (struct sockaddr *)&ctx->addrs[i], (uv_udp_send_cb)pyuv__udp_send_many_cb);
+        if (err < 0) {
+            if (sent == 0 && ctx->pending == 0) {
+                RAISE_UV_EXCEPTION(err, PyExc_UDPError);
+                goto error;
+            }
+            /* Some datagrams were sent or are on their way, report the error in the callback */
+            ctx->error = err;
+            break;
+        }
+        ctx->pending++;
+    }
+
+    ctx->obj = self;
+    ctx->callback = callback;
+    Py_INCREF(callback);
+
+    /* Increase refcount so that object is not removed before the callback is called */
+    Py_INCREF(self);
+
+    pyuv__handle_stats_queued(HANDLE(self), self->udp_h.send_queue_size);
+
+    /* Only sendmmsg got datagrams out, there is no request left to complete */
+    if (ctx->pending == 0) {
+        pyuv__udp_send_many_done(ctx);
+    }
+
+    Py_RETURN_NONE;
+
+error:
+    pyuv__udp_send_many_ctx_free(ctx);
+    Py_XDECREF(packets_fast);
+    return NULL;
+}
+
+
 static PyObject *
 UDP_func_getsockname(UDP *self)
 {
@@ -679,6 +1477,60 @@ UDP_sndbuf_set(UDP *self, PyObject *value, void *closure)
 }
 
 
+static PyObject *
+UDP_gso_segment_size_get(UDP *self, void *closure)
+{
+    int err;
+    int segment_size;
+
+    UNUSED_ARG(closure);
+    RAISE_IF_HANDLE_NOT_INITIALIZED(self, NULL);
+
+    segment_size = 0;
+    err = pyuv__udp_offload_option(self, PYUV_UDP_SEGMENT, &segment_size, 0);
+    if (err < 0) {
+        RAISE_UV_EXCEPTION(err, PyExc_UDPError);
+        return NULL;
+    }
+    return PyInt_FromLong((long) segment_size);
+}
+
+
+static int
+UDP_gso_segment_size_set(UDP *self, PyObject *value, void *closure)
+{
+    int err;
+    long segment_size;
+    int option_value;
+
+    UNUSED_ARG(closure);
+    RAISE_IF_HANDLE_NOT_INITIALIZED(self, -1);
+
+    if (!value) {
+        PyErr_SetString(PyExc_TypeError, "cannot delete attribute");
+        return -1;
+    }
+
+    segment_size = PyInt_AsLong(value);
+    if (segment_size == -1 && PyErr_Occurred()) {
+        return -1;
+    }
+
+    if (segment_size < 0 || segment_size > 65535) {
+        PyErr_SetString(PyExc_ValueError, "segment size must be between 0 and 65535");
+        return -1;
+    }
+
+    option_value = (int) segment_size;
+    err = pyuv__udp_offload_option(self, PYUV_UDP_SEGMENT, &option_value, 1);
+    if (err < 0) {
+        RAISE_UV_EXCEPTION(err, PyExc_UDPError);
+        return -1;
+    }
+    return 0;
+}
+
+
 static PyObject *
 UDP_rcvbuf_get(UDP *self, void *closure)
 {
@@ -795,6 +1647,8 @@ static int
 UDP_tp_clear(UDP *self)
 {
     Py_CLEAR(self->on_read_cb);
+    pyuv__udp_batch_free(self->recv_batch);
+    self->recv_batch = NULL;
     return HandleType.tp_clear((PyObject *)self);
 }
 
@@ -802,10 +1656,11 @@ UDP_tp_clear(UDP *self)
 static PyMethodDef
 UDP_tp_methods[] = {
     { "bind", (PyCFunction)UDP_func_bind, METH_VARARGS, "Bind to the specified IP and port." },
-    { "start_recv", (PyCFunction)UDP_func_start_recv, METH_VARARGS, "Start accepting data." },
+    { "start_recv", (PyCFunction)UDP_func_start_recv, METH_VARARGS|METH_KEYWORDS, "Start accepting data." },
     { "stop_recv", (PyCFunction)UDP_func_stop_recv, METH_NOARGS, "Stop receiving data." },
     { "try_send", (PyCFunction)UDP_func_try_send, METH_VARARGS, "Try to send data over UDP." },
     { "send", (PyCFunction)UDP_func_send, METH_VARARGS, "Send data over UDP." },
+    { "send_many", (PyCFunction)UDP_func_send_many, METH_VARARGS, "Send several datagrams, possibly to different destinations, over UDP." },
     { "getsockname", (PyCFunction)UDP_func_getsockname, METH_NOARGS, "Get local socket information." },
     { "open", (PyCFunction)UDP_func_open, METH_VARARGS, "Open the specified file descriptor and manage it as a UDP handle." },
     { "set_membership", (PyCFunction)UDP_func_set_membership, METH_VARARGS, "Set membership for multicast address." },
@@ -824,6 +1679,7 @@ static PyGetSetDef UDP_tp_getsets[] = {
     {"send_buffer_size", (getter)UDP_sndbuf_get, (setter)UDP_sndbuf_set, "Send buffer size.", NULL},
     {"receive_buffer_size", (getter)UDP_rcvbuf_get, (setter)UDP_rcvbuf_set, "Receive buffer size.", NULL},
     {"send_queue_size", (getter)UDP_send_queue_size_get, 0, "Returns the size of the send queue.", NULL},
+    {"gso_segment_size", (getter)UDP_gso_segment_size_get, (setter)UDP_gso_segment_size_set, "Segment size used to split sent data (UDP_SEGMENT), 0 if disabled.", NULL},
     {NULL}
 };
 
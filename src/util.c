@@ -305,7 +305,7 @@ pyuv__drain_poll_fd(uv_os_sock_t fd)
 static void
 pyuv__check_signals(uv_poll_t *handle, int status, int events)
 {
-    PyGILState_STATE gstate = PyGILState_Ensure();
+    gil_state gstate = pyuv__gil_ensure(handle->loop);
     SignalChecker *self;
 
     ASSERT(handle);
@@ -329,7 +329,7 @@ pyuv__check_signals(uv_poll_t *handle, int status, int events)
 
     Py_DECREF(self);
 
-    PyGILState_Release(gstate);
+    pyuv__gil_release(gstate);
 }
 
 
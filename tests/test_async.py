@@ -63,5 +63,53 @@ class AsyncTest(TestCase):
         self.assertEqual(self.check_cb_called, 1)
 
 
+class AsyncQueueTest(TestCase):
+
+    def test_async_queue(self):
+        self.items = []
+        def queue_cb(handle, items):
+            self.items.extend(items)
+            if len(self.items) == 4 * 1000:
+                handle.close()
+        def producer(n):
+            for i in range(1000):
+                if i % 2:
+                    self.queue.put((n, i))
+                else:
+                    self.queue.put_bytes(b'%d:%d' % (n, i))
+        self.queue = pyuv.AsyncQueue(self.loop, queue_cb)
+        threads = [threading.Thread(target=producer, args=(n,)) for n in range(4)]
+        for t in threads:
+            t.start()
+        self.loop.run()
+        for t in threads:
+            t.join()
+        self.assertEqual(len(self.items), 4000)
+        # items put by a thread are delivered in order
+        for n in range(4):
+            expected = [(n, i) if i % 2 else b'%d:%d' % (n, i) for i in range(1000)]
+            received = [item for item in self.items if (item[0] == n if isinstance(item, tuple) else item.startswith(b'%d:' % n))]
+            self.assertEqual(received, expected)
+
+    def test_async_queue_batch(self):
+        self.batches = []
+        def queue_cb(handle, items):
+            self.batches.append(items)
+            handle.close()
+        queue = pyuv.AsyncQueue(self.loop, queue_cb)
+        data = b'x' * 100000
+        queue.put(1)
+        queue.put_bytes(data)
+        queue.put_bytes(bytearray(b'abc'))
+        self.loop.run()
+        self.assertEqual(self.batches, [[1, data, b'abc']])
+
+    def test_async_queue_closed(self):
+        queue = pyuv.AsyncQueue(self.loop, lambda handle, items: None)
+        queue.close()
+        self.assertRaises(pyuv.error.HandleClosedError, queue.put, 1)
+        self.loop.run()
+
+
 if __name__ == '__main__':
     unittest.main(verbosity=2)
@@ -4,7 +4,7 @@ import shutil
 import stat
 import unittest
 
-from common import TestCase
+from common import platform_skip, TestCase
 import pyuv
 
 
@@ -531,6 +531,74 @@ class FSTestRead(FileTestCase):
         self.assertEqual(data, b'1234')
 
 
+class FSTestReadinto(FileTestCase):
+
+    TEST_FILE_CONTENT = 'test1234567890'
+
+    def read_cb(self, req):
+        self.errorno = req.error
+        self.nread = req.result
+        pyuv.fs.close(self.loop, self.fd)
+
+    def test_readinto(self):
+        self.nread = None
+        self.errorno = None
+        buf = bytearray(4)
+        self.fd = pyuv.fs.open(self.loop, TEST_FILE, os.O_RDONLY, stat.S_IREAD)
+        pyuv.fs.readinto(self.loop, self.fd, buf, -1, self.read_cb)
+        self.loop.run()
+        self.assertEqual(self.errorno, None)
+        self.assertEqual(self.nread, 4)
+        self.assertEqual(buf, b'test')
+
+    def test_readinto_sync(self):
+        buf = bytearray(8)
+        fd = pyuv.fs.open(self.loop, TEST_FILE, os.O_RDONLY, stat.S_IREAD)
+        nread = pyuv.fs.readinto(self.loop, fd, memoryview(buf)[4:], 4)
+        pyuv.fs.close(self.loop, fd)
+        self.assertEqual(nread, 4)
+        self.assertEqual(buf, b'\0' * 4 + b'1234')
+
+    def test_readinto_readonly(self):
+        fd = pyuv.fs.open(self.loop, TEST_FILE, os.O_RDONLY, stat.S_IREAD)
+        self.assertRaises((TypeError, BufferError), pyuv.fs.readinto, self.loop, fd, b'test', -1)
+        pyuv.fs.close(self.loop, fd)
+
+    def test_readinto_error(self):
+        self.nread = None
+        self.errorno = None
+        buf = bytearray(4)
+        self.fd = pyuv.fs.open(self.loop, TEST_FILE, os.O_WRONLY, stat.S_IWRITE)
+        pyuv.fs.readinto(self.loop, self.fd, buf, -1, self.read_cb)
+        self.loop.run()
+        self.assertEqual(self.errorno, pyuv.errno.UV_EBADF)
+        self.assertEqual(self.nread, None)
+        # the buffer was released and can be resized again
+        buf.extend(b'x')
+
+    def test_readv(self):
+        self.nread = None
+        self.errorno = None
+        bufs = [bytearray(4), bytearray(3), bytearray(16)]
+        self.fd = pyuv.fs.open(self.loop, TEST_FILE, os.O_RDONLY, stat.S_IREAD)
+        pyuv.fs.readv(self.loop, self.fd, bufs, 0, self.read_cb)
+        self.loop.run()
+        self.assertEqual(self.errorno, None)
+        self.assertEqual(self.nread, 14)
+        self.assertEqual(bufs[0], b'test')
+        self.assertEqual(bufs[1], b'123')
+        self.assertEqual(bufs[2][:7], b'4567890')
+
+    def test_readv_sync(self):
+        bufs = [bytearray(2), bytearray(2)]
+        fd = pyuv.fs.open(self.loop, TEST_FILE, os.O_RDONLY, stat.S_IREAD)
+        nread = pyuv.fs.readv(self.loop, fd, bufs, 4)
+        pyuv.fs.close(self.loop, fd)
+        self.assertEqual(nread, 4)
+        self.assertEqual(bufs, [b'12', b'34'])
+        self.assertRaises(ValueError, pyuv.fs.readv, self.loop, fd, [], 0)
+
+
 class FSTestWrite(TestCase):
 
     def setUp(self):
@@ -581,6 +649,29 @@ class FSTestWrite(TestCase):
             fobj.seek(offset)
             self.assertEqual(fobj.read(), "TEST")
 
+    def test_write_sequence(self):
+        self.bytes_written = None
+        self.errorno = None
+        pyuv.fs.write(self.loop, self.fd, [b"HEAD", bytearray(b"payload"), memoryview(b"TAIL")], -1, self.write_cb)
+        self.loop.run()
+        self.assertEqual(self.bytes_written, 15)
+        self.assertEqual(self.errorno, None)
+        with open(TEST_FILE, 'r') as fobj:
+            self.assertEqual(fobj.read(), "HEADpayloadTAIL")
+
+    def test_write_sequence_sync(self):
+        self.bytes_written = pyuv.fs.write(self.loop, self.fd, (b"TE", b"ST"), 2)
+        pyuv.fs.close(self.loop, self.fd)
+        self.assertEqual(self.bytes_written, 4)
+        with open(TEST_FILE, 'rb') as fobj:
+            self.assertEqual(fobj.read(), b"\0\0TEST")
+
+    def test_write_invalid(self):
+        self.assertRaises(ValueError, pyuv.fs.write, self.loop, self.fd, [], -1)
+        self.assertRaises(TypeError, pyuv.fs.write, self.loop, self.fd, [b"TEST", 1], -1)
+        self.assertRaises(TypeError, pyuv.fs.write, self.loop, self.fd, 1, -1)
+        pyuv.fs.close(self.loop, self.fd)
+
 
 class FSTestFsync(TestCase):
 
@@ -700,6 +791,172 @@ class FSTestScandir(TestCase):
             self.errorno = None
         self.assertEqual(self.errorno, pyuv.errno.UV_ENOENT)
 
+    def scandir_chunks_cb(self, entries, error):
+        if entries is None:
+            self.errorno = error
+            self.done = True
+        else:
+            self.assertFalse(self.done)
+            self.chunks.append(entries)
+        return self.keep_going
+
+    def do_scandir_chunks(self, path, keep_going=None, **kwargs):
+        self.chunks = []
+        self.errorno = None
+        self.done = False
+        self.keep_going = keep_going
+        pyuv.fs.scandir_chunks(self.loop, path, self.scandir_chunks_cb, **kwargs)
+        self.loop.run()
+
+    def test_scandir_chunks(self):
+        self.do_scandir_chunks(TEST_DIR, chunk_size=2)
+        self.assertTrue(self.done)
+        self.assertEqual(self.errorno, None)
+        self.assertEqual([len(c) for c in self.chunks], [2, 1])
+        files = dict((f.name, f.type) for c in self.chunks for f in c)
+        self.assertEqual(sorted(files), sorted([TEST_FILE, TEST_FILE2, TEST_DIR2]))
+        self.assertEqual(files[TEST_FILE], pyuv.fs.UV_DIRENT_FILE)
+        self.assertEqual(files[TEST_DIR2], pyuv.fs.UV_DIRENT_DIR)
+
+    def test_scandir_chunks_stop(self):
+        self.do_scandir_chunks(TEST_DIR, keep_going=False, chunk_size=1)
+        self.assertEqual(len(self.chunks), 1)
+        self.assertFalse(self.done)
+
+    def test_scandir_chunks_error(self):
+        self.do_scandir_chunks(BAD_DIR)
+        self.assertTrue(self.done)
+        self.assertEqual(self.chunks, [])
+        self.assertEqual(self.errorno, pyuv.errno.UV_ENOENT)
+        self.assertRaises(ValueError, pyuv.fs.scandir_chunks, self.loop, TEST_DIR, self.scandir_chunks_cb, 0)
+
+
+class FSTestBatch(FileTestCase):
+
+    TEST_FILE_CONTENT = 'test1234567890'
+
+    def tearDown(self):
+        try:
+            os.rmdir(TEST_DIR)
+        except OSError:
+            pass
+        super(FSTestBatch, self).tearDown()
+
+    def batch_cb(self, results):
+        self.results = results
+
+    def test_batch(self):
+        self.results = None
+        ops = [("stat", TEST_FILE),
+               ("stat", BAD_FILE),
+               ("lstat", TEST_FILE),
+               ("mkdir", TEST_DIR, 0o755),
+               ("access", TEST_DIR, os.R_OK),
+               ("rmdir", TEST_DIR),
+               ("open", TEST_FILE, os.O_RDONLY, 0)]
+        pyuv.fs.batch(self.loop, ops, self.batch_cb)
+        self.loop.run()
+        self.assertEqual(len(self.results), len(ops))
+        self.assertEqual(self.results[0][0].st_size, 14)
+        self.assertEqual(self.results[0][1], None)
+        self.assertEqual(self.results[1], (None, pyuv.errno.UV_ENOENT))
+        self.assertEqual(self.results[2][0].st_size, 14)
+        self.assertEqual(self.results[3:6], [(None, None)] * 3)
+        self.assertFalse(os.path.exists(TEST_DIR))
+        fd, error = self.results[6]
+        self.assertEqual(error, None)
+        results = pyuv.fs.batch(self.loop, [("read", fd, 4, 4), ("fstat", fd), ("close", fd)])
+        self.assertEqual(results[0], (b"1234", None))
+        self.assertEqual(results[1][0].st_size, 14)
+        self.assertEqual(results[2], (None, None))
+
+    def test_batch_mutated(self):
+        self.results = None
+        ops = [("stat", os.path.join(".", TEST_FILE)) for i in range(1000)]
+        pyuv.fs.batch(self.loop, ops, self.batch_cb)
+        # the batch works on its own copy of the operations
+        del ops[:]
+        self.loop.run()
+        self.assertEqual(len(self.results), 1000)
+        self.assertTrue(all(error is None for result, error in self.results))
+
+    def test_batch_empty(self):
+        self.assertEqual(pyuv.fs.batch(self.loop, []), [])
+
+    def test_batch_invalid(self):
+        self.assertRaises(ValueError, pyuv.fs.batch, self.loop, [("stat", TEST_FILE), ("frobnicate", TEST_FILE)])
+        self.assertRaises(TypeError, pyuv.fs.batch, self.loop, [("stat", 1)])
+        self.assertRaises(TypeError, pyuv.fs.batch, self.loop, ["stat"])
+        self.assertRaises(TypeError, pyuv.fs.batch, self.loop, [("read", 0, 4, 0)], 1)
+
+
+class FSTestWalk(TestCase):
+
+    def setUp(self):
+        super(FSTestWalk, self).setUp()
+        os.makedirs(os.path.join(TEST_DIR, 'a', 'b'))
+        os.mkdir(os.path.join(TEST_DIR, 'c'))
+        for path in ('f1', 'a/f2', 'a/b/f3'):
+            with open(os.path.join(TEST_DIR, path), 'w') as f:
+                f.write('test')
+
+    def tearDown(self):
+        shutil.rmtree(TEST_DIR)
+        super(FSTestWalk, self).tearDown()
+
+    def walk_cb(self, entries, error):
+        if entries is None:
+            self.errors.append(error)
+        else:
+            self.entries.extend(entries)
+
+    def walk(self, root=TEST_DIR, **kwargs):
+        self.entries = []
+        self.errors = []
+        pyuv.fs.walk(self.loop, root, self.walk_cb, **kwargs)
+        self.loop.run()
+        return dict((os.path.relpath(e.path, TEST_DIR), e) for e in self.entries)
+
+    def test_walk(self):
+        entries = self.walk()
+        self.assertEqual(self.errors, [None])
+        self.assertEqual(sorted(entries), ['a', os.path.join('a', 'b'), os.path.join('a', 'b', 'f3'), os.path.join('a', 'f2'), 'c', 'f1'])
+        self.assertEqual(entries['a'].type, pyuv.fs.UV_DIRENT_DIR)
+        self.assertEqual(entries['f1'].type, pyuv.fs.UV_DIRENT_FILE)
+        self.assertTrue(all(e.stat is None for e in entries.values()))
+
+    def test_walk_max_depth(self):
+        self.assertEqual(sorted(self.walk(max_depth=0)), ['a', 'c', 'f1'])
+        self.assertEqual(len(self.walk(max_depth=1)), 5)
+        self.assertRaises(ValueError, pyuv.fs.walk, self.loop, TEST_DIR, self.walk_cb, max_depth=-1)
+
+    def test_walk_stat(self):
+        entries = self.walk(stat=True)
+        self.assertEqual(entries[os.path.join('a', 'f2')].stat.st_size, 4)
+        self.assertTrue(stat.S_ISDIR(entries['c'].stat.st_mode))
+
+    @platform_skip(["win32"])
+    def test_walk_symlinks(self):
+        os.symlink(os.path.abspath(TEST_DIR), os.path.join(TEST_DIR, 'c', 'link'))
+        entries = self.walk()
+        self.assertEqual(entries[os.path.join('c', 'link')].type, pyuv.fs.UV_DIRENT_LINK)
+        self.assertEqual(len(entries), 7)
+        entries = self.walk(follow_symlinks=True)
+        # the link points back to the root, which isn't walked again
+        self.assertEqual(entries[os.path.join('c', 'link')].type, pyuv.fs.UV_DIRENT_DIR)
+        self.assertEqual(len(entries), 7)
+
+    def test_walk_many_dirs(self):
+        for i in range(50):
+            os.makedirs(os.path.join(TEST_DIR, 'c', 'd%d' % i, 'e'))
+        entries = self.walk()
+        self.assertEqual(self.errors, [None])
+        self.assertEqual(len(entries), 6 + 100)
+
+    def test_walk_error(self):
+        self.assertEqual(self.walk(BAD_DIR), {})
+        self.assertEqual(self.errors, [pyuv.errno.UV_ENOENT])
+
 
 class FSTestSendfile(TestCase):
 
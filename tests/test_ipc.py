@@ -140,5 +140,48 @@ class IPCSendRecvTest(TestCase):
         self._do_test()
 
 
+@platform_skip(["win32"])
+class IPCSendHandlesTest(TestCase):
+
+    def on_channel_read(self, handle, data, error):
+        self.assertEqual(error, None)
+        self.assertEqual(data, b".")
+        self.assertEqual(handle.pending_count(), 3)
+        while handle.pending_count():
+            self.assertEqual(handle.pending_handle_type(), pyuv.UV_UDP)
+            recv_handle = pyuv.UDP(self.loop)
+            handle.accept(recv_handle)
+            self.received.append(recv_handle.getsockname())
+            recv_handle.close()
+        self.assertEqual(handle.pending_handle_type(), pyuv.UV_UNKNOWN_HANDLE)
+        handle.close()
+
+    def test_ipc_send_handles(self):
+        import socket
+        self.received = []
+        a, b = socket.socketpair(socket.AF_UNIX, socket.SOCK_STREAM)
+        sender = pyuv.Pipe(self.loop, True)
+        sender.open(os.dup(a.fileno()))
+        receiver = pyuv.Pipe(self.loop, True)
+        receiver.open(os.dup(b.fileno()))
+        a.close()
+        b.close()
+        handles = []
+        for i in range(3):
+            handle = pyuv.UDP(self.loop)
+            handle.bind(("127.0.0.1", 0))
+            handles.append(handle)
+        self.assertEqual(sender.try_send_handles(b".", handles), 1)
+        self.assertRaises(ValueError, sender.try_send_handles, b".", [])
+        self.assertRaises(TypeError, sender.try_send_handles, b".", [sender.loop])
+        addresses = [handle.getsockname() for handle in handles]
+        for handle in handles:
+            handle.close()
+        receiver.start_read(self.on_channel_read)
+        sender.close()
+        self.loop.run()
+        self.assertEqual(self.received, addresses)
+
+
 if __name__ == '__main__':
     unittest.main(verbosity=2)
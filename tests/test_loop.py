@@ -1,7 +1,12 @@
 
+import os
+import platform
+import sys
+import threading
+import time
 import unittest
 
-from common import TestCase
+from common import platform_only, TestCase
 import pyuv
 
 
@@ -28,6 +33,66 @@ class LoopRunTest(TestCase):
         self.loop.run(pyuv.UV_RUN_NOWAIT)
         self.assertEqual(self.cb_called, 0)
 
+    def test_run_threads(self):
+        self.thread_ticks = 0
+        self.cb_called = 0
+        done = threading.Event()
+        def thread_func():
+            while not done.is_set():
+                self.thread_ticks += 1
+        def timer_cb(handle):
+            self.cb_called += 1
+            if self.cb_called == 5:
+                handle.close()
+        t = threading.Thread(target=thread_func)
+        t.start()
+        timer = pyuv.Timer(self.loop)
+        timer.start(timer_cb, 0.01, 0.01)
+        self.loop.run()
+        done.set()
+        t.join()
+        self.assertEqual(self.cb_called, 5)
+        self.assertTrue(self.thread_ticks > 0)
+
+    def test_run_hold_gil(self):
+        self.work_called = 0
+        self.done_called = 0
+        self.cb_called = 0
+        def work():
+            self.work_called += 1
+        def done(error):
+            self.assertEqual(error, None)
+            self.done_called += 1
+        def timer_cb(handle):
+            self.cb_called += 1
+            if self.cb_called == 5:
+                handle.close()
+            else:
+                self.loop.queue_work(work, done)
+        timer = pyuv.Timer(self.loop)
+        timer.start(timer_cb, 0.01, 0.01)
+        self.loop.run(hold_gil=True)
+        self.assertEqual(self.cb_called, 5)
+        self.assertEqual(self.work_called, 4)
+        self.assertEqual(self.done_called, 4)
+
+    def test_run_nested(self):
+        self.cb_called = 0
+        loop2 = pyuv.Loop()
+        def inner_cb(handle):
+            handle.close()
+            self.cb_called += 1
+        def outer_cb(handle):
+            handle.close()
+            timer = pyuv.Timer(loop2)
+            timer.start(inner_cb, 0, 0)
+            loop2.run()
+            self.cb_called += 1
+        timer = pyuv.Timer(self.loop)
+        timer.start(outer_cb, 0, 0)
+        self.loop.run()
+        self.assertEqual(self.cb_called, 2)
+
     def test_stop(self):
         self.num_ticks = 10
         self.prepare_called = 0
@@ -67,5 +132,135 @@ class LoopAliveTest(TestCase):
         self.loop.run(pyuv.UV_RUN_ONCE)
 
 
+class LoopBufferPoolTest(TestCase):
+
+    def test_buffer_pool_defaults(self):
+        self.assertEqual(self.loop.buffer_pool_chunk_size, 65536)
+        self.assertEqual(self.loop.buffer_pool_max_free, 16)
+
+    def test_buffer_pool_chunk_size(self):
+        self.loop.buffer_pool_chunk_size = 3000
+        self.assertEqual(self.loop.buffer_pool_chunk_size, 4096)
+        self.loop.buffer_pool_chunk_size = 1
+        self.assertEqual(self.loop.buffer_pool_chunk_size, 1024)
+        with self.assertRaises(ValueError):
+            self.loop.buffer_pool_chunk_size = 0
+        with self.assertRaises(ValueError):
+            self.loop.buffer_pool_chunk_size = 1024*1024 + 1
+
+    def test_buffer_pool_max_free(self):
+        self.loop.buffer_pool_max_free = 0
+        self.assertEqual(self.loop.buffer_pool_max_free, 0)
+        with self.assertRaises(ValueError):
+            self.loop.buffer_pool_max_free = -1
+
+
+class LoopMetricsTest(TestCase):
+
+    def run_loop(self):
+        self.timer_called = 0
+        self.async_called = 0
+        def async_cb(handle):
+            self.async_called += 1
+            handle.close()
+        def timer_cb(handle):
+            self.timer_called += 1
+            if self.timer_called == 5:
+                handle.close()
+                async_handle.send()
+        async_handle = pyuv.Async(self.loop, async_cb)
+        timer = pyuv.Timer(self.loop)
+        timer.start(timer_cb, 0.001, 0.001)
+        self.loop.run()
+
+    def test_metrics_disabled(self):
+        self.assertFalse(self.loop.metrics_enabled)
+        self.run_loop()
+        metrics = self.loop.metrics
+        self.assertEqual(metrics.iterations, 0)
+        self.assertEqual(metrics.callbacks, 0)
+
+    def test_metrics(self):
+        self.loop.metrics_enabled = True
+        self.run_loop()
+        metrics = self.loop.metrics
+        # 5 timer callbacks, 1 async callback and 2 close callbacks
+        self.assertEqual(metrics.callbacks, 8)
+        self.assertEqual(sum(metrics.latency_histogram), metrics.callbacks)
+        self.assertTrue(metrics.callback_max_time <= metrics.callback_time)
+        self.loop.reset_metrics()
+        self.assertTrue(self.loop.metrics_enabled)
+        self.assertEqual(self.loop.metrics.callbacks, 0)
+
+    @platform_only(["linux"])
+    def test_metrics_phases(self):
+        self.loop.metrics_enabled = True
+        self.run_loop()
+        metrics = self.loop.metrics
+        self.assertTrue(metrics.iterations >= 5)
+        self.assertTrue(metrics.idle_time > 0)
+        self.assertTrue(metrics.timers_time > 0)
+        self.assertEqual(metrics.events, 1)
+        self.assertEqual(metrics.max_events, 1)
+
+
+class LoopSlowCallbackTest(TestCase):
+
+    def setUp(self):
+        super(LoopSlowCallbackTest, self).setUp()
+        self.slow_callbacks = []
+
+    def slow_callback_hook(self, obj, duration, callback):
+        self.slow_callbacks.append((obj, duration, callback))
+
+    def run_timer(self, delay):
+        def timer_cb(timer):
+            time.sleep(delay)
+            timer.close()
+        timer = pyuv.Timer(self.loop)
+        timer.start(timer_cb, 0.001, 0)
+        self.loop.run()
+        return timer, timer_cb
+
+    def test_slow_callback(self):
+        self.loop.set_slow_callback_hook(self.slow_callback_hook, 0.01)
+        timer, timer_cb = self.run_timer(0.05)
+        self.assertEqual(len(self.slow_callbacks), 1)
+        obj, duration, callback = self.slow_callbacks[0]
+        self.assertTrue(obj is timer)
+        self.assertTrue(duration >= 0.05)
+        self.assertTrue(callback is timer_cb)
+
+    def test_fast_callback(self):
+        self.loop.set_slow_callback_hook(self.slow_callback_hook, 1.0)
+        self.run_timer(0)
+        self.assertEqual(self.slow_callbacks, [])
+
+    def test_disable(self):
+        self.loop.set_slow_callback_hook(self.slow_callback_hook, 0.01)
+        self.loop.set_slow_callback_hook(None, 0)
+        self.run_timer(0.02)
+        self.assertEqual(self.slow_callbacks, [])
+
+    @platform_only(["linux"])
+    @unittest.skipUnless(platform.python_implementation() == 'CPython' and (3,) <= sys.version_info < (3, 8), "stack dumps need CPython 3 before 3.8")
+    def test_stack_dump(self):
+        rfd, wfd = os.pipe()
+        try:
+            self.loop.set_slow_callback_hook(None, 0.01, stack_fd=wfd)
+            self.run_timer(0.1)
+            self.loop.set_slow_callback_hook(None, 0)
+            data = os.read(rfd, 65536).decode()
+        finally:
+            os.close(rfd)
+            os.close(wfd)
+        self.assertTrue('callback running for more than' in data)
+        self.assertTrue('timer_cb' in data)
+
+    @unittest.skipIf(platform.python_implementation() == 'CPython' and (3,) <= sys.version_info < (3, 8), "stack dumps are supported")
+    def test_stack_dump_unsupported(self):
+        self.assertRaises(NotImplementedError, self.loop.set_slow_callback_hook, None, 0.01, 1)
+
+
 if __name__ == '__main__':
     unittest.main(verbosity=2)
@@ -7,6 +7,9 @@ from common import TestCase
 import pyuv
 
 
+TEST_PORT = 1234
+
+
 class HandlesTest(TestCase):
     handle_types = ('Check', 'Idle', 'Pipe', 'Prepare', 'TCP', 'Timer', 'UDP')
 
@@ -46,5 +49,67 @@ class HandlesTest(TestCase):
             self.assertEqual(ref(), None)
 
 
+class HandleStatsTest(TestCase):
+
+    def test_stats_disabled(self):
+        timer = pyuv.Timer(self.loop)
+        self.assertFalse(timer.stats_enabled)
+        self.assertEqual(timer.stats, None)
+        timer.stats_enabled = True
+        self.assertEqual(timer.stats.callbacks, 0)
+        timer.stats_enabled = False
+        self.assertEqual(timer.stats, None)
+        timer.close()
+        self.loop.run()
+
+    def test_timer_stats(self):
+        self.timer_called = 0
+        def timer_cb(handle):
+            self.timer_called += 1
+            if self.timer_called == 5:
+                handle.stop()
+        timer = pyuv.Timer(self.loop)
+        timer.stats_enabled = True
+        timer.start(timer_cb, 0.001, 0.001)
+        self.loop.run()
+        stats = timer.stats
+        self.assertEqual(stats.callbacks, 5)
+        self.assertTrue(stats.callback_max_time <= stats.callback_time)
+        self.assertEqual(stats.bytes_read, 0)
+        self.assertEqual(self.loop.handle_stats.callbacks, 5)
+        timer.close()
+        self.loop.run()
+
+    def test_tcp_stats(self):
+        self.loop.handle_stats_enabled = True
+        self.data = []
+        def on_read(handle, data, error):
+            if data is None:
+                handle.close()
+                self.server.close()
+            else:
+                self.data.append(data)
+        def on_connection(server, error):
+            conn = pyuv.TCP(self.loop)
+            server.accept(conn)
+            conn.start_read(on_read)
+            self.conn = conn
+        def on_connect(client, error):
+            client.write(b"PING"*1024)
+            client.write(b"PING"*1024)
+            client.close()
+        self.server = pyuv.TCP(self.loop)
+        self.server.bind(("0.0.0.0", TEST_PORT))
+        self.server.listen(on_connection)
+        client = pyuv.TCP(self.loop)
+        self.assertTrue(client.stats_enabled)
+        client.connect(("127.0.0.1", TEST_PORT), on_connect)
+        self.loop.run()
+        self.assertEqual(client.stats.bytes_written, 8192)
+        self.assertEqual(self.conn.stats.bytes_read, 8192)
+        self.assertEqual(self.conn.stats.callbacks, len(self.data) + 1)
+        self.assertEqual(self.server.stats.callbacks, 1)
+
+
 if __name__ == '__main__':
     unittest.main(verbosity=2)
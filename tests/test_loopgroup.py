@@ -0,0 +1,96 @@
+
+import socket
+import unittest
+
+from common import platform_only, TestCase
+import pyuv
+
+
+@platform_only(["linux"])
+class LoopGroupTest(TestCase):
+
+    def on_connection(self, server, error):
+        self.assertEqual(error, None)
+        client = pyuv.TCP(server.loop)
+        server.accept(client)
+        client.close()
+
+    def test_loopgroup(self):
+        setup_calls = []
+        group = pyuv.LoopGroup(2)
+        self.assertEqual(len(group.loops), 2)
+        address = group.listen(("127.0.0.1", 0), self.on_connection)
+        self.assertNotEqual(address[1], 0)
+        self.assertEqual([servers[0].getsockname() for servers in group.servers], [address, address])
+        group.start(lambda loop, index: setup_calls.append(index))
+        self.assertEqual(setup_calls, [0, 1])
+        self.assertTrue(group.running)
+        for i in range(8):
+            sock = socket.create_connection(address)
+            self.assertEqual(sock.recv(1), b"")
+            sock.close()
+        load = group.load()
+        self.assertEqual([l.index for l in load], [0, 1])
+        self.assertEqual(sum(l.connections for l in load), 8)
+        for l in load:
+            self.assertTrue(0.0 <= l.busy <= 1.0)
+        group.stop()
+        self.assertFalse(group.running)
+        for loop in group.loops:
+            self.assertTrue(all(h.closed for h in loop.handles))
+
+    def on_dispatched(self, worker, connection):
+        connection.write(b"x")
+        connection.close()
+        worker.release()
+
+    def on_client_read(self, client, data, error):
+        if data is not None:
+            self.received += data
+            return
+        client.close()
+        self.finished += 1
+        if self.finished == 8:
+            self.dispatcher.close()
+
+    def on_client_connect(self, client, error):
+        self.assertEqual(error, None)
+        client.start_read(self.on_client_read)
+
+    def _do_dispatch(self, policy):
+        self.received = b""
+        self.finished = 0
+        group = pyuv.LoopGroup(2)
+        self.dispatcher = group.dispatch(self.loop, ("127.0.0.1", 0), self.on_dispatched, policy)
+        address = self.dispatcher.server.getsockname()
+        group.start()
+        for i in range(8):
+            client = pyuv.TCP(self.loop)
+            client.connect(address, self.on_client_connect)
+        self.loop.run()
+        group.stop()
+        self.assertEqual(self.received, b"x" * 8)
+        self.assertEqual(sum(self.dispatcher.dispatched), 8)
+        self.assertEqual(sum(l.connections for l in group.load()), 8)
+        return self.dispatcher
+
+    def test_dispatch_round_robin(self):
+        dispatcher = self._do_dispatch("round-robin")
+        self.assertEqual(dispatcher.dispatched, [4, 4])
+
+    def test_dispatch_least_loaded(self):
+        dispatcher = self._do_dispatch("least-loaded")
+        self.assertTrue(all(count > 0 for count in dispatcher.dispatched))
+
+    def test_dispatch_policy(self):
+        server = pyuv.TCP(self.loop)
+        self.assertRaises(ValueError, pyuv.AcceptDispatcher, server, [], "random")
+        server.close()
+        self.loop.run()
+
+    def test_loopgroup_size(self):
+        self.assertRaises(ValueError, pyuv.LoopGroup, 0)
+
+
+if __name__ == '__main__':
+    unittest.main(verbosity=2)
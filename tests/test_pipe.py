@@ -1,4 +1,6 @@
 
+import os
+import socket
 import sys
 import unittest
 
@@ -282,6 +284,58 @@ class PipeTestFileno(TestCase):
         self.loop.run()
 
 
+@platform_only(["linux"])
+class PipeTestReadBatchSwitch(TestCase):
+
+    def open_pair(self):
+        a, b = socket.socketpair()
+        pipe = pyuv.Pipe(self.loop)
+        pipe.open(os.dup(a.fileno()))
+        a.close()
+        return pipe, b
+
+    def on_batch_read(self, pipe, data, error):
+        self.fail("data should be delivered to the read_into callback")
+
+    def on_trigger_read(self, trigger, data, error):
+        trigger.close()
+        # the batched stream was read first in this iteration and didn't deliver yet
+        self.assertEqual(self.stream.stats.bytes_read, 8192)
+        self.stream.stop_read()
+        self.stream.start_read_into(bytearray(3000), self.on_read_into)
+
+    def on_read_into(self, pipe, buffer, nread, error):
+        if error is not None:
+            pipe.close()
+            return
+        self.received.append(bytes(buffer[:nread]))
+        if sum(len(data) for data in self.received) == 8192:
+            pipe.close()
+            self.timeout.close()
+
+    def on_timeout(self, timer):
+        timer.close()
+        self.stream.close()
+
+    def test_batch_to_read_into(self):
+        self.received = []
+        self.stream, peer = self.open_pair()
+        trigger, trigger_peer = self.open_pair()
+        self.stream.stats_enabled = True
+        peer.sendall(b"x" * 4096 + b"y" * 4096)
+        trigger_peer.sendall(b"!")
+        self.stream.start_read(self.on_batch_read, buffer_size=1024, batch=1024*1024)
+        trigger.start_read(self.on_trigger_read)
+        self.timeout = pyuv.Timer(self.loop)
+        self.timeout.start(self.on_timeout, 5, 0)
+        self.loop.run()
+        peer.close()
+        trigger_peer.close()
+        self.assertEqual([len(data) for data in self.received], [1024, 1024, 1024, 1024, 1024, 1024, 1024, 1024])
+        self.assertEqual(b"".join(self.received), b"x" * 4096 + b"y" * 4096)
+        self.assertEqual(self.stream.stats.bytes_read, 8192)
+
+
 @platform_skip(["win32"])
 class PipeBytesBind(TestCase):
 
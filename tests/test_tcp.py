@@ -4,7 +4,7 @@ import os
 import socket
 import unittest
 
-from common import linesep, platform_skip, TestCase
+from common import linesep, platform_skip, platform_only, TestCase
 import pyuv
 
 
@@ -205,6 +205,352 @@ class TCPTestMemoryview(TestCase):
         self.loop.run()
 
 
+class TCPTestBufferSize(TestCase):
+
+    def setUp(self):
+        super(TCPTestBufferSize, self).setUp()
+        self.server = None
+        self.client = None
+        self.received = []
+
+    def on_connection(self, server, error):
+        self.assertEqual(error, None)
+        client = pyuv.TCP(self.loop)
+        server.accept(client)
+        client.write(b"x"*8192)
+        client.close()
+        server.close()
+
+    def on_client_connection(self, client, error):
+        self.assertEqual(error, None)
+        client.start_read(self.on_client_read, 1000)
+
+    def on_client_read(self, client, data, error):
+        if data is None:
+            client.close()
+            return
+        self.assertTrue(len(data) <= 1024)
+        self.received.append(data)
+
+    def test_tcp_buffer_size(self):
+        self.server = pyuv.TCP(self.loop)
+        self.server.bind(("0.0.0.0", TEST_PORT))
+        self.server.listen(self.on_connection)
+        self.client = pyuv.TCP(self.loop)
+        self.client.connect(("127.0.0.1", TEST_PORT), self.on_client_connection)
+        self.loop.run()
+        self.assertEqual(b"".join(self.received), b"x"*8192)
+
+    def test_tcp_buffer_size_invalid(self):
+        client = pyuv.TCP(self.loop)
+        self.assertRaises(ValueError, client.start_read, lambda *args: None, -1)
+        self.assertRaises(ValueError, client.start_read, lambda *args: None, 1024*1024*2)
+        client.close()
+        self.loop.run()
+
+
+class TCPTestZerocopy(TestCase):
+
+    def setUp(self):
+        super(TCPTestZerocopy, self).setUp()
+        self.server = None
+        self.client = None
+        self.buffers = []
+
+    def on_connection(self, server, error):
+        self.assertEqual(error, None)
+        client = pyuv.TCP(self.loop)
+        server.accept(client)
+        client.write(b"PING"+linesep)
+        client.close()
+        server.close()
+
+    def on_client_connection(self, client, error):
+        self.assertEqual(error, None)
+        client.start_read(self.on_client_read, zerocopy=True)
+
+    def on_client_read(self, client, data, error):
+        if data is None:
+            client.close()
+            return
+        self.assertTrue(isinstance(data, pyuv.Buffer))
+        self.assertEqual(len(data), len(b"PING"+linesep))
+        self.assertEqual(bytes(data), b"PING"+linesep)
+        self.buffers.append(data)
+
+    def test_tcp_zerocopy(self):
+        self.server = pyuv.TCP(self.loop)
+        self.server.bind(("0.0.0.0", TEST_PORT))
+        self.server.listen(self.on_connection)
+        self.client = pyuv.TCP(self.loop)
+        self.client.connect(("127.0.0.1", TEST_PORT), self.on_client_connection)
+        self.loop.run()
+        self.assertEqual(len(self.buffers), 1)
+        data = self.buffers[0]
+        view = memoryview(data)
+        self.assertRaises(BufferError, data.release)
+        view.release()
+        self.assertFalse(data.released)
+        data.release()
+        self.assertTrue(data.released)
+        self.assertEqual(len(data), 0)
+        self.assertRaises(ValueError, memoryview, data)
+
+
+class TCPTestReadInto(TestCase):
+
+    def setUp(self):
+        super(TCPTestReadInto, self).setUp()
+        self.server = None
+        self.client = None
+        self.received = []
+
+    def on_connection(self, server, error):
+        self.assertEqual(error, None)
+        client = pyuv.TCP(self.loop)
+        server.accept(client)
+        client.write(b"x"*4096)
+        client.close()
+        server.close()
+
+    def on_client_read(self, client, buffer, nread, error):
+        if error is not None:
+            self.assertEqual(nread, 0)
+            client.close()
+            return
+        self.received.append(bytes(buffer[:nread]))
+
+    def _run(self, buffer):
+        def on_client_connection(client, error):
+            self.assertEqual(error, None)
+            client.start_read_into(buffer, self.on_client_read)
+        self.server = pyuv.TCP(self.loop)
+        self.server.bind(("0.0.0.0", TEST_PORT))
+        self.server.listen(self.on_connection)
+        self.client = pyuv.TCP(self.loop)
+        self.client.connect(("127.0.0.1", TEST_PORT), on_client_connection)
+        self.loop.run()
+        self.assertEqual(b"".join(self.received), b"x"*4096)
+
+    def test_tcp_read_into_buffer(self):
+        buf = bytearray(100)
+        self._run(buf)
+        # the buffer is no longer locked once reading stopped
+        buf.extend(b"x")
+
+    def test_tcp_read_into_factory(self):
+        self.sizes = []
+        def factory(handle, suggested_size):
+            self.assertTrue(handle is self.client)
+            buf = bytearray(100)
+            self.sizes.append(len(buf))
+            return buf
+        self._run(factory)
+        self.assertTrue(len(self.sizes) >= 41)
+
+    def test_tcp_read_into_invalid(self):
+        client = pyuv.TCP(self.loop)
+        cb = lambda *args: None
+        self.assertRaises(TypeError, client.start_read_into, 42, cb)
+        self.assertRaises(ValueError, client.start_read_into, bytearray(), cb)
+        self.assertRaises(BufferError, client.start_read_into, b"readonly", cb)
+        client.close()
+        self.loop.run()
+
+
+class TCPTestRequestPool(TestCase):
+
+    def setUp(self):
+        super(TCPTestRequestPool, self).setUp()
+        self.server = None
+        self.client = None
+        self.write_cb_count = 0
+
+    def on_connection(self, server, error):
+        self.assertEqual(error, None)
+        client = pyuv.TCP(self.loop)
+        server.accept(client)
+        client.start_read(self.on_client_connection_read)
+
+    def on_client_connection_read(self, client, data, error):
+        if data is None:
+            client.close()
+            self.server.close()
+
+    def on_client_connection(self, client, error):
+        self.assertEqual(error, None)
+        self.write_next(client)
+
+    def on_client_write(self, client, error):
+        self.assertEqual(error, None)
+        self.write_cb_count += 1
+        if self.write_cb_count == 10:
+            client.shutdown(self.on_client_shutdown)
+        else:
+            self.write_next(client)
+
+    def on_client_shutdown(self, client, error):
+        client.close()
+
+    def write_next(self, client):
+        # the request whose callback is running is still in use
+        self.assertEqual(self.loop.request_pool_stats.in_use, 1)
+        client.write(b"PING", self.on_client_write)
+        self.assertEqual(self.loop.request_pool_stats.in_use, 2)
+
+    def test_tcp_request_pool(self):
+        self.server = pyuv.TCP(self.loop)
+        self.server.bind(("0.0.0.0", TEST_PORT))
+        self.server.listen(self.on_connection)
+        self.client = pyuv.TCP(self.loop)
+        self.client.connect(("127.0.0.1", TEST_PORT), self.on_client_connection)
+        self.loop.run()
+        stats = self.loop.request_pool_stats
+        self.assertEqual(self.write_cb_count, 10)
+        # 1 connect, 10 writes, 1 shutdown. Each write is issued while the
+        # previous one is still in use, so 2 write contexts are allocated.
+        self.assertEqual(stats.allocations, 12)
+        self.assertEqual(stats.reused, 8)
+        self.assertEqual(stats.in_use, 0)
+        self.assertEqual(stats.free, 4)
+
+
+class TCPTestCork(TestCase):
+
+    def setUp(self):
+        super(TCPTestCork, self).setUp()
+        self.server = None
+        self.client = None
+        self.data = b""
+        self.write_cb_count = 0
+
+    def on_connection(self, server, error):
+        self.assertEqual(error, None)
+        client = pyuv.TCP(self.loop)
+        server.accept(client)
+        client.start_read(self.on_client_connection_read)
+
+    def on_client_connection_read(self, client, data, error):
+        if data is None:
+            client.close()
+            self.server.close()
+            return
+        self.data += data
+
+    def on_client_write(self, client, error):
+        self.assertEqual(error, None)
+        self.write_cb_count += 1
+
+    def on_client_shutdown(self, client, error):
+        client.close()
+
+    def test_tcp_cork(self):
+        def on_client_connection(client, error):
+            self.assertEqual(error, None)
+            client.cork()
+            client.write(b"PING", self.on_client_write)
+            client.write([b"PI", b"NG"], self.on_client_write)
+            client.write(b"PING")
+            self.assertEqual(client.write_queue_size, 12)
+            # only the connect request is in use, writes are queued
+            self.assertEqual(self.loop.request_pool_stats.in_use, 1)
+            client.uncork()
+            self.assertEqual(self.loop.request_pool_stats.in_use, 2)
+            client.shutdown(self.on_client_shutdown)
+        self.server = pyuv.TCP(self.loop)
+        self.server.bind(("0.0.0.0", TEST_PORT))
+        self.server.listen(self.on_connection)
+        self.client = pyuv.TCP(self.loop)
+        self.client.connect(("127.0.0.1", TEST_PORT), on_client_connection)
+        self.loop.run()
+        self.assertEqual(self.data, b"PING"*3)
+        self.assertEqual(self.write_cb_count, 2)
+
+    def test_tcp_autocork(self):
+        def on_client_connection(client, error):
+            self.assertEqual(error, None)
+            client.autocork = True
+            for i in range(10):
+                client.write(b"PING", self.on_client_write)
+            self.assertEqual(client.write_queue_size, 40)
+            self.assertEqual(self.write_cb_count, 0)
+            self.loop.queue_work(lambda: None, after_work)
+        def after_work(error):
+            # queued writes were flushed at the end of the previous iteration
+            self.assertEqual(self.write_cb_count, 10)
+            self.client.autocork = False
+            self.client.write(b"PING", self.on_client_write)
+            self.client.shutdown(self.on_client_shutdown)
+        self.server = pyuv.TCP(self.loop)
+        self.server.bind(("0.0.0.0", TEST_PORT))
+        self.server.listen(self.on_connection)
+        self.client = pyuv.TCP(self.loop)
+        self.client.connect(("127.0.0.1", TEST_PORT), on_client_connection)
+        self.loop.run()
+        self.assertEqual(self.data, b"PING"*11)
+        self.assertEqual(self.write_cb_count, 11)
+        self.assertEqual(self.loop.request_pool_stats.in_use, 0)
+
+
+class TCPTestReadBatch(TestCase):
+
+    def setUp(self):
+        super(TCPTestReadBatch, self).setUp()
+        self.server = None
+        self.client = None
+        self.chunks = []
+        self.read_cb_called = 0
+
+    def on_connection(self, server, error):
+        self.assertEqual(error, None)
+        client = pyuv.TCP(self.loop)
+        server.accept(client)
+        client.write(b"x"*65536)
+        client.close()
+        server.close()
+
+    def on_client_connection(self, client, error):
+        self.assertEqual(error, None)
+        client.start_read(self.on_client_read, buffer_size=1024, **self.read_args)
+
+    def on_client_read(self, client, data, error):
+        if data is None:
+            client.close()
+            return
+        self.read_cb_called += 1
+        self.chunks.append(data)
+
+    def run_client(self, **read_args):
+        self.read_args = read_args
+        self.server = pyuv.TCP(self.loop)
+        self.server.bind(("0.0.0.0", TEST_PORT))
+        self.server.listen(self.on_connection)
+        self.client = pyuv.TCP(self.loop)
+        self.client.connect(("127.0.0.1", TEST_PORT), self.on_client_connection)
+        self.loop.run()
+
+    def test_tcp_read_batch_join(self):
+        self.run_client(batch=1024*1024, join=True)
+        self.assertTrue(all(isinstance(data, bytes) for data in self.chunks))
+        self.assertEqual(b"".join(self.chunks), b"x"*65536)
+        # 64 chunks were read
+        self.assertTrue(self.read_cb_called < 64)
+
+    def test_tcp_read_batch_list(self):
+        self.run_client(batch=4096, zerocopy=True)
+        self.assertTrue(all(isinstance(data, list) for data in self.chunks))
+        self.assertTrue(all(len(data) <= 4 for data in self.chunks))
+        self.assertEqual(b"".join(bytes(item) for data in self.chunks for item in data), b"x"*65536)
+
+    def test_tcp_read_batch_invalid(self):
+        client = pyuv.TCP(self.loop)
+        self.assertRaises(ValueError, client.start_read, self.on_client_read, batch=-1)
+        self.assertRaises(ValueError, client.start_read, self.on_client_read, join=True)
+        self.assertRaises(ValueError, client.start_read, self.on_client_read, batch=1024, zerocopy=True, join=True)
+        client.close()
+        self.loop.run()
+
+
 class TCPTestNull(TestCase):
 
     def setUp(self):
@@ -437,6 +783,36 @@ class TCPFlagsTest(TestCase):
         self.loop.run()
 
 
+@platform_only(["linux"])
+class TCPReusePortTest(TestCase):
+
+    def on_connection(self, server, error):
+        self.assertEqual(error, None)
+        client = pyuv.TCP(self.loop)
+        server.accept(client)
+        self.connections += 1
+        client.close()
+        if self.connections == 4:
+            for server in self.servers:
+                server.close()
+
+    def on_client_connect(self, client, error):
+        self.assertEqual(error, None)
+        client.close()
+
+    def test_tcp_reuseport(self):
+        self.connections = 0
+        self.servers = [pyuv.TCP(self.loop), pyuv.TCP(self.loop, socket.AF_INET)]
+        for server in self.servers:
+            server.bind(("127.0.0.1", TEST_PORT), pyuv.UV_TCP_REUSEPORT)
+            server.listen(self.on_connection)
+        for i in range(4):
+            client = pyuv.TCP(self.loop)
+            client.connect(("127.0.0.1", TEST_PORT), self.on_client_connect)
+        self.loop.run()
+        self.assertEqual(self.connections, 4)
+
+
 @platform_skip(["win32"])
 class TCPTryTest(TestCase):
 
@@ -1,8 +1,9 @@
 
+import sys
 import unittest
 import warnings
 
-from common import TestCase
+from common import platform_only, TestCase
 import pyuv
 
 
@@ -85,5 +86,264 @@ class TimerTest(TestCase):
         self.assertEqual(self.timer_cb_called, 1)
 
 
+class TimerBatchTest(TestCase):
+
+    def test_timer_slack(self):
+        self.fired = []
+        def timer_cb(timer):
+            self.fired.append(self.loop.now())
+            timer.close()
+        for timeout in (0.01, 0.02, 0.03, 0.04):
+            timer = pyuv.Timer(self.loop)
+            timer.start(timer_cb, timeout, 0, slack=0.05)
+        self.loop.run()
+        # all windows overlap, so every timer gets the same deadline
+        self.assertEqual(len(self.fired), 4)
+        self.assertEqual(len(set(self.fired)), 1)
+
+    def test_timer_batch(self):
+        self.batches = []
+        def batch_cb(timers):
+            self.batches.append(timers)
+            for timer in timers:
+                timer.close()
+        timers = [pyuv.Timer(self.loop) for i in range(10)]
+        for timer in timers:
+            timer.start(batch_cb, 0.01, 0, slack=0.02, batch=True)
+        self.loop.run()
+        self.assertEqual(len(self.batches), 1)
+        self.assertEqual(self.batches[0], timers)
+
+    def test_timer_batch_callbacks(self):
+        self.calls = []
+        def cb1(timers):
+            self.calls.append((1, len(timers)))
+        def cb2(timers):
+            self.calls.append((2, len(timers)))
+        for cb in (cb1, cb2, cb1):
+            timer = pyuv.Timer(self.loop)
+            timer.start(cb, 0, 0, batch=True)
+        self.loop.run()
+        self.assertEqual(self.calls, [(1, 2), (2, 1)])
+        for handle in self.loop.handles:
+            handle.close()
+        self.loop.run()
+
+    def test_timer_batch_unhashable(self):
+        calls = []
+        class Callback(list):
+            def __call__(self, timers):
+                calls.append(len(timers))
+                for timer in timers:
+                    timer.close()
+        cb = Callback()
+        for i in range(3):
+            timer = pyuv.Timer(self.loop)
+            timer.start(cb, 0, 0, batch=True)
+        self.loop.run()
+        self.assertEqual(calls, [3])
+
+    def bound_batch_cb(self, timers):
+        self.calls.append(len(timers))
+        for timer in timers:
+            timer.close()
+
+    def test_timer_batch_bound_method(self):
+        self.calls = []
+        for i in range(3):
+            timer = pyuv.Timer(self.loop)
+            timer.start(self.bound_batch_cb, 0, 0, batch=True)
+        self.loop.run()
+        self.assertEqual(self.calls, [3])
+
+    def test_timer_batch_repeat(self):
+        self.count = 0
+        def batch_cb(timers):
+            self.count += 1
+            if self.count == 3:
+                for timer in timers:
+                    timer.stop()
+        timer = pyuv.Timer(self.loop)
+        timer.start(batch_cb, 0.001, 0.001, batch=True)
+        self.loop.run()
+        self.assertEqual(self.count, 3)
+        self.assertFalse(timer.active)
+        timer.close()
+        self.loop.run()
+
+    def test_timer_batch_refcount(self):
+        self.count = 0
+        def batch_cb(timers):
+            self.count += len(timers)
+        timer = pyuv.Timer(self.loop)
+        refcount = sys.getrefcount(timer)
+        timer.start(batch_cb, 0, 0, batch=True)
+        self.loop.run()
+        self.assertEqual(self.count, 1)
+        timer.stop()
+        self.assertEqual(sys.getrefcount(timer), refcount)
+        timer.close()
+        self.loop.run()
+
+
+class TimerWheelTest(TestCase):
+
+    def test_timer_wheel(self):
+        self.fired = []
+        def timeout_cb(entry):
+            self.fired.append(entry)
+        wheel = pyuv.TimerWheel(self.loop, granularity=0.005, slots=8)
+        self.assertEqual(wheel.granularity, 0.005)
+        self.assertEqual(wheel.slots, 8)
+        # longer than a full turn of the wheel
+        e1 = wheel.schedule(timeout_cb, 0.1)
+        e2 = wheel.schedule(timeout_cb, 0.01)
+        self.assertTrue(e1.active)
+        self.assertTrue(e2.wheel is wheel)
+        self.assertEqual(wheel.count, 2)
+        self.loop.run()
+        self.assertEqual(self.fired, [e2, e1])
+        self.assertFalse(e1.active)
+        self.assertEqual(wheel.count, 0)
+        wheel.close()
+        self.loop.run()
+
+    def test_timer_wheel_timing(self):
+        def timeout_cb(entry):
+            self.elapsed = self.loop.now() - start
+        wheel = pyuv.TimerWheel(self.loop, granularity=0.01)
+        start = self.loop.now()
+        wheel.schedule(timeout_cb, 0.1)
+        self.loop.run()
+        self.assertTrue(100 <= self.elapsed < 200)
+
+    def test_timer_wheel_cancel(self):
+        self.fired = 0
+        def timeout_cb(entry):
+            self.fired += 1
+        wheel = pyuv.TimerWheel(self.loop)
+        entries = [wheel.schedule(timeout_cb, 0.01) for i in range(100)]
+        for entry in entries[::2]:
+            entry.cancel()
+        entries[1].cancel()
+        entries[1].cancel()
+        self.assertEqual(wheel.count, 49)
+        self.loop.run()
+        self.assertEqual(self.fired, 49)
+
+    def test_timer_wheel_reschedule(self):
+        self.fired = 0
+        def timeout_cb(entry):
+            self.fired += 1
+            if self.fired < 3:
+                entry.reschedule(0.01)
+        wheel = pyuv.TimerWheel(self.loop)
+        entry = wheel.schedule(timeout_cb, 1.0)
+        entry.reschedule(0.01)
+        self.assertEqual(wheel.count, 1)
+        self.loop.run()
+        self.assertEqual(self.fired, 3)
+
+    def test_timer_wheel_close(self):
+        self.fired = 0
+        def timeout_cb(entry):
+            self.fired += 1
+            entry.wheel.close()
+        wheel = pyuv.TimerWheel(self.loop)
+        e1 = wheel.schedule(timeout_cb, 0.01)
+        e2 = wheel.schedule(timeout_cb, 0.01)
+        wheel = None
+        self.loop.run()
+        self.assertEqual(self.fired, 1)
+        self.assertFalse(e1.active or e2.active)
+        self.assertRaises(pyuv.error.HandleClosedError, e1.reschedule, 0.01)
+
+    def test_timer_wheel_invalid(self):
+        self.assertRaises(ValueError, pyuv.TimerWheel, self.loop, 0.0001)
+        self.assertRaises(ValueError, pyuv.TimerWheel, self.loop, 0.01, 0)
+        wheel = pyuv.TimerWheel(self.loop)
+        self.assertRaises(TypeError, wheel.schedule, None, 0.01)
+        self.assertRaises(ValueError, wheel.schedule, lambda entry: None, -1)
+        wheel.close()
+        self.loop.run()
+
+
+class HRTimerTest(TestCase):
+
+    @platform_only(["linux"])
+    def test_hrtimer(self):
+        self.timer_cb_called = 0
+        def timer_cb(timer):
+            self.timer_cb_called += 1
+            self.elapsed = pyuv.util.hrtime() - start
+            timer.close()
+        timer = pyuv.HRTimer(self.loop)
+        start = pyuv.util.hrtime()
+        timer.start(timer_cb, 0.0005, 0)
+        self.loop.run()
+        self.assertEqual(self.timer_cb_called, 1)
+        self.assertTrue(self.elapsed >= 500000)
+
+    @platform_only(["linux"])
+    def test_hrtimer_repeat(self):
+        self.timer_cb_called = 0
+        def timer_cb(timer):
+            self.timer_cb_called += 1
+            if self.timer_cb_called == 10:
+                timer.stop()
+                timer.close()
+        timer = pyuv.HRTimer(self.loop)
+        timer.start(timer_cb, 0, 0.0001)
+        self.assertEqual(timer.repeat, 0.0001)
+        self.assertTrue(timer.active)
+        self.loop.run()
+        self.assertEqual(self.timer_cb_called, 10)
+
+    @platform_only(["linux"])
+    def test_hrtimer_stop(self):
+        self.timer_cb_called = 0
+        def timer_cb(timer):
+            self.timer_cb_called += 1
+        timer = pyuv.HRTimer(self.loop)
+        timer.start(timer_cb, 0.0001, 0)
+        timer.stop()
+        self.assertFalse(timer.active)
+        self.loop.run()
+        self.assertEqual(self.timer_cb_called, 0)
+        timer.close()
+        self.loop.run()
+
+    @platform_only(["linux"])
+    def test_hrtimer_set_repeat(self):
+        self.timer_cb_called = 0
+        def timer_cb(timer):
+            self.timer_cb_called += 1
+        timer = pyuv.HRTimer(self.loop)
+        timer.start(timer_cb, 0.001, 0)
+        # only applies the next time the timer is started, this one still fires once
+        timer.repeat = 0.05
+        self.loop.run()
+        self.assertEqual(self.timer_cb_called, 1)
+        self.assertFalse(timer.active)
+        self.assertEqual(timer.repeat, 0.05)
+        timer.close()
+        self.loop.run()
+
+    @platform_only(["linux"])
+    def test_hrtimer_clear_repeat(self):
+        self.timer_cb_called = 0
+        def timer_cb(timer):
+            self.timer_cb_called += 1
+            if self.timer_cb_called == 3:
+                timer.stop()
+        timer = pyuv.HRTimer(self.loop)
+        timer.start(timer_cb, 0, 0.001)
+        timer.repeat = 0
+        self.loop.run()
+        self.assertEqual(self.timer_cb_called, 3)
+        timer.close()
+        self.loop.run()
+
+
 if __name__ == '__main__':
     unittest.main(verbosity=2)
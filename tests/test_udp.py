@@ -3,7 +3,7 @@ import socket
 import sys
 import unittest
 
-from common import linesep, platform_skip, TestCase
+from common import linesep, platform_skip, platform_only, TestCase
 import pyuv
 
 
@@ -90,6 +90,195 @@ class UDPEmptyDatagramTest(TestCase):
         self.assertEqual(self.on_close_called, 2)
 
 
+class UDPZerocopyTest(TestCase):
+
+    def setUp(self):
+        super(UDPZerocopyTest, self).setUp()
+        self.server = None
+        self.client = None
+        self.on_close_called = 0
+
+    def on_close(self, handle):
+        self.on_close_called += 1
+
+    def on_client_recv(self, handle, ip_port, flags, data, error):
+        self.assertEqual(flags, 0)
+        self.assertEqual(error, None)
+        self.assertTrue(isinstance(data, pyuv.Buffer))
+        self.assertEqual(bytes(data), b"PING")
+        data.release()
+        self.client.close(self.on_close)
+        self.server.close(self.on_close)
+
+    def test_udp_zerocopy(self):
+        self.server = pyuv.UDP(self.loop)
+        self.client = pyuv.UDP(self.loop)
+        self.client.bind(("0.0.0.0", TEST_PORT2))
+        self.client.start_recv(self.on_client_recv, zerocopy=True)
+        self.server.send(("127.0.0.1", TEST_PORT2), b"PING")
+        self.loop.run()
+        self.assertEqual(self.on_close_called, 2)
+
+
+class UDPBatchTest(TestCase):
+
+    def setUp(self):
+        super(UDPBatchTest, self).setUp()
+        self.server = None
+        self.client = None
+        self.packets = []
+        self.recv_cb_called = 0
+
+    def on_client_recv(self, handle, packets, error):
+        self.assertEqual(error, None)
+        self.recv_cb_called += 1
+        for ip_port, flags, data in packets:
+            self.assertEqual(flags, 0)
+            self.packets.append(bytes(data))
+        if len(self.packets) == 20:
+            self.client.close()
+            self.server.close()
+
+    def test_udp_batch(self):
+        self.server = pyuv.UDP(self.loop)
+        self.client = pyuv.UDP(self.loop)
+        self.client.bind(("0.0.0.0", TEST_PORT2))
+        self.assertRaises(ValueError, self.client.start_recv, self.on_client_recv, batch=-1)
+        self.client.start_recv(self.on_client_recv, buffer_size=2048, batch=8)
+        for i in range(20):
+            self.server.try_send(("127.0.0.1", TEST_PORT2), b"PING" + str(i).encode())
+        self.loop.run()
+        self.assertEqual(self.packets, [b"PING" + str(i).encode() for i in range(20)])
+        if sys.platform.startswith("linux"):
+            self.assertTrue(self.recv_cb_called < 20)
+
+    def test_udp_batch_zerocopy(self):
+        def on_client_recv(handle, packets, error):
+            for ip_port, flags, data in packets:
+                self.assertTrue(isinstance(data, pyuv.Buffer))
+            self.on_client_recv(handle, packets, error)
+        self.server = pyuv.UDP(self.loop)
+        self.client = pyuv.UDP(self.loop)
+        self.client.bind(("0.0.0.0", TEST_PORT2))
+        self.client.start_recv(on_client_recv, zerocopy=True, batch=4)
+        for i in range(20):
+            self.server.try_send(("127.0.0.1", TEST_PORT2), b"PING")
+        self.loop.run()
+        self.assertEqual(self.packets, [b"PING"]*20)
+
+
+class UDPSendManyTest(TestCase):
+
+    def setUp(self):
+        super(UDPSendManyTest, self).setUp()
+        self.server = None
+        self.client = None
+        self.packets = []
+        self.send_cb_called = 0
+
+    def on_client_recv(self, handle, ip_port, flags, data, error):
+        self.assertEqual(error, None)
+        self.packets.append(data)
+        if len(self.packets) == 20:
+            self.client.close()
+            self.server.close()
+
+    def on_server_send(self, handle, error):
+        self.assertEqual(error, None)
+        self.send_cb_called += 1
+        if self.send_cb_called == 1:
+            # the handle is bound now, so this batch can go out at once
+            self.server.send_many([(("127.0.0.1", TEST_PORT2), b"PING" + str(i).encode()) for i in range(10, 20)], self.on_server_send)
+
+    def test_udp_send_many(self):
+        self.server = pyuv.UDP(self.loop)
+        self.client = pyuv.UDP(self.loop)
+        self.client.bind(("0.0.0.0", TEST_PORT2))
+        self.client.start_recv(self.on_client_recv)
+        self.assertRaises(ValueError, self.server.send_many, [])
+        self.assertRaises(TypeError, self.server.send_many, [b"PING"])
+        self.assertRaises(TypeError, self.server.send_many, [(("127.0.0.1", TEST_PORT2), u"PING")])
+        self.server.send_many([(("127.0.0.1", TEST_PORT2), b"PING" + str(i).encode()) for i in range(10)], self.on_server_send)
+        self.loop.run()
+        self.assertEqual(self.send_cb_called, 2)
+        self.assertEqual(self.packets, [b"PING" + str(i).encode() for i in range(20)])
+
+
+@platform_only(["linux"])
+class UDPOffloadTest(TestCase):
+
+    def setUp(self):
+        super(UDPOffloadTest, self).setUp()
+        self.server = None
+        self.client = None
+        self.packets = []
+
+    def on_client_recv(self, handle, ip_port, flags, data, error):
+        self.assertEqual(error, None)
+        self.packets.append(data)
+        if len(self.packets) == 11:
+            self.client.close()
+            self.server.close()
+
+    def on_client_recv_batch(self, handle, packets, error):
+        self.assertEqual(error, None)
+        for ip_port, flags, data in packets:
+            self.on_client_recv(handle, ip_port, flags, data, error)
+
+    def test_udp_gso(self):
+        self.server = pyuv.UDP(self.loop)
+        self.client = pyuv.UDP(self.loop)
+        self.client.bind(("0.0.0.0", TEST_PORT2))
+        self.client.start_recv(self.on_client_recv)
+        self.server.bind(("0.0.0.0", 0))
+        self.assertEqual(self.server.gso_segment_size, 0)
+        self.server.gso_segment_size = 100
+        self.assertEqual(self.server.gso_segment_size, 100)
+        self.server.send(("127.0.0.1", TEST_PORT2), b"x"*1050)
+        self.loop.run()
+        self.assertEqual(self.packets, [b"x"*100]*10 + [b"x"*50])
+
+    def test_udp_gro(self):
+        self.server = pyuv.UDP(self.loop)
+        self.client = pyuv.UDP(self.loop)
+        self.client.bind(("0.0.0.0", TEST_PORT2))
+        self.assertRaises(ValueError, self.client.start_recv, self.on_client_recv, gro=True)
+        self.assertRaises(ValueError, self.client.start_recv, self.on_client_recv_batch, batch=4, zerocopy=True, gro=True)
+        self.client.start_recv(self.on_client_recv_batch, batch=4, gro=True)
+        self.server.bind(("0.0.0.0", 0))
+        self.server.gso_segment_size = 100
+        self.server.send(("127.0.0.1", TEST_PORT2), b"x"*1050)
+        self.loop.run()
+        self.assertEqual(self.packets, [b"x"*100]*10 + [b"x"*50])
+
+
+class UDPPartialTest(TestCase):
+
+    def setUp(self):
+        super(UDPPartialTest, self).setUp()
+        self.server = None
+        self.client = None
+        self.on_close_called = 0
+
+    def on_close(self, handle):
+        self.on_close_called += 1
+
+    def on_client_recv(self, handle, ip_port, flags, data, error):
+        self.assertEqual(flags, pyuv.UV_UDP_PARTIAL)
+        self.assertEqual(data, b"x"*1024)
+        self.client.close(self.on_close)
+        self.server.close(self.on_close)
+
+    def test_udp_partial(self):
+        self.server = pyuv.UDP(self.loop)
+        self.client = pyuv.UDP(self.loop)
+        self.client.bind(("0.0.0.0", TEST_PORT2))
+        self.client.start_recv(self.on_client_recv, 1024)
+        self.server.send(("127.0.0.1", TEST_PORT2), b"x"*2000)
+        self.loop.run()
+        self.assertEqual(self.on_close_called, 2)
+
+
 class UDPTestNull(TestCase):
 
     def setUp(self):
@@ -381,6 +570,22 @@ class UDPTestBind(TestCase):
         self.loop.run()
 
 
+@platform_only(["linux"])
+class UDPTestBindReusePort(TestCase):
+
+    def test_udp_bind_reuseport(self):
+        handle = pyuv.UDP(self.loop)
+        handle.bind(("", TEST_PORT), pyuv.UV_UDP_REUSEPORT)
+        handle2 = pyuv.UDP(self.loop, socket.AF_INET)
+        handle2.bind(("", TEST_PORT), pyuv.UV_UDP_REUSEPORT)
+        sock = socket.fromfd(handle2.fileno(), socket.AF_INET, socket.SOCK_DGRAM)
+        self.assertTrue(sock.getsockopt(socket.SOL_SOCKET, socket.SO_REUSEPORT))
+        sock.close()
+        handle.close()
+        handle2.close()
+        self.loop.run()
+
+
 class UDPTestFileno(TestCase):
 
     def check_fileno(self, handle):